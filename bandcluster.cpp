@@ -0,0 +1,440 @@
+#include "bandcluster.h"
+#include "dungeon.h"
+#include "dungeonfile.h"
+#include "healthstep.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "tracer.h"
+#include "wallmask.h"
+#include <QFile>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BAND_CLUSTER_POSIX 1
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// 每段边界行前的消息头，接收方据此确认列块顺序
+struct BoundaryHeader {
+    int32_t col;
+    int32_t count;
+};
+
+#ifdef BAND_CLUSTER_POSIX
+void sendAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        // 对端退出时返回EPIPE而不是收到SIGPIPE
+        ssize_t written = ::send(fd, bytes, size, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw BandClusterException(std::string("发送边界行失败: ") + std::strerror(errno));
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+void receiveAll(int fd, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t got = ::recv(fd, bytes, size, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw BandClusterException(std::string("接收边界行失败: ") + std::strerror(errno));
+        }
+        if (got == 0) {
+            throw BandClusterException("下方一带的工作进程已断开");
+        }
+        bytes += got;
+        size -= static_cast<size_t>(got);
+    }
+}
+#endif
+
+// 按列块推进一带：segment中是下方一行在[c0, c1)的dp，rightEdge[i - lo]是第i行第c1列的dp（c1为cols时为INT_MAX）。
+// 自下而上算完后segment是本带首行这一段，rightEdge更新为第c0列
+template <typename T>
+void solveChunk(const T* cells, const uint64_t* walls, int cols, int lo, int hi, int c0, int c1,
+                std::vector<int>& segment, std::vector<int>& rightEdge, int* dp) {
+    for (int i = hi - 1; i >= lo; --i) {
+        size_t base = static_cast<size_t>(i) * cols;
+        int right = rightEdge[i - lo];
+        for (int j = c1 - 1; j >= c0; --j) {
+            int need = WallMask::masked(neededHealth(std::min(segment[j - c0], right), cells[base + j]),
+                                        WallMask::isWall(walls, base + j), INT_MAX);
+            segment[j - c0] = need;
+            dp[base + j] = need;
+            right = need;
+        }
+        rightEdge[i - lo] = segment[0];
+    }
+}
+
+bool parseInt(const char* text, int& value) {
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(text, &end, 10);
+    if (errno != 0 || end == text || *end != '\0' || parsed < INT_MIN || parsed > INT_MAX) {
+        return false;
+    }
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+} // namespace
+
+const char* const BandCluster::WORKER_FLAG = "--band-worker";
+
+SocketBoundaryChannel::SocketBoundaryChannel(int fd) : m_fd(fd) {
+}
+
+SocketBoundaryChannel::~SocketBoundaryChannel() {
+#ifdef BAND_CLUSTER_POSIX
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+#endif
+}
+
+void SocketBoundaryChannel::send(int col, const int* values, int count) {
+#ifdef BAND_CLUSTER_POSIX
+    BoundaryHeader header{col, count};
+    sendAll(m_fd, &header, sizeof(header));
+    sendAll(m_fd, values, sizeof(int) * static_cast<size_t>(count));
+#else
+    (void)col;
+    (void)values;
+    (void)count;
+    throw BandClusterException("当前平台不支持套接字通道");
+#endif
+}
+
+void SocketBoundaryChannel::receive(int col, int* values, int count) {
+#ifdef BAND_CLUSTER_POSIX
+    BoundaryHeader header;
+    receiveAll(m_fd, &header, sizeof(header));
+    if (header.col != col || header.count != count) {
+        throw BandClusterException("收到的边界行与预期的列块不符");
+    }
+    receiveAll(m_fd, values, sizeof(int) * static_cast<size_t>(count));
+#else
+    (void)col;
+    (void)values;
+    (void)count;
+    throw BandClusterException("当前平台不支持套接字通道");
+#endif
+}
+
+void solveBand(const BandTask& task, BoundaryChannel* below, BoundaryChannel* above) {
+    TRACE_SCOPE("solveBand");
+    try {
+        DungeonFileMapping map(task.mapFile);
+        const DungeonFileHeader& header = map.header();
+        int rows = static_cast<int>(header.rows);
+        int cols = static_cast<int>(header.cols);
+        int lo = task.firstRow;
+        int hi = task.lastRow;
+        if (lo < 0 || lo >= hi || hi > rows || task.chunkCols <= 0) {
+            throw BandClusterException("带的范围无效");
+        }
+        if ((hi < rows) != (below != nullptr) || (lo > 0) != (above != nullptr)) {
+            throw BandClusterException("带的通道与位置不符");
+        }
+
+        QFile output(task.outputFile);
+        qint64 outputSize = static_cast<qint64>(sizeof(int)) * rows * cols;
+        if (!output.open(QIODevice::ReadWrite) || output.size() != outputSize) {
+            throw BandClusterException("无法打开dp输出文件: " + output.errorString().toStdString());
+        }
+        uchar* outputData = output.map(0, outputSize);
+        if (!outputData) {
+            throw BandClusterException("映射dp输出文件失败: " + output.errorString().toStdString());
+        }
+        int* dp = reinterpret_cast<int*>(outputData);
+
+        std::vector<int> rightEdge(hi - lo, INT_MAX);
+        std::vector<int> segment;
+        for (int c1 = cols; c1 > 0; c1 -= task.chunkCols) {
+            int c0 = std::max(0, c1 - task.chunkCols);
+            segment.resize(c1 - c0);
+            if (below) {
+                below->receive(c0, segment.data(), c1 - c0);
+            } else {
+                // 最后一行下面虚设一行，只有终点正下方需要1点健康值
+                std::fill(segment.begin(), segment.end(), INT_MAX);
+                if (c1 == cols) {
+                    segment.back() = 1;
+                }
+            }
+
+            if (header.cellWidth == 1) {
+                solveChunk(reinterpret_cast<const int8_t*>(map.cellData()), map.wallData(), cols, lo, hi, c0, c1, segment, rightEdge, dp);
+            } else if (header.cellWidth == 2) {
+                solveChunk(reinterpret_cast<const int16_t*>(map.cellData()), map.wallData(), cols, lo, hi, c0, c1, segment, rightEdge, dp);
+            } else {
+                solveChunk(reinterpret_cast<const int32_t*>(map.cellData()), map.wallData(), cols, lo, hi, c0, c1, segment, rightEdge, dp);
+            }
+
+            if (above) {
+                above->send(c0, segment.data(), c1 - c0);
+            }
+        }
+
+        output.unmap(outputData);
+
+    } catch (const BandClusterException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw BandClusterException(std::string("求解带失败: ") + e.what());
+    }
+}
+
+bool BandCluster::verify(const QString& mapFile, const QString& dpFile) {
+    TRACE_SCOPE("BandCluster::verify");
+    try {
+        // 格子复制后交给Dungeon，不使用文件中可能带有的dp段，保证由Dungeon::solveDp重新求解
+        DungeonFileMapping map(mapFile);
+        const DungeonFileHeader& header = map.header();
+        int rows = static_cast<int>(header.rows);
+        int cols = static_cast<int>(header.cols);
+        size_t count = static_cast<size_t>(rows) * cols;
+
+        std::vector<int> cells(count);
+        if (header.cellWidth == 1) {
+            const int8_t* src = reinterpret_cast<const int8_t*>(map.cellData());
+            std::copy(src, src + count, cells.begin());
+        } else if (header.cellWidth == 2) {
+            const int16_t* src = reinterpret_cast<const int16_t*>(map.cellData());
+            std::copy(src, src + count, cells.begin());
+        } else {
+            const int32_t* src = reinterpret_cast<const int32_t*>(map.cellData());
+            std::copy(src, src + count, cells.begin());
+        }
+        std::vector<uint64_t> walls;
+        if (map.wallData()) {
+            walls.assign(map.wallData(), map.wallData() + WallMask::wordCount(count));
+        }
+
+        Dungeon dungeon;
+        dungeon.loadMap(rows, cols, std::move(cells), std::move(walls));
+        dungeon.calculateMinHealth();
+        if (!dungeon.isSolved()) {
+            throw BandClusterException("单进程求解没有得到完整的dp表");
+        }
+
+        QFile output(dpFile);
+        qint64 outputSize = static_cast<qint64>(sizeof(int)) * rows * cols;
+        if (!output.open(QIODevice::ReadOnly) || output.size() != outputSize) {
+            throw BandClusterException("dp输出文件不存在或大小与地图不符");
+        }
+        const uchar* outputData = output.map(0, outputSize);
+        if (!outputData) {
+            throw BandClusterException("映射dp输出文件失败: " + output.errorString().toStdString());
+        }
+        const int* dp = reinterpret_cast<const int*>(outputData);
+
+        for (int i = 0; i < rows; ++i) {
+            const int* expected = dungeon.getDpRow(i);
+            const int* actual = dp + static_cast<size_t>(i) * cols;
+            if (std::memcmp(expected, actual, sizeof(int) * static_cast<size_t>(cols)) != 0) {
+                int j = static_cast<int>(std::mismatch(expected, expected + cols, actual).first - expected);
+                LOG_WARNING("Band dp differs from Dungeon::solveDp at (%d, %d): %d vs %d",
+                            i, j, actual[j], expected[j]);
+                return false;
+            }
+        }
+        LOG_INFO("Band dp matches Dungeon::solveDp: %d x %d", rows, cols);
+        return true;
+
+    } catch (const BandClusterException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw BandClusterException(std::string("校验dp表失败: ") + e.what());
+    }
+}
+
+BandCluster::BandCluster(const QString& program, int processes, int chunkCols)
+    : m_program(program), m_processes(processes), m_chunkCols(chunkCols) {
+    if (processes <= 0) {
+        throw BandClusterException("进程数必须为正数");
+    }
+    if (chunkCols <= 0) {
+        throw BandClusterException("列块宽度必须为正数");
+    }
+}
+
+BandSolveResult BandCluster::solve(const QString& mapFile, const QString& outputFile) const {
+    TRACE_SCOPE("BandCluster::solve");
+    try {
+#ifdef BAND_CLUSTER_POSIX
+        uint64_t start = PerfMetrics::now();
+
+        QFile input(mapFile);
+        if (!input.open(QIODevice::ReadOnly)) {
+            throw BandClusterException("无法打开地图文件: " + input.errorString().toStdString());
+        }
+        DungeonFileHeader header = DungeonFile::readHeader(input);
+        input.close();
+
+        BandSolveResult result;
+        result.rows = static_cast<int>(header.rows);
+        result.cols = static_cast<int>(header.cols);
+        result.processes = std::min(m_processes, result.rows);
+        int processes = result.processes;
+
+        // 启动器先创建好输出文件，各工作进程映射后只写自己的行
+        QFile output(outputFile);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+            !output.resize(static_cast<qint64>(sizeof(int)) * result.rows * result.cols)) {
+            throw BandClusterException("无法创建dp输出文件: " + output.errorString().toStdString());
+        }
+        output.close();
+
+        // pairs[t]连接第t带（[0]端，接收）和第t+1带（[1]端，发送）
+        std::vector<int> fds;
+        auto closeAll = [&fds] {
+            for (int fd : fds) {
+                ::close(fd);
+            }
+            fds.clear();
+        };
+        for (int t = 0; t + 1 < processes; ++t) {
+            int pair[2];
+            if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+                closeAll();
+                throw BandClusterException(std::string("创建套接字失败: ") + std::strerror(errno));
+            }
+            fds.push_back(pair[0]);
+            fds.push_back(pair[1]);
+        }
+
+        // fork之后只调用异步信号安全的函数，参数全部提前准备好
+        std::string program = m_program.toStdString();
+        std::vector<std::vector<std::string>> args(processes);
+        for (int t = 0; t < processes; ++t) {
+            int lo = static_cast<int>(static_cast<int64_t>(result.rows) * t / processes);
+            int hi = static_cast<int>(static_cast<int64_t>(result.rows) * (t + 1) / processes);
+            int belowFd = t + 1 < processes ? fds[2 * t] : -1;
+            int aboveFd = t > 0 ? fds[2 * (t - 1) + 1] : -1;
+            args[t] = {program, WORKER_FLAG, mapFile.toStdString(), outputFile.toStdString(),
+                       std::to_string(lo), std::to_string(hi), std::to_string(m_chunkCols),
+                       std::to_string(belowFd), std::to_string(aboveFd)};
+        }
+
+        std::vector<pid_t> pids;
+        for (int t = 0; t < processes; ++t) {
+            std::vector<char*> argv;
+            for (std::string& arg : args[t]) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(nullptr);
+            int belowFd = t + 1 < processes ? fds[2 * t] : -1;
+            int aboveFd = t > 0 ? fds[2 * (t - 1) + 1] : -1;
+
+            pid_t pid = ::fork();
+            if (pid == 0) {
+                for (int fd : fds) {
+                    if (fd != belowFd && fd != aboveFd) {
+                        ::close(fd);
+                    }
+                }
+                ::execv(program.c_str(), argv.data());
+                ::_exit(127);
+            }
+            if (pid < 0) {
+                int error = errno;
+                for (pid_t started : pids) {
+                    ::kill(started, SIGTERM);
+                    ::waitpid(started, nullptr, 0);
+                }
+                closeAll();
+                throw BandClusterException(std::string("启动工作进程失败: ") + std::strerror(error));
+            }
+            pids.push_back(pid);
+        }
+        closeAll();
+
+        // 某一带失败时相邻的带读写套接字出错随之退出，这里只需等全部进程结束
+        std::string failures;
+        for (int t = 0; t < processes; ++t) {
+            int status = 0;
+            while (::waitpid(pids[t], &status, 0) < 0 && errno == EINTR) {
+            }
+            if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failures += (failures.empty() ? "" : "、") + std::to_string(t);
+            }
+        }
+        if (!failures.empty()) {
+            throw BandClusterException("第" + failures + "带的工作进程失败");
+        }
+
+        if (!output.open(QIODevice::ReadOnly) ||
+            output.read(reinterpret_cast<char*>(&result.minHealth), sizeof(int)) != static_cast<qint64>(sizeof(int))) {
+            throw BandClusterException("读取dp输出文件失败: " + output.errorString().toStdString());
+        }
+
+        result.seconds = (PerfMetrics::now() - start) / 1e9;
+        LOG_INFO("Band solve: %d x %d with %d processes in %.3f s", result.rows, result.cols, processes, result.seconds);
+        return result;
+#else
+        (void)mapFile;
+        (void)outputFile;
+        throw BandClusterException("当前平台不支持多进程求解");
+#endif
+
+    } catch (const BandClusterException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw BandClusterException(std::string("多进程求解失败: ") + e.what());
+    }
+}
+
+int BandCluster::workerMain(int argc, char* argv[]) {
+    // 参数：地图文件 输出文件 首行 末行之后 列块宽度 下方通道 上方通道（没有时为-1）
+    BandTask task;
+    int belowFd = -1;
+    int aboveFd = -1;
+    if (argc != 7 || !parseInt(argv[2], task.firstRow) || !parseInt(argv[3], task.lastRow) ||
+        !parseInt(argv[4], task.chunkCols) || !parseInt(argv[5], belowFd) || !parseInt(argv[6], aboveFd)) {
+        LOG_ERROR("Band worker: invalid arguments");
+        Logger::flush();
+        return 2;
+    }
+    task.mapFile = QString::fromLocal8Bit(argv[0]);
+    task.outputFile = QString::fromLocal8Bit(argv[1]);
+
+    try {
+        std::unique_ptr<BoundaryChannel> below;
+        std::unique_ptr<BoundaryChannel> above;
+        if (belowFd >= 0) {
+            below.reset(new SocketBoundaryChannel(belowFd));
+        }
+        if (aboveFd >= 0) {
+            above.reset(new SocketBoundaryChannel(aboveFd));
+        }
+        solveBand(task, below.get(), above.get());
+    } catch (const std::exception& e) {
+        LOG_ERROR("Band worker %d-%d failed: %s", task.firstRow, task.lastRow, e.what());
+        Logger::flush();
+        return 1;
+    }
+
+    Logger::flush();
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef BANDCLUSTER_H
+#define BANDCLUSTER_H
+
+#include <QString>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+class BandClusterException : public std::runtime_error {
+public:
+    explicit BandClusterException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 相邻两带之间传递边界行的通道。目前用Unix域套接字连接本机的工作进程，
+// 换成TCP等其他实现即可把各带分到不同机器上，求解逻辑不变。
+class BoundaryChannel {
+public:
+    virtual ~BoundaryChannel() = default;
+
+    // 发送/接收下方一带首行在[col, col + count)的dp
+    virtual void send(int col, const int* values, int count) = 0;
+    virtual void receive(int col, int* values, int count) = 0;
+};
+
+// 基于已连接的流式套接字（socketpair或connect得到）的通道，析构时关闭
+class SocketBoundaryChannel : public BoundaryChannel {
+public:
+    explicit SocketBoundaryChannel(int fd);
+    ~SocketBoundaryChannel() override;
+
+    SocketBoundaryChannel(const SocketBoundaryChannel&) = delete;
+    SocketBoundaryChannel& operator=(const SocketBoundaryChannel&) = delete;
+
+    void send(int col, const int* values, int count) override;
+    void receive(int col, int* values, int count) override;
+
+private:
+    int m_fd;
+};
+
+// 一个工作进程负责的一带：[firstRow, lastRow)行，结果写入共享的dp输出文件
+struct BandTask {
+    QString mapFile;        // .dgn地图文件
+    QString outputFile;     // rows*cols个int的dp输出文件（行优先，由启动器创建）
+    int firstRow = 0;
+    int lastRow = 0;
+    int chunkCols = 0;      // 每次向上一带传递的列数
+};
+
+// 求解一带。列按chunkCols从右向左分块：每块先等下方一带传来它首行的这一段（最后一带用虚设的行），
+// 自下而上算完本带这几列后把本带首行的这一段传给上方一带。
+// 这样各带按列块流水线并行，上方一带不必等下方一带整带算完。below/above为空表示没有下方/上方的带。
+void solveBand(const BandTask& task, BoundaryChannel* below, BoundaryChannel* above);
+
+struct BandSolveResult {
+    int rows = 0;
+    int cols = 0;
+    int minHealth = INT_MAX;    // INT_MAX表示没有可行路线
+    int processes = 0;
+    double seconds = 0;
+};
+
+// 本机多进程启动器，代替集群使用：把地图按行分成若干带，每带由program以工作进程方式重新启动自己来求解，
+// 相邻两带之间用socketpair传递边界行。结果按经典规则（左上到右下，不限健康上限），与Dungeon::solveDp逐位相同。
+class BandCluster {
+public:
+    // 工作进程的第一个命令行参数，main()看到它时调用workerMain()
+    static const char* const WORKER_FLAG;
+    static const int DEFAULT_CHUNK_COLS = 4096;
+
+    BandCluster(const QString& program, int processes, int chunkCols = DEFAULT_CHUNK_COLS);
+
+    // 求解地图文件，完整的dp表写入outputFile
+    BandSolveResult solve(const QString& mapFile, const QString& outputFile) const;
+
+    // 工作进程入口，参数为WORKER_FLAG之后的部分；返回进程退出码
+    static int workerMain(int argc, char* argv[]);
+
+    // 把地图载入Dungeon用solveDp单进程求解，与dpFile中的dp表逐位比较，相同时返回true
+    static bool verify(const QString& mapFile, const QString& dpFile);
+
+private:
+    QString m_program;
+    int m_processes;
+    int m_chunkCols;
+};
+
+#endif // BANDCLUSTER_H
@@ -0,0 +1,182 @@
+#include "checkpointsolver.h"
+#include "healthstep.h"
+#include "logger.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include "wallmask.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// row中是下一行的dp，就地从右向左算出第i行
+template <typename T>
+void stepRow(const T* cells, const uint64_t* walls, int i, int cols, int cap, std::vector<int>& row) {
+    const T* mapRow = cells + static_cast<size_t>(i) * cols;
+    size_t base = static_cast<size_t>(i) * cols;
+    int right = INT_MAX;
+    for (int j = cols - 1; j >= 0; --j) {
+        int need = WallMask::masked(neededHealth(std::min(row[j], right), mapRow[j], cap),
+                                    WallMask::isWall(walls, base + j), INT_MAX);
+        row[j] = need;
+        right = need;
+    }
+}
+
+// 最后一行下面虚设一行，只有终点正下方需要1点健康值，这样最后一行与其他行用同一个递推
+void belowLastRow(std::vector<int>& row, int cols) {
+    row.assign(cols, INT_MAX);
+    row[cols - 1] = 1;
+}
+
+} // namespace
+
+CheckpointSolver::CheckpointSolver(int interval) : m_requestedInterval(interval) {
+    if (interval < 0) {
+        throw CheckpointSolverException("检查点间隔不能为负数");
+    }
+}
+
+void CheckpointSolver::solve(const void* cells, int cellWidth, const uint64_t* walls, int rows, int cols, int cap) {
+    TRACE_SCOPE("CheckpointSolver::solve");
+    try {
+        if (!cells || rows <= 0 || cols <= 0) {
+            throw CheckpointSolverException("地图数据无效");
+        }
+        if (cellWidth != 1 && cellWidth != 2 && cellWidth != 4) {
+            throw CheckpointSolverException("格子宽度无效: " + std::to_string(cellWidth));
+        }
+
+        m_cells = cells;
+        m_cellWidth = cellWidth;
+        m_walls = walls;
+        m_rows = rows;
+        m_cols = cols;
+        m_cap = cap > 0 ? cap : INT_MAX;
+        m_interval = m_requestedInterval > 0
+            ? std::min(m_requestedInterval, rows)
+            : std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<double>(rows)))));
+
+        // 自下而上逐带扫描，每带扫完时row正好是该带首行（检查点）的dp
+        int bands = (rows + m_interval - 1) / m_interval;
+        m_checkpoints.assign(static_cast<size_t>(bands) * cols, INT_MAX);
+        std::vector<int> row;
+        belowLastRow(row, cols);
+        for (int band = bands - 1; band >= 0; --band) {
+            int lo = band * m_interval;
+            sweep(lo, std::min(lo + m_interval, rows), row, nullptr);
+            std::copy(row.begin(), row.end(), m_checkpoints.begin() + static_cast<size_t>(band) * cols);
+        }
+
+        m_minHealth = m_checkpoints[0];
+        m_peakBytes = checkpointBytes() + row.size() * sizeof(int);
+
+        LOG_DEBUG("Checkpoint solve: %d x %d, interval %d, %zu checkpoint bytes",
+                  rows, cols, m_interval, checkpointBytes());
+
+    } catch (const CheckpointSolverException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw CheckpointSolverException(std::string("检查点求解失败: ") + e.what());
+    }
+}
+
+void CheckpointSolver::sweep(int lo, int hi, std::vector<int>& row, int* band) const {
+    for (int i = hi - 1; i >= lo; --i) {
+        if (m_cellWidth == 1) {
+            stepRow(static_cast<const int8_t*>(m_cells), m_walls, i, m_cols, m_cap, row);
+        } else if (m_cellWidth == 2) {
+            stepRow(static_cast<const int16_t*>(m_cells), m_walls, i, m_cols, m_cap, row);
+        } else {
+            stepRow(static_cast<const int32_t*>(m_cells), m_walls, i, m_cols, m_cap, row);
+        }
+        if (band) {
+            std::copy(row.begin(), row.end(), band + static_cast<size_t>(i - lo) * m_cols);
+        }
+    }
+}
+
+void CheckpointSolver::recomputeBand(int band, std::vector<int>& buffer) const {
+    // buffer存放本带各行的dp，末尾多一行是下一带的首行（最后一带为全INT_MAX），回溯时看向下的一步
+    int lo = band * m_interval;
+    int hi = std::min(lo + m_interval, m_rows);
+    size_t cols = static_cast<size_t>(m_cols);
+    buffer.resize((hi - lo + 1) * cols);
+
+    std::vector<int> row;
+    if (hi < m_rows) {
+        auto below = m_checkpoints.begin() + static_cast<size_t>(band + 1) * cols;
+        row.assign(below, below + cols);
+        std::copy(row.begin(), row.end(), buffer.begin() + (hi - lo) * cols);
+    } else {
+        belowLastRow(row, m_cols);
+        std::fill(buffer.begin() + (hi - lo) * cols, buffer.end(), INT_MAX);
+    }
+    sweep(lo, hi, row, buffer.data());
+}
+
+std::vector<QPoint> CheckpointSolver::tracePath() const {
+    TRACE_SCOPE("CheckpointSolver::tracePath");
+    try {
+        if (m_checkpoints.empty()) {
+            throw CheckpointSolverException("尚未求解");
+        }
+
+        std::vector<QPoint> path;
+        if (m_minHealth == INT_MAX) {
+            path.push_back(QPoint(0, 0));
+            return path;
+        }
+
+        // 路径自上而下依次经过各带，每次并行重算接下来的若干带，再沿路径走过它们
+        int bands = static_cast<int>(m_checkpoints.size() / m_cols);
+        int group = static_cast<int>(TaskPool::instance().workerCount()) + 1;
+        std::vector<std::vector<int>> buffers(std::min(group, bands));
+        path.reserve(static_cast<size_t>(m_rows) + m_cols - 1);
+
+        size_t bufferBytes = 0;
+        int i = 0;
+        int j = 0;
+        for (int first = 0; first < bands; first += group) {
+            int count = std::min(group, bands - first);
+            parallelFor(static_cast<size_t>(count), TaskPriority::High, [&](size_t k) {
+                recomputeBand(first + static_cast<int>(k), buffers[k]);
+            });
+            for (int k = 0; k < count; ++k) {
+                bufferBytes = std::max(bufferBytes, buffers[k].capacity() * sizeof(int));
+            }
+
+            // 与经典回溯的规则一致：相等时优先向下
+            for (int k = 0; k < count; ++k) {
+                const std::vector<int>& dp = buffers[k];
+                int lo = (first + k) * m_interval;
+                int hi = std::min(lo + m_interval, m_rows);
+                while (i < hi) {
+                    path.push_back(QPoint(j, i));
+                    if (i == m_rows - 1 && j == m_cols - 1) {
+                        break;
+                    }
+                    size_t index = static_cast<size_t>(i - lo) * m_cols + j;
+                    int down = dp[index + m_cols];
+                    int right = j + 1 < m_cols ? dp[index + 1] : INT_MAX;
+                    if (down == INT_MAX && right == INT_MAX) {
+                        throw CheckpointSolverException("回溯时遇到不可行的格子");
+                    }
+                    if (down <= right) {
+                        ++i;
+                    } else {
+                        ++j;
+                    }
+                }
+            }
+        }
+
+        m_peakBytes = std::max(m_peakBytes, checkpointBytes() + buffers.size() * bufferBytes);
+        return path;
+
+    } catch (const CheckpointSolverException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw CheckpointSolverException(std::string("回溯最优路径失败: ") + e.what());
+    }
+}
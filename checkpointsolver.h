@@ -0,0 +1,63 @@
+#ifndef CHECKPOINTSOLVER_H
+#define CHECKPOINTSOLVER_H
+
+#include <QPoint>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+class CheckpointSolverException : public std::runtime_error {
+public:
+    explicit CheckpointSolverException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 检查点DP：地图放得进内存、完整的dp表放不下时使用。
+//
+// 求解时只保存第0、k、2k……行的dp（k默认约为√rows），内存为O(rows/k × cols)。
+// 回溯时把相邻检查点之间的k行称为一带，用下方检查点重算整带后沿路径走过，
+// 每次在任务池中并行重算（线程数+1）带，峰值内存为O((rows/k + 线程数 × k) × cols)，
+// 总计算量约为完整求解的两倍。
+//
+// 只按经典路线求解（左上到右下），支持墙壁和健康上限，结果与Dungeon::solveDp和经典回溯一致。
+// 地图数据和墙壁位图由调用方保持有效，直到不再调用tracePath()。
+class CheckpointSolver {
+public:
+    // interval为检查点间隔，0表示按行数取约√rows
+    explicit CheckpointSolver(int interval = 0);
+
+    // 地图数据按cellWidth字节（1、2或4）行优先存放，与.dgn文件的格子格式相同；walls为空表示没有墙壁
+    void solve(const void* cells, int cellWidth, const uint64_t* walls, int rows, int cols, int cap = INT_MAX);
+
+    // 最小初始健康值，INT_MAX表示没有可行路线
+    int minHealth() const { return m_minHealth; }
+
+    // 实际使用的检查点间隔
+    int interval() const { return m_interval; }
+
+    // 检查点占用的字节数，以及包括回溯时分带缓冲区在内的峰值
+    size_t checkpointBytes() const { return m_checkpoints.size() * sizeof(int); }
+    size_t peakBytes() const { return m_peakBytes; }
+
+    // 最优路径（x为列，y为行）；没有可行路线时只有起点
+    std::vector<QPoint> tracePath() const;
+
+private:
+    void sweep(int lo, int hi, std::vector<int>& row, int* band) const;
+    void recomputeBand(int band, std::vector<int>& buffer) const;
+
+    int m_requestedInterval;
+    int m_interval = 0;
+    const void* m_cells = nullptr;
+    int m_cellWidth = 4;
+    const uint64_t* m_walls = nullptr;
+    int m_rows = 0;
+    int m_cols = 0;
+    int m_cap = INT_MAX;
+    int m_minHealth = INT_MAX;
+    std::vector<int> m_checkpoints;     // 第0、k、2k……行的dp，每行cols个
+    mutable size_t m_peakBytes = 0;
+};
+
+#endif // CHECKPOINTSOLVER_H
@@ -0,0 +1,54 @@
+#include "compactpath.h"
+#include <stdexcept>
+
+void CompactPath::push(bool down) {
+    if ((length & 63) == 0) {
+        bits.push_back(0);
+    }
+    if (down) {
+        bits.back() |= uint64_t(1) << (length & 63);
+    }
+    ++length;
+}
+
+CompactPath CompactPath::fromPoints(const std::vector<QPoint>& points) {
+    CompactPath path;
+    if (points.empty()) {
+        return path;
+    }
+
+    path.start = points.front();
+    path.bits.reserve((points.size() + 63) / 64);
+
+    for (size_t k = 1; k < points.size(); ++k) {
+        int dx = points[k].x() - points[k-1].x();
+        int dy = points[k].y() - points[k-1].y();
+        if (dx == 1 && dy == 0) {
+            path.push(false);
+        } else if (dx == 0 && dy == 1) {
+            path.push(true);
+        } else {
+            throw std::invalid_argument("路径中存在非法移动");
+        }
+    }
+
+    return path;
+}
+
+std::vector<QPoint> CompactPath::toPoints() const {
+    std::vector<QPoint> points;
+    points.reserve(static_cast<size_t>(length) + 1);
+
+    QPoint current = start;
+    points.push_back(current);
+    for (uint32_t step = 0; step < length; ++step) {
+        if (isDown(step)) {
+            current.setY(current.y() + 1);
+        } else {
+            current.setX(current.x() + 1);
+        }
+        points.push_back(current);
+    }
+
+    return points;
+}
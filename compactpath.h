@@ -0,0 +1,28 @@
+#ifndef COMPACTPATH_H
+#define COMPACTPATH_H
+
+#include <QPoint>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 紧凑路径：从起点出发的每一步只可能向右或向下，每步用1位记录（1表示向下）
+struct CompactPath {
+    QPoint start;                   // 起点（x为列，y为行）
+    uint32_t length = 0;            // 步数
+    std::vector<uint64_t> bits;     // 按步存放的移动位
+
+    bool isDown(uint32_t step) const { return (bits[step >> 6] >> (step & 63)) & 1; }
+    void push(bool down);
+    size_t byteSize() const { return bits.size() * sizeof(uint64_t); }
+
+    // 与逐点路径相互转换，路径中相邻点必须只差向右或向下一步
+    static CompactPath fromPoints(const std::vector<QPoint>& points);
+    std::vector<QPoint> toPoints() const;
+
+    bool operator==(const CompactPath& other) const {
+        return start == other.start && length == other.length && bits == other.bits;
+    }
+};
+
+#endif // COMPACTPATH_H
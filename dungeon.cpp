@@ -1,21 +1,85 @@
 #include "dungeon.h"
+#include "dungeonfile.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "solutioncache.h"
+#include "taskpool.h"
+#include "tracer.h"
 #include <random>
 #include <algorithm>
 #include <climits>
-#include <QDebug>
+#include <exception>
+
+namespace {
+
+// 小于该格子数时两次扫描都很快，不值得另开线程
+const size_t PARALLEL_SWEEP_MIN_CELLS = 256 * 1024;
+
+// 与std::seed_seq{low, high}产生完全相同的序列（算法按标准实现），但不在堆上保存种子，
+// 同一种子生成的地图不变，反复生成时也不分配内存
+class SeedPair {
+public:
+    using result_type = uint32_t;
+
+    explicit SeedPair(uint64_t seed) : v{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)} {}
+
+    template <class It>
+    void generate(It begin, It end) const {
+        if (begin == end) {
+            return;
+        }
+        std::fill(begin, end, 0x8b8b8b8bu);
+
+        const size_t n = static_cast<size_t>(end - begin);
+        const size_t s = 2;
+        const size_t t = n >= 623 ? 11 : n >= 68 ? 7 : n >= 39 ? 5 : n >= 7 ? 3 : (n - 1) / 2;
+        const size_t p = (n - t) / 2;
+        const size_t q = p + t;
+        const size_t m = std::max(s + 1, n);
+        auto at = [begin, n](size_t k) -> uint32_t& { return begin[k % n]; };
+        auto mix = [](uint32_t x) { return x ^ (x >> 27); };
+
+        for (size_t k = 0; k < m; ++k) {
+            uint32_t r1 = 1664525u * mix(at(k) ^ at(k + p) ^ at(k + n - 1));
+            uint32_t r2 = r1 + static_cast<uint32_t>(k == 0 ? s : k <= s ? k % n + v[k - 1] : k % n);
+            at(k + p) += r1;
+            at(k + q) += r2;
+            at(k) = r2;
+        }
+        for (size_t k = m; k < m + n; ++k) {
+            uint32_t r3 = 1566083941u * mix(at(k) + at(k + p) + at(k + n - 1));
+            uint32_t r4 = r3 - static_cast<uint32_t>(k % n);
+            at(k + p) ^= r3;
+            at(k + q) ^= r4;
+            at(k) = r4;
+        }
+    }
+
+private:
+    uint32_t v[2];
+};
+
+} // namespace
 
 Dungeon::Dungeon(int rows, int cols)
-    : rows(0), cols(0), playerPos(0, 0), currentHealth(100),
-    initialHealth(100), gameState(GameState::PLAYING) {
+    : rows(0), cols(0), mapData(nullptr), dpData(nullptr), wallDensity(0), seed(0), mapVersion(1),
+    contentVersion(1), solvedVersion(0), pathVersion(0), forwardHealth(100), forwardVersion(0),
+    healthCap(0), movement(MovementMode::RIGHT_DOWN), cacheLookupVersion(0), hashVersion(0),
+    playerPos(0, 0), currentHealth(100),
+    initialHealth(100), gameState(GameState::PLAYING), nextWaypoint(0) {
     try {
         setSize(rows, cols);
     } catch (const std::exception& e) {
-        qDebug() << "Dungeon constructor failed:" << e.what();
+        LOG_WARNING("Dungeon constructor failed: %s", e.what());
         // 设置为默认的安全尺寸
         this->rows = 5;
         this->cols = 5;
-        map.resize(5, std::vector<int>(5, 0));
-        dp.resize(5, std::vector<int>(5, 0));
+        map = arena.ints(25, 0);
+        dp.reset();
+        mapData = map->data();
+        dpData = nullptr;
+        markMapChanged();
+        route = RoutePlan::classic(this->rows, this->cols);
     }
 }
 
@@ -28,9 +92,17 @@ void Dungeon::validateMapSize(int rows, int cols) const {
         throw DungeonException("地图尺寸过大，最大支持100×100");
     }
 
+    validateLoadedMapSize(rows, cols);
+}
+
+void Dungeon::validateLoadedMapSize(int rows, int cols) {
+    if (rows <= 0 || cols <= 0) {
+        throw DungeonException("地图尺寸必须大于0");
+    }
+
     // 检查内存使用量（粗略估计）
     size_t memoryNeeded = static_cast<size_t>(rows) * cols * sizeof(int) * 2; // map + dp
-    if (memoryNeeded > 500 * 1024 * 1024) { // 500MB限制
+    if (memoryNeeded > static_cast<size_t>(500) * 1024 * 1024) { // 500MB限制
         throw DungeonException("地图过大，超出内存限制");
     }
 }
@@ -42,15 +114,22 @@ void Dungeon::setSize(int rows, int cols) {
         this->rows = rows;
         this->cols = cols;
 
-        // 清理现有数据
-        map.clear();
-        dp.clear();
+        // 清理现有数据（包括映射的文件），仍被快照引用的数据由快照继续持有
+        map.reset();
+        dp.reset();
+        mapping.reset();
+        walls.reset();
+        dpData = nullptr;
 
-        // 重新分配内存
-        map.resize(rows, std::vector<int>(cols, 0));
-        dp.resize(rows, std::vector<int>(cols, 0));
+        // 从池中取地图缓冲区，旧的缓冲区不再被快照引用时直接复用
+        map = arena.ints(cellCount(), 0);
+        mapData = map->data();
+        seed = 0;
+        markMapChanged();
+        route = RoutePlan::classic(rows, cols);
+        routeSolver.clear();
 
-        qDebug() << "Map size set to:" << rows << "x" << cols;
+        LOG_DEBUG("Map size set to: %d x %d", rows, cols);
 
     } catch (const std::bad_alloc& e) {
         throw DungeonException("内存分配失败，请尝试更小的地图尺寸");
@@ -61,36 +140,275 @@ void Dungeon::setSize(int rows, int cols) {
     }
 }
 
+void Dungeon::loadMap(int rows, int cols, std::vector<int>&& cells, std::vector<uint64_t>&& wallBits) {
+    try {
+        validateLoadedMapSize(rows, cols);
+
+        if (cells.size() != static_cast<size_t>(rows) * cols) {
+            throw DungeonException("导入的地图尺寸不匹配");
+        }
+        if (!wallBits.empty() && wallBits.size() != WallMask::wordCount(cells.size())) {
+            throw DungeonException("导入的墙壁位图尺寸不匹配");
+        }
+
+        this->rows = rows;
+        this->cols = cols;
+
+        // 直接接管数据，避免复制
+        map = arena.adoptInts(std::move(cells));
+        walls = wallBits.empty() ? nullptr : arena.adoptBits(std::move(wallBits));
+        dp.reset();
+        mapping.reset();
+        mapData = map->data();
+        dpData = nullptr;
+        seed = 0;
+        markMapChanged();
+        route = RoutePlan::classic(rows, cols);
+        routeSolver.clear();
+
+        playerPos = QPoint(0, 0);
+        playerPath.clear();
+        visitedRooms.clear();
+        gameState = GameState::PLAYING;
+        nextWaypoint = 0;
+
+        LOG_INFO("Map loaded: %d x %d", rows, cols);
+
+    } catch (const std::bad_alloc& e) {
+        throw DungeonException("内存分配失败，地图过大");
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("载入地图时发生未知错误: ") + e.what());
+    }
+}
+
+void Dungeon::loadMappedFile(std::shared_ptr<const DungeonFileMapping> file) {
+    try {
+        if (!file) {
+            throw DungeonException("映射文件为空");
+        }
+
+        const DungeonFileHeader& header = file->header();
+        if (header.rows == 0 || header.cols == 0 || header.rows > INT_MAX || header.cols > INT_MAX) {
+            throw DungeonException("文件中的地图尺寸无效");
+        }
+
+        int newRows = static_cast<int>(header.rows);
+        int newCols = static_cast<int>(header.cols);
+        size_t count = static_cast<size_t>(newRows) * newCols;
+
+        std::vector<int> widened;
+        if (header.cellWidth != sizeof(int)) {
+            // 压缩格式需要展开为int，只有4字节格子可以零拷贝
+            widened.resize(count);
+            const uchar* cells = file->cellData();
+            if (header.cellWidth == 1) {
+                const int8_t* src = reinterpret_cast<const int8_t*>(cells);
+                std::copy(src, src + count, widened.begin());
+            } else if (header.cellWidth == 2) {
+                const int16_t* src = reinterpret_cast<const int16_t*>(cells);
+                std::copy(src, src + count, widened.begin());
+            } else {
+                throw DungeonException("不支持的格子宽度");
+            }
+        }
+
+        // 墙壁位图很小，复制一份，之后修改地图时不必再引用映射文件
+        std::shared_ptr<std::vector<uint64_t>> fileWalls;
+        if (file->wallData()) {
+            fileWalls = arena.copyBits(file->wallData(), WallMask::wordCount(count));
+        }
+
+        rows = newRows;
+        cols = newCols;
+        bool zeroCopy = widened.empty();
+        map = zeroCopy ? nullptr : arena.adoptInts(std::move(widened));
+        walls = std::move(fileWalls);
+        dp.reset();
+        mapping = std::move(file);
+
+        mapData = zeroCopy ? reinterpret_cast<const int*>(mapping->cellData()) : map->data();
+        seed = header.seed;
+        markMapChanged();
+        route = RoutePlan::classic(rows, cols);
+        routeSolver.clear();
+
+        // 文件中的dp段是经典规则（不限上限、只向右下走、无次要目标）的结果，只有当前设置相同时才直接使用，
+        // 否则保持未求解，由solveCurrent()按当前设置重新求解
+        dpData = nullptr;
+        if (mapping->dpData() && isClassicProblem() && !usesTieBreaks()) {
+            dpData = mapping->dpData();
+            solvedVersion = mapVersion;
+        }
+
+        playerPos = QPoint(0, 0);
+        playerPath.clear();
+        visitedRooms.clear();
+        gameState = GameState::PLAYING;
+        nextWaypoint = 0;
+
+        LOG_INFO("Mapped map file: %d x %d %s", rows, cols, zeroCopy ? "(zero-copy)" : "(widened)");
+
+    } catch (const std::bad_alloc& e) {
+        throw DungeonException("内存分配失败，地图过大");
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("载入映射文件时发生未知错误: ") + e.what());
+    }
+}
+
+int* Dungeon::writableMap() {
+    // 调用方将修改地图，之前的求解结果全部失效
+    markMapChanged();
+    cachedSnapshot.reset();
+
+    // 写时复制：仍在使用映射文件或数据仍被快照引用时先复制一份
+    bool owned = map && mapData == map->data() && map->size() == cellCount();
+    if (!owned || DungeonArena::isShared(map)) {
+        map = arena.copyInts(mapData, cellCount());
+        mapData = map->data();
+        if (dpData && (!dp || dpData != dp->data())) {
+            dpData = nullptr;
+        }
+        mapping.reset();
+    }
+    return map->data();
+}
+
+uint64_t* Dungeon::writableWalls() {
+    markMapChanged();
+    cachedSnapshot.reset();
+
+    // 写时复制：快照仍引用旧位图时另行分配
+    if (!walls) {
+        walls = arena.bits(WallMask::wordCount(cellCount()), 0);
+    } else if (DungeonArena::isShared(walls)) {
+        walls = arena.copyBits(walls->data(), walls->size());
+    }
+    return walls->data();
+}
+
+std::shared_ptr<const void> Dungeon::ownerOf(const int* data) const {
+    if (map && data == map->data()) {
+        return map;
+    }
+    if (dp && data == dp->data()) {
+        return dp;
+    }
+    if (cachedDp && data == cachedDp->data()) {
+        return cachedDp;
+    }
+    return mapping;
+}
+
+DungeonSnapshotPtr Dungeon::snapshot() const {
+    try {
+        if (cachedSnapshot && cachedSnapshot->version == mapVersion) {
+            return cachedSnapshot;
+        }
+        TRACE_SCOPE("Dungeon::snapshot");
+
+        validateMapData();
+        ensureSolvedWithForward();
+
+        auto result = std::make_shared<DungeonSnapshot>();
+        result->rows = rows;
+        result->cols = cols;
+        result->version = mapVersion;
+        result->seed = seed;
+        result->minHealth = dpData[cellIndex(route.start.y(), route.start.x())];
+        result->path = getOptimalPath();
+        result->route = route;
+
+        // 共享现有数据而不复制，之后修改地图时由writableMap()/initializeDp()另行分配
+        result->map = std::shared_ptr<const int>(ownerOf(mapData), mapData);
+        result->dp = std::shared_ptr<const int>(ownerOf(dpData), dpData);
+        result->walls = walls;
+        result->forwardHealth = forwardHealth;
+        if (!isFourWay()) {
+            result->forward = std::shared_ptr<const int>(forward, forward->data());
+
+            int maxSlack = -1;
+            for (int i = 0; i < rows; ++i) {
+                for (int j = 0; j < cols; ++j) {
+                    maxSlack = std::max(maxSlack, result->getSlack(i, j));
+                }
+            }
+            result->maxSlack = maxSlack;
+        }
+        result->healthCap = healthCap;
+        result->movement = movement;
+        result->objectives = usesTieBreaks() ? objectiveOrder : ObjectiveOrder();
+        if (isClassicProblem() && result->isSolvable()) {
+            // 最优走廊按经典递推计数，自定义路线和健康上限模式以及被墙壁挡住时不提供
+            result->corridor = std::make_shared<OptimalCorridor>(
+                computeOptimalCorridor(mapData, dpData, rows, cols, wallBits(), effectiveCap()));
+        }
+
+        // 按当前地图的数据量统计（与是否来自映射文件或求解缓存无关）
+        uint64_t tableBytes = static_cast<uint64_t>(cellCount()) * sizeof(int);
+        uint64_t overlayBytes = (result->forward ? tableBytes : 0) +
+                                (walls ? walls->size() * sizeof(uint64_t) : 0) +
+                                (result->corridor ? result->corridor->bits.size() * sizeof(uint64_t) : 0);
+        PerfMetrics::instance().recordMemory(tableBytes, tableBytes, overlayBytes);
+        DungeonArena::Usage arenaUsage = arena.usage();
+        PerfMetrics::instance().recordArena(arenaUsage.currentBytes, arenaUsage.peakBytes);
+
+        cachedSnapshot = result;
+        return result;
+
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("创建快照失败: ") + e.what());
+    }
+}
+
 void Dungeon::validateMapData() const {
-    if (map.empty() || dp.empty()) {
+    if (!mapData || rows <= 0 || cols <= 0) {
         throw DungeonException("地图数据未初始化");
     }
 
-    if (static_cast<int>(map.size()) != rows || static_cast<int>(dp.size()) != rows) {
-        throw DungeonException("地图行数不匹配");
+    if (map && mapData == map->data() && map->size() != cellCount()) {
+        throw DungeonException("地图尺寸不匹配");
     }
 
-    for (int i = 0; i < rows; ++i) {
-        if (static_cast<int>(map[i].size()) != cols || static_cast<int>(dp[i].size()) != cols) {
-            throw DungeonException("地图列数不匹配");
-        }
+    if (dp && dpData == dp->data() && dp->size() != cellCount()) {
+        throw DungeonException("DP表尺寸不匹配");
+    }
+
+    if (walls && walls->size() != WallMask::wordCount(cellCount())) {
+        throw DungeonException("墙壁位图尺寸不匹配");
     }
 }
 
 void Dungeon::generateMap() {
+    std::random_device rd;
+    generateMap((static_cast<uint64_t>(rd()) << 32) | rd());
+}
+
+void Dungeon::generateMap(uint64_t seed) {
+    TRACE_SCOPE("Dungeon::generateMap");
     try {
         validateMapData();
+        uint64_t generateStart = PerfMetrics::now();
 
-        std::random_device rd;
-        std::mt19937 gen(rd());
+        SeedPair seq(seed);
+        std::mt19937 gen(seq);
+        this->seed = seed;
+        int* cells = writableMap();
+        walls.reset();
 
         bool hasSolution = false;
         int attempts = 0;
         int maxAttempts = (rows * cols > 1000) ? 10 : 100; // 大地图减少尝试次数
 
-        qDebug() << "Generating map with" << maxAttempts << "max attempts";
+        LOG_DEBUG("Generating map with %d max attempts", maxAttempts);
 
         while (!hasSolution && attempts < maxAttempts) {
+            TRACE_SCOPE("Dungeon::generateMap attempt");
             try {
                 // 根据地图大小调整随机数范围
                 int mapSize = rows * cols;
@@ -113,37 +431,55 @@ void Dungeon::generateMap() {
                 std::uniform_int_distribution<> dis(minVal, maxVal);
 
                 // 生成随机地图
-                for (int i = 0; i < rows; ++i) {
-                    for (int j = 0; j < cols; ++j) {
-                        map[i][j] = dis(gen);
+                for (size_t k = 0; k < cellCount(); ++k) {
+                    cells[k] = dis(gen);
+                }
+
+                // 按比例随机放置墙壁，路线上的格子保持为空地；比例为0时不消耗随机数，同一种子得到的地图不变
+                if (wallDensity > 0) {
+                    generateWalls(gen);
+                    if (!isRouteOpen(route, wallBits(), rows, cols)) {
+                        LOG_DEBUG("Map generation attempt %d blocked by walls", attempts);
+                        attempts++;
+                        continue;
                     }
                 }
 
                 // 检查是否有解
                 initializeDp();
+                uint64_t solveStart = PerfMetrics::now();
                 solveDp();
+                PerfMetrics::instance().recordSolve(PerfMetrics::now() - solveStart, cellCount());
 
                 // 检查最小健康值是否在合理范围内
-                int minHealth = dp[0][0];
+                int minHealth = dpData[0];
                 int reasonableMax = (mapSize > 1000) ? mapSize : mapSize * 2;
 
-                if (minHealth > 0 && minHealth <= reasonableMax) {
+                // 自定义路线或四向移动时经典递推不代表实际路线，墙壁挡住经典路线也可以接受（上面已确认路线走得通）
+                bool blockedElsewhere = minHealth == INT_MAX && walls && (!isClassicRoute() || isFourWay());
+
+                if (blockedElsewhere || (minHealth > 0 && minHealth <= reasonableMax)) {
                     hasSolution = true;
-                    qDebug() << "Map generation successful, attempts:" << attempts + 1;
+                    if (isClassicRoute() && !isFourWay() && !usesTieBreaks() && !blockedElsewhere) {
+                        solvedVersion = mapVersion;  // dp已对应最终地图，后续查询无需再求解
+                        rememberSolution();
+                    }
+                    LOG_INFO("Map generation successful, attempts: %d", attempts + 1);
                 }
 
             } catch (const std::exception& e) {
-                qDebug() << "Map generation attempt" << attempts << "failed:" << e.what();
+                LOG_DEBUG("Map generation attempt %d failed: %s", attempts, e.what());
             }
 
             attempts++;
         }
 
-        // 如果多次尝试仍无合理解，生成简单的可解地图
+        // 如果多次尝试仍无合理解，生成简单的可解地图（不含墙壁）
         if (!hasSolution) {
-            qDebug() << "Using fallback map generation";
+            LOG_WARNING("Using fallback map generation");
             generateFallbackMap();
         }
+        PerfMetrics::instance().recordGenerate(PerfMetrics::now() - generateStart, static_cast<uint32_t>(attempts));
 
     } catch (const DungeonException& e) {
         throw;
@@ -152,47 +488,76 @@ void Dungeon::generateMap() {
     }
 }
 
+void Dungeon::generateWalls(std::mt19937& gen) {
+    std::bernoulli_distribution wallDis(wallDensity / 100.0);
+    auto bits = arena.bits(WallMask::wordCount(cellCount()), 0);
+
+    for (size_t k = 0; k < cellCount(); ++k) {
+        if (wallDis(gen)) {
+            WallMask::setWall(bits->data(), k, true);
+        }
+    }
+
+    // 起点、路点和公主格子不能是墙
+    auto keepOpen = [this, &bits](const QPoint& p) { WallMask::setWall(bits->data(), cellIndex(p.y(), p.x()), false); };
+    keepOpen(route.start);
+    std::for_each(route.waypoints.begin(), route.waypoints.end(), keepOpen);
+    std::for_each(route.targets.begin(), route.targets.end(), keepOpen);
+
+    walls = std::move(bits);
+}
+
 void Dungeon::generateFallbackMap() {
     try {
         validateMapData();
+        int* cells = writableMap();
+        walls.reset();
 
         // 生成一个保证有解的简单地图
         for (int i = 0; i < rows; ++i) {
             for (int j = 0; j < cols; ++j) {
                 // 使用简单的模式确保可解性
+                int& cell = cells[cellIndex(i, j)];
                 if ((i + j) % 4 == 0) {
-                    map[i][j] = 1;  // 偶尔的增益
+                    cell = 1;  // 偶尔的增益
                 } else if ((i + j) % 4 == 3) {
-                    map[i][j] = -1; // 偶尔的伤害
+                    cell = -1; // 偶尔的伤害
                 } else {
-                    map[i][j] = 0;  // 大部分中性
+                    cell = 0;  // 大部分中性
                 }
             }
         }
 
-        qDebug() << "Fallback map generated successfully";
+
+        LOG_INFO("Fallback map generated successfully");
 
     } catch (const std::exception& e) {
         throw DungeonException(std::string("生成后备地图失败: ") + e.what());
     }
 }
 
-void Dungeon::initializeDp() {
+void Dungeon::initializeDp() const {
     try {
         validateMapData();
 
-        for (int i = 0; i < rows; ++i) {
-            for (int j = 0; j < cols; ++j) {
-                dp[i][j] = INT_MAX;
-            }
+        // DP表只写入自有内存，映射文件中的dp段和快照引用的旧表保持不变
+        cachedSnapshot.reset();
+        cachedDp.reset();
+        if (!dp || DungeonArena::isShared(dp) || dp->size() != cellCount()) {
+            dp.reset();
+            dp = arena.ints(cellCount(), INT_MAX);
+        } else {
+            std::fill(dp->begin(), dp->end(), INT_MAX);
         }
+        dpData = dp->data();
 
     } catch (const std::exception& e) {
         throw DungeonException(std::string("初始化DP表失败: ") + e.what());
     }
 }
 
-void Dungeon::solveDp() {
+void Dungeon::solveDp() const {
+    TRACE_SCOPE("Dungeon::solveDp");
     try {
         validateMapData();
 
@@ -200,33 +565,50 @@ void Dungeon::solveDp() {
             throw DungeonException("地图尺寸为0，无法计算DP");
         }
 
+        if (!dp || dp->size() != cellCount()) {
+            throw DungeonException("DP表未初始化");
+        }
+
+        // 健康上限下超过上限的格子不可行（INT_MAX），不限时与经典递推相同
+        int cap = effectiveCap();
+
+        // 墙壁格子按掩码置为INT_MAX，之后的格子经neededHealth自然不会选它；没有墙壁时走原来的循环
+        const uint64_t* wallMask = wallBits();
+        auto block = [wallMask](int need, size_t k) {
+            return WallMask::masked(need, WallMask::isWall(wallMask, k), INT_MAX);
+        };
+
         // 初始化最后一个位置
-        dp[rows-1][cols-1] = std::max(1, 1 - map[rows-1][cols-1]);
+        int* last = dp->data() + cellIndex(rows-1, 0);
+        const int* lastMap = getMapRow(rows-1);
+        last[cols-1] = block(neededHealth(1, lastMap[cols-1], cap), cellIndex(rows-1, cols-1));
 
         // 填充最后一行
         for (int j = cols - 2; j >= 0; --j) {
-            if (j + 1 >= cols) {
-                throw DungeonException("列索引越界");
-            }
-            dp[rows-1][j] = std::max(1, dp[rows-1][j+1] - map[rows-1][j]);
+            last[j] = block(neededHealth(last[j+1], lastMap[j], cap), cellIndex(rows-1, j));
         }
 
-        // 填充最后一列
+        // 逐行向上填充，每行只依赖下一行
         for (int i = rows - 2; i >= 0; --i) {
-            if (i + 1 >= rows) {
-                throw DungeonException("行索引越界");
+            int* row = dp->data() + cellIndex(i, 0);
+            const int* below = row + cols;
+            const int* mapRow = getMapRow(i);
+
+            // 最后一列只能向下
+            row[cols-1] = block(neededHealth(below[cols-1], mapRow[cols-1], cap), cellIndex(i, cols-1));
+
+            if (!wallMask) {
+                for (int j = cols - 2; j >= 0; --j) {
+                    row[j] = neededHealth(std::min(below[j], row[j+1]), mapRow[j], cap);
+                }
+                continue;
             }
-            dp[i][cols-1] = std::max(1, dp[i+1][cols-1] - map[i][cols-1]);
-        }
 
-        // 填充剩余位置
-        for (int i = rows - 2; i >= 0; --i) {
+            size_t base = cellIndex(i, 0);
             for (int j = cols - 2; j >= 0; --j) {
-                if (i + 1 >= rows || j + 1 >= cols) {
-                    throw DungeonException("DP计算时索引越界");
-                }
-                int minHealth = std::min(dp[i+1][j], dp[i][j+1]);
-                dp[i][j] = std::max(1, minHealth - map[i][j]);
+                size_t k = base + j;
+                bool wall = (wallMask[k >> 6] >> (k & 63)) & 1;
+                row[j] = WallMask::masked(neededHealth(std::min(below[j], row[j+1]), mapRow[j], cap), wall, INT_MAX);
             }
         }
 
@@ -237,68 +619,416 @@ void Dungeon::solveDp() {
     }
 }
 
-int Dungeon::calculateMinHealth() {
-    try {
+void Dungeon::ensureSolved() const {
+    if (isSolved()) {
+        return;
+    }
+    TRACE_SCOPE("Dungeon::ensureSolved");
+
+    uint64_t start = PerfMetrics::now();
+    solveCurrent();
+    PerfMetrics::instance().recordSolve(PerfMetrics::now() - start, cellCount());
+}
+
+void Dungeon::solveCurrent() const {
+    // 四向移动用桶队列求解，不查缓存
+    if (isFourWay()) {
         initializeDp();
-        solveDp();
+        fourWaySolver.solve(mapData, wallBits(), rows, cols, route.targets, dp->data());
+        solvedVersion = mapVersion;
+        return;
+    }
+
+    // 自定义路线分段求解，未变化的段直接复用
+    if (!isClassicRoute()) {
+        initializeDp();
+        routeSolver.solve(mapData, wallBits(), rows, cols, contentVersion, route, effectiveCap(), dp->data());
+        solvedVersion = mapVersion;
+        return;
+    }
+
+    // 有次要目标时一次打包扫描同时求出dp和回溯方向，路径与缓存中的不同，不查缓存
+    if (usesTieBreaks()) {
+        initializeDp();
+        lexSolver.solve(mapData, wallBits(), rows, cols, objectiveOrder, dp->data());
+        solvedVersion = mapVersion;
+        return;
+    }
+
+    // 相同地图之前求解过时直接使用缓存的DP表（健康上限模式下不查缓存）
+    lookupCache();
+    if (isSolved()) {
+        return;
+    }
+
+    initializeDp();
+    solveDp();
+    solvedVersion = mapVersion;
+    rememberSolution();
+}
+
+void Dungeon::ensureSolvedWithForward() const {
+    validateMapData();
+    if (isFourWay()) {
+        ensureSolved();  // 四向移动不计算正向表
+        return;
+    }
+
+    int* out = prepareForward();
+    if (!out) {
+        ensureSolved();
+        return;
+    }
+
+    // 正向和反向扫描互不依赖，大地图上正向扫描作为任务池中的任务与反向求解同时进行。
+    // 任务只读取地图并写入out，不触碰其他成员。
+    if (!isSolved() && cellCount() >= PARALLEL_SWEEP_MIN_CELLS) {
+        TaskGroup forwardTask(TaskPriority::High);
+        forwardTask.run([this, out]() { solveForward(out); });
+
+        try {
+            ensureSolved();
+        } catch (...) {
+            try {
+                forwardTask.wait();
+            } catch (...) {
+                // 以反向求解的异常为准
+            }
+            throw;
+        }
+        forwardTask.wait();
+    } else {
+        ensureSolved();
+        solveForward(out);
+    }
+
+    forwardVersion = mapVersion;
+}
+
+int* Dungeon::prepareForward() const {
+    if (forward && forwardVersion == mapVersion) {
+        return nullptr;
+    }
+
+    // 旧表可能仍被快照引用，此时另行分配
+    if (!forward || DungeonArena::isShared(forward) || forward->size() != cellCount()) {
+        forward.reset();
+        forward = arena.ints(cellCount(), 0);
+    }
+    return forward->data();
+}
+
+void Dungeon::solveForward(int* out) const {
+    TRACE_SCOPE("Dungeon::solveForward");
+    try {
+        // 调用方已校验地图；这里不读取dp相关成员，反向求解可以同时进行
+        if (!isClassicRoute()) {
+            solveRouteForward(mapData, wallBits(), rows, cols, route, forwardHealth, effectiveCap(), out);
+            return;
+        }
+
+        // 墙壁格子无法到达，按掩码置0，之后的格子从它离开时也是0
+        const uint64_t* wallMask = wallBits();
+
+        // 第一行只能从左边到达
+        int cap = effectiveCap();
+        const int* mapRow = getMapRow(0);
+        out[0] = WallMask::masked(std::max(0, std::min(forwardHealth, cap)), WallMask::isWall(wallMask, 0), 0);
+        for (int j = 1; j < cols; ++j) {
+            out[j] = WallMask::masked(leaveHealth(out[j-1], mapRow[j-1], cap), WallMask::isWall(wallMask, j), 0);
+        }
+
+        // 逐行向下填充，每行只依赖上一行
+        for (int i = 1; i < rows; ++i) {
+            int* row = out + cellIndex(i, 0);
+            const int* above = row - cols;
+            const int* aboveMap = getMapRow(i-1);
+            mapRow = getMapRow(i);
+            size_t base = cellIndex(i, 0);
+
+            row[0] = WallMask::masked(leaveHealth(above[0], aboveMap[0], cap), WallMask::isWall(wallMask, base), 0);
+            for (int j = 1; j < cols; ++j) {
+                int best = std::max(leaveHealth(above[j], aboveMap[j], cap), leaveHealth(row[j-1], mapRow[j-1], cap));
+                row[j] = WallMask::masked(best, WallMask::isWall(wallMask, base + j), 0);
+            }
+        }
 
-        if (dp.empty() || dp[0].empty()) {
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("正向DP计算失败: ") + e.what());
+    }
+}
+
+void Dungeon::setForwardHealth(int initialHealth) {
+    if (initialHealth <= 0) {
+        throw DungeonException("初始健康值必须大于0");
+    }
+    if (initialHealth != forwardHealth) {
+        forwardHealth = initialHealth;
+        forwardVersion = 0;
+        cachedSnapshot.reset();
+    }
+}
+
+void Dungeon::setSolutionCache(std::shared_ptr<SolutionCache> cache) {
+    solutionCache = std::move(cache);
+    cacheHit.reset();
+    cacheLookupVersion = 0;
+}
+
+MapHash Dungeon::getMapHash() const {
+    // 哈希只取决于地图内容，改变路线不需要重新计算
+    if (hashVersion != contentVersion) {
+        validateMapData();
+        mapHash = hashMap(mapData, rows, cols, wallBits());
+        hashVersion = contentVersion;
+    }
+    return mapHash;
+}
+
+std::shared_ptr<const CachedSolution> Dungeon::lookupCache() const {
+    if (!solutionCache || !isClassicProblem() || usesTieBreaks()) {
+        return nullptr;
+    }
+    if (cacheLookupVersion == mapVersion) {
+        return cacheHit;
+    }
+
+    cacheHit = solutionCache->lookup(getMapHash(), rows, cols);
+    cacheLookupVersion = mapVersion;
+
+    if (cacheHit) {
+        if (pathVersion != mapVersion) {
+            cachedPath = cacheHit->path.toPoints();
+            pathVersion = mapVersion;
+        }
+        if (!isSolved() && cacheHit->dp && cacheHit->dp->size() == cellCount()) {
+            cachedSnapshot.reset();
+            cachedDp = cacheHit->dp;
+            dpData = cachedDp->data();
+            solvedVersion = mapVersion;
+        }
+    }
+
+    return cacheHit;
+}
+
+void Dungeon::rememberSolution() const {
+    if (!solutionCache || !isSolved() || !isClassicProblem() || usesTieBreaks()) {
+        return;
+    }
+
+    try {
+        if (pathVersion != mapVersion) {
+            tracePath();
+        }
+
+        auto solution = std::make_shared<CachedSolution>();
+        solution->rows = rows;
+        solution->cols = cols;
+        solution->minHealth = dpData[0];
+        solution->path = CompactPath::fromPoints(cachedPath);
+        if (solutionCache->storesDp() && dp && dpData == dp->data()) {
+            solution->dp = dp;  // 与Dungeon共享，Dungeon下次求解时会另行分配
+        }
+
+        solutionCache->insert(getMapHash(), solution);
+        cacheHit = solution;
+        cacheLookupVersion = mapVersion;
+
+    } catch (const std::exception& e) {
+        // 写缓存失败不影响求解结果
+        LOG_WARNING("rememberSolution failed: %s", e.what());
+    }
+}
+
+int Dungeon::calculateMinHealth() const {
+    try {
+        // 缓存中只有结果没有DP表时也可直接返回
+        if (!isSolved()) {
+            auto hit = lookupCache();
+            if (hit) {
+                return hit->minHealth;
+            }
+        }
+
+        ensureSolved();
+
+        if (!dpData) {
             throw DungeonException("DP表为空");
         }
 
-        return dp[0][0];
+        return dpData[cellIndex(route.start.y(), route.start.x())];
 
     } catch (const DungeonException& e) {
-        qDebug() << "calculateMinHealth failed:" << e.what();
+        LOG_WARNING("calculateMinHealth failed: %s", e.what());
         throw;
     } catch (const std::exception& e) {
-        qDebug() << "calculateMinHealth unexpected error:" << e.what();
+        LOG_ERROR("calculateMinHealth unexpected error: %s", e.what());
         throw DungeonException(std::string("计算最小健康值失败: ") + e.what());
     }
 }
 
-std::vector<QPoint> Dungeon::getOptimalPath() {
+const std::vector<QPoint>& Dungeon::getOptimalPath() const {
+    TRACE_SCOPE("Dungeon::getOptimalPath");
     try {
         validateMapData();
 
-        // 确保DP表已计算
-        if (dp.empty() || dp[0].empty() || dp[0][0] == INT_MAX) {
-            calculateMinHealth();
+        if (pathVersion != mapVersion) {
+            lookupCache();
         }
 
-        std::vector<QPoint> path;
-        int i = 0, j = 0;
+        if (pathVersion != mapVersion) {
+            // 确保DP表已计算（求解后写缓存时可能已回溯过路径）
+            ensureSolved();
+            if (pathVersion != mapVersion) {
+                tracePath();
+            }
+            PerfMetrics::instance().recordPathLength(cachedPath.size());
+        }
 
-        while (i < rows && j < cols) {
-            path.push_back(QPoint(j, i));
+        return cachedPath;
 
-            if (i == rows - 1) {
-                // 只能向右
-                j++;
-            } else if (j == cols - 1) {
-                // 只能向下
-                i++;
-            } else {
-                // 检查边界
-                if (i + 1 >= rows || j + 1 >= cols) {
-                    throw DungeonException("路径计算时索引越界");
-                }
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("计算最优路径失败: ") + e.what());
+    }
+}
 
-                // 选择dp值更小的方向
-                if (dp[i+1][j] <= dp[i][j+1]) {
-                    i++;
-                } else {
-                    j++;
-                }
-            }
+std::vector<RankedPath> Dungeon::getTopKPaths(int k) const {
+    try {
+        if (k <= 0) {
+            throw DungeonException("路径条数必须大于0");
+        }
+        if (!isClassicProblem()) {
+            throw DungeonException("自定义路线和健康上限模式暂不支持枚举前K条路径");
         }
 
-        return path;
+        validateMapData();
+        ensureSolved();
+
+        return enumerateTopPaths(mapData, dpData, rows, cols, k);
 
     } catch (const DungeonException& e) {
         throw;
     } catch (const std::exception& e) {
-        throw DungeonException(std::string("计算最优路径失败: ") + e.what());
+        throw DungeonException(std::string("枚举前K条路径失败: ") + e.what());
+    }
+}
+
+void Dungeon::tracePath() const {
+    TRACE_SCOPE("Dungeon::tracePath");
+    try {
+        if (dpData[cellIndex(route.start.y(), route.start.x())] == INT_MAX) {
+            cachedPath.assign(1, route.start);     // 没有可行路线（被墙壁挡住或超出健康上限）
+        } else if (isFourWay()) {
+            cachedPath = fourWaySolver.tracePath(mapData, wallBits(), dpData, route.start);
+        } else if (usesTieBreaks()) {
+            cachedPath = lexSolver.tracePath();
+        } else {
+            traceRoute(dpData, rows, cols, route, route.start, 0, cachedPath);
+        }
+        pathVersion = mapVersion;
+
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("回溯最优路径失败: ") + e.what());
+    }
+}
+
+void Dungeon::setHealthCap(int cap) {
+    if (cap < 0) {
+        throw DungeonException("健康上限不能为负数");
+    }
+    if (cap > 0 && isFourWay()) {
+        throw DungeonException("四向移动模式不支持健康上限");
+    }
+    if (cap != healthCap) {
+        // 与改变路线相同，只使求解结果失效
+        healthCap = cap;
+        ++mapVersion;
+        cachedSnapshot.reset();
+        LOG_DEBUG("Health cap set to: %d", cap);
+    }
+}
+
+void Dungeon::setWall(int row, int col, bool wall) {
+    if (row < 0 || row >= rows || col < 0 || col >= cols) {
+        throw DungeonException("墙壁位置超出地图范围");
+    }
+    if (isWall(row, col) != wall) {
+        WallMask::setWall(writableWalls(), cellIndex(row, col), wall);
+        LOG_DEBUG("Wall %s %d %d", wall ? "added at" : "removed at", row, col);
+    }
+}
+
+void Dungeon::setWallDensity(int percent) {
+    if (percent < 0 || percent > 40) {
+        throw DungeonException("墙壁比例必须在0~40%之间");
+    }
+    wallDensity = percent;
+}
+
+void Dungeon::setObjectiveOrder(const ObjectiveOrder& order) {
+    try {
+        order.validate();
+        if (order == objectiveOrder) {
+            return;
+        }
+
+        // 与改变路线相同，只使求解结果失效
+        objectiveOrder = order;
+        ++mapVersion;
+        cachedSnapshot.reset();
+        LOG_DEBUG("Objective order set to: %s", order.toString().c_str());
+
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("设置优化目标失败: ") + e.what());
+    }
+}
+
+void Dungeon::setMovementMode(MovementMode mode) {
+    if (mode == movement) {
+        return;
+    }
+    if (mode == MovementMode::FOUR_WAY && healthCap > 0) {
+        throw DungeonException("四向移动模式不支持健康上限");
+    }
+    if (mode == MovementMode::FOUR_WAY && !route.waypoints.empty()) {
+        throw DungeonException("四向移动模式不支持路点");
+    }
+
+    // 与改变路线相同，只使求解结果失效
+    movement = mode;
+    ++mapVersion;
+    cachedSnapshot.reset();
+    LOG_DEBUG("Movement mode set to: %s", mode == MovementMode::FOUR_WAY ? "four-way" : "right/down");
+}
+
+void Dungeon::setRoute(const RoutePlan& plan) {
+    try {
+        validateRoute(plan, rows, cols);
+        if (isFourWay() && !plan.waypoints.empty()) {
+            throw DungeonException("四向移动模式不支持路点");
+        }
+        if (plan == route) {
+            return;
+        }
+
+        // 只使求解结果失效，地图内容版本不变，未受影响的路线段和地图哈希可以复用
+        route = plan;
+        ++mapVersion;
+        cachedSnapshot.reset();
+
+        LOG_DEBUG("Route set: %zu waypoints, %zu targets", route.waypoints.size(), route.targets.size());
+
+    } catch (const DungeonException& e) {
+        throw;
+    } catch (const RouteException& e) {
+        throw DungeonException(e.what());
+    } catch (const std::exception& e) {
+        throw DungeonException(std::string("设置路线失败: ") + e.what());
     }
 }
 
@@ -311,14 +1041,16 @@ void Dungeon::resetGame(int initialHealth) {
         }
 
         this->initialHealth = initialHealth;
-        this->currentHealth = initialHealth;
-        this->playerPos = QPoint(0, 0);
+        this->currentHealth = std::min(initialHealth, effectiveCap());
+        this->playerPos = route.start;
         this->gameState = GameState::PLAYING;
+        this->nextWaypoint = 0;
         this->playerPath.clear();
-        this->playerPath.push_back(QPoint(0, 0));
+        this->playerPath.push_back(route.start);
+        this->visitedRooms.assign(WallMask::wordCount(cellCount()), 0);
 
         // 应用起始位置的效果
-        currentHealth += map[0][0];
+        enterRoom(route.start);
         updateGameState();
 
     } catch (const DungeonException& e) {
@@ -338,6 +1070,16 @@ bool Dungeon::canMove(int dx, int dy) const {
             return false;
         }
 
+        // 只能向右下走时不能后退
+        if (!isFourWay() && (dx < 0 || dy < 0)) {
+            return false;
+        }
+
+        // 不能走进墙壁
+        if (isWall(newY, newX)) {
+            return false;
+        }
+
         // 检查游戏状态
         if (gameState != GameState::PLAYING) {
             return false;
@@ -346,7 +1088,7 @@ bool Dungeon::canMove(int dx, int dy) const {
         return true;
 
     } catch (const std::exception& e) {
-        qDebug() << "canMove error:" << e.what();
+        LOG_WARNING("canMove error: %s", e.what());
         return false; // 出错时不允许移动
     }
 }
@@ -373,7 +1115,7 @@ bool Dungeon::movePlayer(int dx, int dy) {
         playerPath.push_back(playerPos);
 
         // 应用房间效果
-        currentHealth += map[newY][newX];
+        enterRoom(playerPos);
 
         // 更新游戏状态
         updateGameState();
@@ -381,26 +1123,59 @@ bool Dungeon::movePlayer(int dx, int dy) {
         return true;
 
     } catch (const DungeonException& e) {
-        qDebug() << "movePlayer failed:" << e.what();
+        LOG_WARNING("movePlayer failed: %s", e.what());
         return false;
     } catch (const std::exception& e) {
-        qDebug() << "movePlayer unexpected error:" << e.what();
+        LOG_ERROR("movePlayer unexpected error: %s", e.what());
         return false;
     }
 }
 
+void Dungeon::enterRoom(const QPoint& pos) {
+    // 四向移动时每个房间只在第一次进入时生效，在两个增益房间之间来回走不能回血
+    if (isFourWay()) {
+        size_t k = cellIndex(pos.y(), pos.x());
+        if (visitedRooms.size() != WallMask::wordCount(cellCount())) {
+            visitedRooms.assign(WallMask::wordCount(cellCount()), 0);
+        }
+        if (WallMask::isWall(visitedRooms.data(), k)) {
+            return;
+        }
+        WallMask::setWall(visitedRooms.data(), k, true);
+    }
+
+    long long health = static_cast<long long>(currentHealth) + getCell(pos.y(), pos.x());
+    currentHealth = static_cast<int>(std::min<long long>(health, effectiveCap()));
+}
+
 void Dungeon::updateGameState() {
     try {
+        while (nextWaypoint < route.waypoints.size() && route.waypoints[nextWaypoint] == playerPos) {
+            nextWaypoint++;
+        }
+
+        // 只能向右下移动时，越过下一个路点、所有公主格子都在身后或右下都是墙壁就已不可能获胜
+        QPoint limit = legLimit(route, rows, cols, nextWaypoint);
+        bool allVisited = nextWaypoint == route.waypoints.size();
+        bool targetAhead = std::any_of(route.targets.begin(), route.targets.end(), [this](const QPoint& t) {
+            return t.x() >= playerPos.x() && t.y() >= playerPos.y();
+        });
+        auto open = [this](int x, int y) { return x < cols && y < rows && !isWall(y, x); };
+        bool stuck = !open(playerPos.x() + 1, playerPos.y()) && !open(playerPos.x(), playerPos.y() + 1);
+
         if (currentHealth <= 0) {
             gameState = GameState::LOST;
-        } else if (playerPos.x() == cols - 1 && playerPos.y() == rows - 1) {
+        } else if (allVisited && route.isTarget(playerPos)) {
             gameState = GameState::WON;
+        } else if (!isFourWay() &&
+                   (playerPos.x() > limit.x() || playerPos.y() > limit.y() || (allVisited && !targetAhead) || stuck)) {
+            gameState = GameState::LOST;
         } else {
             gameState = GameState::PLAYING;
         }
 
     } catch (const std::exception& e) {
-        qDebug() << "updateGameState error:" << e.what();
+        LOG_WARNING("updateGameState error: %s", e.what());
         gameState = GameState::LOST; // 出错时设为失败状态
     }
 }
@@ -2,8 +2,24 @@
 #define DUNGEON_H
 
 #include <vector>
+#include <memory>
+#include <cstdint>
+#include <climits>
+#include <random>
 #include <QPoint>
 #include <stdexcept>
+#include "dungeonarena.h"
+#include "dungeonsnapshot.h"
+#include "maphash.h"
+#include "routeplan.h"
+#include "fourwaysolver.h"
+#include "lexicographicsolver.h"
+#include "toppaths.h"
+#include "wallmask.h"
+
+class DungeonFileMapping;
+class SolutionCache;
+struct CachedSolution;
 
 enum class GameMode {
     AUTO,   // 自动模式
@@ -27,12 +43,33 @@ public:
 
     // 生成随机地图
     void generateMap();
+    void generateMap(uint64_t seed);  // 使用指定种子生成，相同种子得到相同地图
 
-    // 计算最小初始健康点数（自动模式用）
-    int calculateMinHealth();
+    // 计算最小初始健康点数（自动模式用），结果按地图版本缓存；健康上限下无可行路线时返回INT_MAX
+    int calculateMinHealth() const;
 
-    // 获取最优路径（自动模式用）
-    std::vector<QPoint> getOptimalPath();
+    // 获取最优路径（自动模式用），结果按地图版本缓存，返回的引用在地图或路线下次变化前有效
+    const std::vector<QPoint>& getOptimalPath() const;
+
+    // 所需初始健康值最小的前k条路径，按健康值从小到大排列
+    std::vector<RankedPath> getTopKPaths(int k) const;
+
+    // 健康上限：房间效果生效后健康值不超过上限，0表示不限。求解、正向DP和手动模式都按上限计算
+    void setHealthCap(int cap);
+    int getHealthCap() const { return healthCap; }
+
+    // 移动方式：四向移动时手动模式中每个房间只在第一次进入时生效，求解（最小健康值、最优路径）
+    // 按每次进入都生效计算；不支持路点和健康上限
+    void setMovementMode(MovementMode mode);
+    MovementMode getMovementMode() const { return movement; }
+
+    // 优化目标顺序：所需初始健康值相同时依次比较的次要目标，只用于只向右下走、不限上限的经典路线
+    void setObjectiveOrder(const ObjectiveOrder& order);
+    const ObjectiveOrder& getObjectiveOrder() const { return objectiveOrder; }
+
+    // 路线：起点、依次经过的路点和候选公主格子，改变地图尺寸或载入地图后恢复为经典路线
+    void setRoute(const RoutePlan& plan);
+    const RoutePlan& getRoute() const { return route; }
 
     // 手动模式相关
     void resetGame(int initialHealth = 100);
@@ -43,34 +80,142 @@ public:
     GameState getGameState() const { return gameState; }
     QPoint getPlayerPosition() const { return playerPos; }
     int getCurrentHealth() const { return currentHealth; }
+    int getInitialHealth() const { return initialHealth; }
     const std::vector<QPoint>& getPlayerPath() const { return playerPath; }
+    size_t getNextWaypoint() const { return nextWaypoint; }  // 尚未经过的第一个路点
+
+    // 获取地图数据（行优先存放，可能直接指向只读映射的文件）
+    int getCell(int row, int col) const { return mapData[cellIndex(row, col)]; }
+    const int* getMapRow(int row) const { return mapData + cellIndex(row, 0); }
+
+    // 墙壁：不能进入的格子，求解时视为不可行。修改墙壁与修改地图内容一样使求解结果失效
+    bool isWall(int row, int col) const { return WallMask::isWall(wallBits(), cellIndex(row, col)); }
+    void setWall(int row, int col, bool wall);
+    const uint64_t* getWallBits() const { return wallBits(); }
+
+    // 生成地图时墙壁所占的百分比（0~40），生成的地图保证路线可达
+    void setWallDensity(int percent);
+    int getWallDensity() const { return wallDensity; }
+
+    // 获取DP表数据，当前地图未求解时isSolved()为false
+    bool isSolved() const { return dpData != nullptr && solvedVersion == mapVersion; }
+    int getDpValue(int row, int col) const { return dpData[cellIndex(row, col)]; }
+    const int* getDpRow(int row) const { return dpData + cellIndex(row, 0); }
 
-    // 获取地图数据
-    const std::vector<std::vector<int>>& getMap() const { return map; }
-    const std::vector<std::vector<int>>& getDpTable() const { return dp; }
+    // 生成种子（导入的地图为0）
+    uint64_t getSeed() const { return seed; }
+
+    // 地图版本，地图内容或路线每次变化都会递增
+    uint64_t getMapVersion() const { return mapVersion; }
+
+    // 当前地图的不可变快照（必要时先求解），同一版本返回同一快照
+    DungeonSnapshotPtr snapshot() const;
+
+    // 正向DP所用的初始健康值，快照中的正向表和每格余量都以它为准
+    void setForwardHealth(int initialHealth);
+    int getForwardHealth() const { return forwardHealth; }
+
+    // 求解结果缓存：设置后求解前先按地图哈希查找，求解后写回
+    void setSolutionCache(std::shared_ptr<SolutionCache> cache);
+    std::shared_ptr<SolutionCache> getSolutionCache() const { return solutionCache; }
+    MapHash getMapHash() const;
 
     // 设置地图尺寸
     void setSize(int rows, int cols);
 
+    // 载入外部地图数据（导入用，行优先存放，尺寸不受生成上限限制），wallBits为空表示没有墙壁
+    void loadMap(int rows, int cols, std::vector<int>&& cells, std::vector<uint64_t>&& wallBits = {});
+    static void validateLoadedMapSize(int rows, int cols);
+
+    // 直接使用只读映射的二进制地图文件，不复制地图数据
+    void loadMappedFile(std::shared_ptr<const DungeonFileMapping> file);
+    bool isMapped() const { return mapping != nullptr; }
+
+    // 缓冲区池的当前、使用中和峰值内存
+    DungeonArena::Usage getArenaUsage() const { return arena.usage(); }
+
     // 获取尺寸
     int getRows() const { return rows; }
     int getCols() const { return cols; }
 
 private:
     int rows, cols;
-    std::vector<std::vector<int>> map;      // 地图数据
-    std::vector<std::vector<int>> dp;       // 动态规划表
+    mutable DungeonArena arena;             // 地图、dp、正向表和墙壁位图的缓冲区池
+    std::shared_ptr<std::vector<int>> map;          // 自有地图数据（行优先，可能被快照共享）
+    mutable std::shared_ptr<std::vector<int>> dp;   // 自有动态规划表（行优先，可能被快照共享）
+    const int* mapData;                     // 当前地图数据，指向map或映射文件
+    mutable const int* dpData;              // 当前DP表，指向dp或映射文件，未分配时为空
+    std::shared_ptr<const DungeonFileMapping> mapping;  // 映射文件，保证mapData/dpData有效
+    std::shared_ptr<std::vector<uint64_t>> walls;   // 障碍位图（可能被快照共享），没有墙壁时为空
+    int wallDensity;                        // 生成时的墙壁百分比
+    uint64_t seed;                          // 生成种子
+
+    // 求解结果缓存（非线程安全，同一Dungeon的查询需在同一线程进行）
+    uint64_t mapVersion;                    // 当前地图版本（内容或路线变化时递增）
+    uint64_t contentVersion;                // 地图内容版本（只在内容变化时递增）
+    mutable uint64_t solvedVersion;         // dp对应的地图版本
+    mutable uint64_t pathVersion;           // cachedPath对应的地图版本
+    mutable std::vector<QPoint> cachedPath; // 缓存的最优路径
+    mutable DungeonSnapshotPtr cachedSnapshot;  // 当前版本的快照
+
+    // 正向DP：到达每个格子（计入其效果前）时可能的最大健康值
+    int forwardHealth;                      // 正向DP的初始健康值
+    mutable std::shared_ptr<std::vector<int>> forward;  // 正向DP表（行优先，可能被快照共享）
+    mutable uint64_t forwardVersion;        // forward对应的地图版本
+
+    int healthCap;                          // 健康上限，0表示不限
+    MovementMode movement;                  // 移动方式
+    mutable FourWaySolver fourWaySolver;    // 四向移动求解器，保存回溯所需的方向
+    ObjectiveOrder objectiveOrder;          // 次要优化目标
+    mutable LexicographicSolver lexSolver;  // 按目标顺序求解，保存回溯所需的方向
+
+    // 路线及其分段求解缓存
+    RoutePlan route;
+    mutable RouteSolver routeSolver;
+
+    // 按哈希共享的求解缓存（只用于不限上限的经典路线）
+    std::shared_ptr<SolutionCache> solutionCache;
+    mutable std::shared_ptr<const std::vector<int>> cachedDp;  // 来自缓存的DP表
+    mutable std::shared_ptr<const CachedSolution> cacheHit;    // 当前版本的查找结果
+    mutable uint64_t cacheLookupVersion;    // cacheHit对应的地图版本
+    mutable MapHash mapHash;                // 当前地图哈希
+    mutable uint64_t hashVersion;           // mapHash对应的地图内容版本
 
     // 手动模式相关
     QPoint playerPos;                       // 玩家当前位置
     int currentHealth;                      // 当前健康值
     int initialHealth;                      // 初始健康值
     std::vector<QPoint> playerPath;         // 玩家走过的路径
+    std::vector<uint64_t> visitedRooms;     // 四向移动时已生效的房间，格式与墙壁位图相同
     GameState gameState;                    // 游戏状态
-
-    void initializeDp();
-    void solveDp();
+    size_t nextWaypoint;                    // 尚未经过的第一个路点
+
+    size_t cellIndex(int row, int col) const { return static_cast<size_t>(row) * cols + col; }
+    size_t cellCount() const { return static_cast<size_t>(rows) * cols; }
+    int* writableMap();
+    uint64_t* writableWalls();
+    const uint64_t* wallBits() const { return walls ? walls->data() : nullptr; }
+    std::shared_ptr<const void> ownerOf(const int* data) const;
+    void markMapChanged() { ++mapVersion; ++contentVersion; }
+    bool isClassicRoute() const { return route.isClassic(rows, cols); }
+    bool isFourWay() const { return movement == MovementMode::FOUR_WAY; }
+    bool isClassicProblem() const { return !isFourWay() && healthCap == 0 && isClassicRoute(); }
+    bool usesTieBreaks() const { return !objectiveOrder.empty() && isClassicProblem(); }
+    int effectiveCap() const { return healthCap > 0 ? healthCap : INT_MAX; }
+    void enterRoom(const QPoint& pos);
+    void ensureSolved() const;
+    void ensureSolvedWithForward() const;
+    int* prepareForward() const;
+    void solveForward(int* out) const;
+    void tracePath() const;
+    std::shared_ptr<const CachedSolution> lookupCache() const;
+    void rememberSolution() const;
+
+    void initializeDp() const;
+    void solveDp() const;
+    void solveCurrent() const;
     void updateGameState();
+    void generateWalls(std::mt19937& gen);
     void generateFallbackMap();
     void validateMapSize(int rows, int cols) const;
     void validateMapData() const;
@@ -0,0 +1,144 @@
+#include "dungeonarena.h"
+#include <algorithm>
+#include <atomic>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// 复用时容量超过所需的这么多倍（且超过下限）就收缩
+const size_t SHRINK_FACTOR = 4;
+const size_t SHRINK_MIN_BYTES = 64 * 1024;
+
+// 只有池自己持有时缓冲区空闲。其他线程释放快照后计数才会降到1，之后没有人能再取得引用；
+// 读到1后加acquire栅栏，保证那些线程对缓冲区的读取都发生在复用之前
+template <class T>
+bool isFree(const std::shared_ptr<std::vector<T>>& slot) {
+    if (slot.use_count() != 1) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+} // namespace
+
+template <class T>
+typename DungeonArena::Pool<T>::Buffer& DungeonArena::Pool<T>::reserve(size_t size, DungeonArena& arena) {
+    // 优先取容量足够的最小空闲缓冲区，没有时取最大的空闲缓冲区扩容
+    Buffer* best = nullptr;
+    for (Buffer& slot : m_slots) {
+        if (!isFree(slot)) {
+            continue;
+        }
+        size_t capacity = slot->capacity();
+        size_t bestCapacity = best ? (*best)->capacity() : 0;
+        bool fits = capacity >= size;
+        bool bestFits = best && bestCapacity >= size;
+        if (!best || (fits && (!bestFits || capacity < bestCapacity)) || (!fits && !bestFits && capacity > bestCapacity)) {
+            best = &slot;
+        }
+    }
+
+    if (!best) {
+        m_slots.push_back(std::make_shared<std::vector<T>>());
+        best = &m_slots.back();
+    }
+
+    std::vector<T>& buffer = **best;
+    size_t capacity = buffer.capacity();
+    bool grow = capacity < size;
+    bool shrink = capacity > size * SHRINK_FACTOR && capacity * sizeof(T) > SHRINK_MIN_BYTES;
+    if (grow || shrink) {
+        std::vector<T> fresh;
+        fresh.reserve(grow ? std::max(size, capacity + capacity / 2) : size);
+        buffer.swap(fresh);
+        adviseHugePages(buffer.data(), buffer.capacity() * sizeof(T));
+        arena.grew();
+    }
+    buffer.clear();
+    return *best;
+}
+
+template <class T>
+typename DungeonArena::Pool<T>::Buffer DungeonArena::Pool<T>::acquire(size_t size, T value, DungeonArena& arena) {
+    Buffer& slot = reserve(size, arena);
+    slot->assign(size, value);
+    return slot;
+}
+
+template <class T>
+typename DungeonArena::Pool<T>::Buffer DungeonArena::Pool<T>::copy(const T* data, size_t size, DungeonArena& arena) {
+    Buffer& slot = reserve(size, arena);
+    slot->assign(data, data + size);
+    return slot;
+}
+
+template <class T>
+typename DungeonArena::Pool<T>::Buffer DungeonArena::Pool<T>::adopt(std::vector<T>&& data, DungeonArena& arena) {
+    // 换进容量最小的空闲缓冲区，它原来的内存随data一起释放
+    Buffer* best = nullptr;
+    for (Buffer& slot : m_slots) {
+        if (isFree(slot) && (!best || slot->capacity() < (*best)->capacity())) {
+            best = &slot;
+        }
+    }
+    if (!best) {
+        m_slots.push_back(std::make_shared<std::vector<T>>());
+        best = &m_slots.back();
+    }
+
+    (*best)->swap(data);
+    std::vector<T>().swap(data);
+    adviseHugePages((*best)->data(), (*best)->capacity() * sizeof(T));
+    arena.grew();
+    return *best;
+}
+
+template <class T>
+void DungeonArena::Pool<T>::addUsage(Usage& usage) const {
+    for (const Buffer& slot : m_slots) {
+        size_t bytes = slot->capacity() * sizeof(T);
+        usage.currentBytes += bytes;
+        if (slot.use_count() > 1) {
+            usage.inUseBytes += bytes;
+        }
+    }
+    usage.buffers += m_slots.size();
+}
+
+template class DungeonArena::Pool<int>;
+template class DungeonArena::Pool<uint64_t>;
+
+DungeonArena::Usage DungeonArena::usage() const {
+    Usage result;
+    m_ints.addUsage(result);
+    m_bits.addUsage(result);
+    result.peakBytes = std::max(m_peakBytes, result.currentBytes);
+    return result;
+}
+
+void DungeonArena::grew() {
+    m_peakBytes = std::max(m_peakBytes, usage().currentBytes);
+}
+
+void DungeonArena::adviseHugePages(void* data, size_t bytes) {
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    // 只对完整覆盖的2MB对齐区间提出建议，内核不支持或未开启时忽略
+    if (bytes < HUGE_PAGE_SIZE) {
+        return;
+    }
+    uintptr_t begin = (reinterpret_cast<uintptr_t>(data) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) & ~(HUGE_PAGE_SIZE - 1);
+    if (end > begin) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE);
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
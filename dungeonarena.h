@@ -0,0 +1,80 @@
+#ifndef DUNGEONARENA_H
+#define DUNGEONARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 一个Dungeon的缓冲区池：地图、dp、正向表和墙壁位图都从这里取。
+//
+// 每个缓冲区由池和使用者共同持有，使用者（包括快照）全部放手后缓冲区回到池中，下次按容量复用，
+// 重新生成、改尺寸和反复求解时这些与格子数成正比的缓冲区不再重新分配。池不管理其他对象：
+// 快照本身、路径、最优走廊位图以及求解缓存的条目（含压缩路径和磁盘写入）仍在每次生成后分配，
+// 它们与路径长度成正比或在快照间共享，不适合放进按容量复用的池。需要更大的缓冲区时按1.5倍几何增长；
+// 复用的缓冲区远大于所需时收缩，避免大地图之后长期占用内存。
+// 超过2MB的缓冲区在Linux上用madvise建议使用透明大页。
+//
+// 非线程安全，与所属的Dungeon在同一线程使用；快照可以在其他线程释放缓冲区。
+class DungeonArena {
+public:
+    using IntBuffer = std::shared_ptr<std::vector<int>>;
+    using BitBuffer = std::shared_ptr<std::vector<uint64_t>>;
+
+    struct Usage {
+        size_t currentBytes = 0;    // 池中所有缓冲区的容量
+        size_t inUseBytes = 0;      // 其中仍被使用的部分
+        size_t peakBytes = 0;       // currentBytes的历史最大值
+        size_t buffers = 0;         // 缓冲区个数
+    };
+
+    DungeonArena() = default;
+    DungeonArena(const DungeonArena&) = delete;
+    DungeonArena& operator=(const DungeonArena&) = delete;
+
+    // 取一个长度为size、全部为value的缓冲区
+    IntBuffer ints(size_t size, int value) { return m_ints.acquire(size, value, *this); }
+    BitBuffer bits(size_t size, uint64_t value) { return m_bits.acquire(size, value, *this); }
+
+    // 取一个缓冲区并复制[data, data + size)
+    IntBuffer copyInts(const int* data, size_t size) { return m_ints.copy(data, size, *this); }
+    BitBuffer copyBits(const uint64_t* data, size_t size) { return m_bits.copy(data, size, *this); }
+
+    // 接管外部数据（不复制），之后与池中其他缓冲区一样复用
+    IntBuffer adoptInts(std::vector<int>&& data) { return m_ints.adopt(std::move(data), *this); }
+    BitBuffer adoptBits(std::vector<uint64_t>&& data) { return m_bits.adopt(std::move(data), *this); }
+
+    // 缓冲区是否还被使用者之外的地方（快照）引用，是则修改前需要另取一个
+    template <class T>
+    static bool isShared(const std::shared_ptr<std::vector<T>>& buffer) {
+        return buffer.use_count() > 2;
+    }
+
+    Usage usage() const;
+
+private:
+    template <class T>
+    class Pool {
+    public:
+        using Buffer = std::shared_ptr<std::vector<T>>;
+
+        Buffer acquire(size_t size, T value, DungeonArena& arena);
+        Buffer copy(const T* data, size_t size, DungeonArena& arena);
+        Buffer adopt(std::vector<T>&& data, DungeonArena& arena);
+        void addUsage(Usage& usage) const;
+
+    private:
+        Buffer& reserve(size_t size, DungeonArena& arena);
+
+        std::vector<Buffer> m_slots;
+    };
+
+    void grew();
+    static void adviseHugePages(void* data, size_t bytes);
+
+    Pool<int> m_ints;
+    Pool<uint64_t> m_bits;
+    size_t m_peakBytes = 0;
+};
+
+#endif // DUNGEONARENA_H
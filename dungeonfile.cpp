@@ -0,0 +1,282 @@
+#include "dungeonfile.h"
+#include "dungeon.h"
+#include "logger.h"
+#include <QSaveFile>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const char MAGIC[8] = {'D', 'U', 'N', 'G', 'E', 'O', 'N', '\0'};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void writeBytes(QSaveFile& file, const void* data, qint64 size) {
+    if (file.write(static_cast<const char*>(data), size) != size) {
+        throw DungeonFileException("写入文件失败: " + file.errorString().toStdString());
+    }
+}
+
+void writePadding(QSaveFile& file, uint64_t from, uint64_t to) {
+    static const char zeros[DungeonFile::ALIGNMENT] = {};
+    if (to > from) {
+        writeBytes(file, zeros, static_cast<qint64>(to - from));
+    }
+}
+
+// 按指定宽度写出一行地图数据
+template <typename T>
+void writeRow(QSaveFile& file, const int* row, int cols, std::vector<T>& buffer) {
+    buffer.resize(cols);
+    for (int j = 0; j < cols; ++j) {
+        buffer[j] = static_cast<T>(row[j]);
+    }
+    writeBytes(file, buffer.data(), static_cast<qint64>(sizeof(T)) * cols);
+}
+
+} // namespace
+
+DungeonFileMapping::DungeonFileMapping(const QString& fileName)
+    : m_file(fileName), m_data(nullptr), m_size(0) {
+    std::memset(&m_header, 0, sizeof(m_header));
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        throw DungeonFileException("无法打开文件: " + m_file.errorString().toStdString());
+    }
+
+    m_size = m_file.size();
+    if (m_size < static_cast<qint64>(sizeof(DungeonFileHeader))) {
+        throw DungeonFileException("文件过小，不是有效的地图文件");
+    }
+
+    // 只读共享映射，多个进程打开同一文件时共用页缓存
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        throw DungeonFileException("内存映射文件失败: " + m_file.errorString().toStdString());
+    }
+
+    std::memcpy(&m_header, m_data, sizeof(m_header));
+
+    try {
+        DungeonFile::validateHeader(m_header, static_cast<uint64_t>(m_size));
+    } catch (...) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+        throw;
+    }
+}
+
+DungeonFileMapping::~DungeonFileMapping() {
+    if (m_data) {
+        m_file.unmap(m_data);
+    }
+}
+
+const int* DungeonFileMapping::dpData() const {
+    return hasDp() ? reinterpret_cast<const int*>(m_data + m_header.dpOffset) : nullptr;
+}
+
+const uint64_t* DungeonFileMapping::wallData() const {
+    return hasWalls() ? reinterpret_cast<const uint64_t*>(m_data + DungeonFile::wallOffset(m_header)) : nullptr;
+}
+
+bool DungeonFileMapping::hasMinHealth() const {
+    return (m_header.flags & DungeonFile::HAS_MIN_HEALTH) != 0;
+}
+
+bool DungeonFileMapping::hasDp() const {
+    return (m_header.flags & DungeonFile::HAS_DP) != 0;
+}
+
+bool DungeonFileMapping::hasWalls() const {
+    return (m_header.flags & DungeonFile::HAS_WALLS) != 0;
+}
+
+namespace DungeonFile {
+
+void validateHeader(const DungeonFileHeader& header, uint64_t size) {
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw DungeonFileException("文件标识不匹配，不是有效的地图文件");
+    }
+
+    if (header.version != VERSION) {
+        throw DungeonFileException("不支持的地图文件版本: " + std::to_string(header.version));
+    }
+
+    if (header.headerSize < sizeof(DungeonFileHeader)) {
+        throw DungeonFileException("文件头大小无效");
+    }
+
+    if (header.rows == 0 || header.cols == 0 || header.rows > INT_MAX || header.cols > INT_MAX) {
+        throw DungeonFileException("地图尺寸无效");
+    }
+
+    if (header.cellWidth != 1 && header.cellWidth != 2 && header.cellWidth != 4) {
+        throw DungeonFileException("格子宽度无效: " + std::to_string(header.cellWidth));
+    }
+
+    uint64_t count = static_cast<uint64_t>(header.rows) * header.cols;
+
+    if (header.cellOffset < header.headerSize || header.cellOffset % header.cellWidth != 0 ||
+        header.cellOffset > size || (size - header.cellOffset) / header.cellWidth < count) {
+        throw DungeonFileException("地图数据段超出文件范围");
+    }
+
+    if (header.flags & HAS_DP) {
+        if (header.dpOffset < header.headerSize || header.dpOffset % sizeof(int) != 0 ||
+            header.dpOffset > size || (size - header.dpOffset) / sizeof(int) < count) {
+            throw DungeonFileException("DP数据段超出文件范围");
+        }
+    }
+
+    if (header.flags & HAS_WALLS) {
+        uint64_t offset = wallOffset(header);
+        if (offset > size || (size - offset) / sizeof(uint64_t) < WallMask::wordCount(count)) {
+            throw DungeonFileException("墙壁数据段超出文件范围");
+        }
+    }
+}
+
+uint64_t wallOffset(const DungeonFileHeader& header) {
+    uint64_t count = static_cast<uint64_t>(header.rows) * header.cols;
+    uint64_t end = (header.flags & HAS_DP) ? header.dpOffset + count * sizeof(int)
+                                            : header.cellOffset + count * header.cellWidth;
+    return alignUp(end, ALIGNMENT);
+}
+
+DungeonFileHeader readHeader(QFile& file) {
+    DungeonFileHeader header;
+    if (!file.seek(0) || file.read(reinterpret_cast<char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header))) {
+        throw DungeonFileException("文件过小，不是有效的地图文件");
+    }
+    validateHeader(header, static_cast<uint64_t>(file.size()));
+    return header;
+}
+
+int narrowestCellWidth(const DungeonSnapshot& snapshot) {
+    int minValue = 0;
+    int maxValue = 0;
+    for (int i = 0; i < snapshot.rows; ++i) {
+        const int* row = snapshot.getMapRow(i);
+        auto range = std::minmax_element(row, row + snapshot.cols);
+        minValue = std::min(minValue, *range.first);
+        maxValue = std::max(maxValue, *range.second);
+    }
+
+    if (minValue >= INT8_MIN && maxValue <= INT8_MAX) {
+        return 1;
+    }
+    if (minValue >= INT16_MIN && maxValue <= INT16_MAX) {
+        return 2;
+    }
+    return 4;
+}
+
+void save(const QString& fileName, const DungeonSnapshot& snapshot, int cellWidth, bool includeDp) {
+    try {
+        if (cellWidth != 1 && cellWidth != 2 && cellWidth != 4) {
+            throw DungeonFileException("格子宽度必须为1、2或4");
+        }
+        if (cellWidth < narrowestCellWidth(snapshot)) {
+            throw DungeonFileException("地图数值超出所选格子宽度的范围");
+        }
+
+        int rows = snapshot.rows;
+        int cols = snapshot.cols;
+        uint64_t count = static_cast<uint64_t>(rows) * cols;
+        // 文件中不记录路线和健康上限，载入时按经典规则处理，所以只保存经典规则下的求解结果
+        bool classic = snapshot.isClassic();
+        bool writeDp = includeDp && classic && snapshot.dp;
+        bool writeWalls = WallMask::any(snapshot.wallBits(), count);
+
+        DungeonFileHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.headerSize = sizeof(DungeonFileHeader);
+        header.rows = static_cast<uint32_t>(rows);
+        header.cols = static_cast<uint32_t>(cols);
+        header.cellWidth = static_cast<uint32_t>(cellWidth);
+        header.seed = snapshot.seed;
+        header.cellOffset = alignUp(sizeof(DungeonFileHeader), ALIGNMENT);
+
+        uint64_t cellEnd = header.cellOffset + count * cellWidth;
+
+        if (classic) {
+            header.flags |= HAS_MIN_HEALTH;
+            header.minHealth = snapshot.minHealth;
+        }
+        if (writeDp) {
+            header.flags |= HAS_DP;
+            header.dpOffset = alignUp(cellEnd, ALIGNMENT);
+        }
+        uint64_t dataEnd = writeDp ? header.dpOffset + count * sizeof(int) : cellEnd;
+        if (writeWalls) {
+            header.flags |= HAS_WALLS;
+        }
+
+        // 先写临时文件，全部成功后再替换目标文件
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            throw DungeonFileException("无法创建文件: " + file.errorString().toStdString());
+        }
+
+        writeBytes(file, &header, sizeof(header));
+        writePadding(file, sizeof(header), header.cellOffset);
+
+        std::vector<int8_t> buffer8;
+        std::vector<int16_t> buffer16;
+        for (int i = 0; i < rows; ++i) {
+            const int* row = snapshot.getMapRow(i);
+            if (cellWidth == 1) {
+                writeRow(file, row, cols, buffer8);
+            } else if (cellWidth == 2) {
+                writeRow(file, row, cols, buffer16);
+            } else {
+                writeBytes(file, row, static_cast<qint64>(sizeof(int)) * cols);
+            }
+        }
+
+        if (writeDp) {
+            writePadding(file, cellEnd, header.dpOffset);
+            for (int i = 0; i < rows; ++i) {
+                writeBytes(file, snapshot.getDpRow(i), static_cast<qint64>(sizeof(int)) * cols);
+            }
+        }
+
+        if (writeWalls) {
+            uint64_t wallOffset = alignUp(dataEnd, ALIGNMENT);
+            writePadding(file, dataEnd, wallOffset);
+            writeBytes(file, snapshot.wallBits(), static_cast<qint64>(sizeof(uint64_t) * WallMask::wordCount(count)));
+        }
+
+        if (!file.commit()) {
+            throw DungeonFileException("保存文件失败: " + file.errorString().toStdString());
+        }
+
+        LOG_INFO("Map file saved: %d x %d cell width %d %s %s", rows, cols, cellWidth,
+                 writeDp ? "with dp" : "without dp", writeWalls ? "with walls" : "");
+
+    } catch (const DungeonFileException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonFileException(std::string("保存地图文件时发生错误: ") + e.what());
+    }
+}
+
+void open(const QString& fileName, Dungeon& dungeon) {
+    try {
+        auto mapping = std::make_shared<const DungeonFileMapping>(fileName);
+        dungeon.loadMappedFile(mapping);
+    } catch (const DungeonFileException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw DungeonFileException(e.what());
+    }
+}
+
+} // namespace DungeonFile
@@ -0,0 +1,94 @@
+#ifndef DUNGEONFILE_H
+#define DUNGEONFILE_H
+
+#include <QFile>
+#include <QString>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include "dungeonsnapshot.h"
+
+class Dungeon;
+
+class DungeonFileException : public std::runtime_error {
+public:
+    explicit DungeonFileException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 二进制地图文件头（小端序，固定64字节）
+// 文件布局：文件头 | 对齐填充 | 地图数据(rows*cols*cellWidth) | 对齐填充 | 可选的dp数据(rows*cols*4)
+//          | 对齐填充 | 可选的墙壁位图(ceil(rows*cols/64)*8)
+// 墙壁位图紧接在最后一个数据段之后按ALIGNMENT对齐，偏移由前面的段推算，文件头不另设字段
+struct DungeonFileHeader {
+    char magic[8];          // "DUNGEON\0"
+    uint32_t version;       // 格式版本
+    uint32_t headerSize;    // 文件头大小
+    uint32_t rows;          // 行数
+    uint32_t cols;          // 列数
+    uint32_t cellWidth;     // 每个格子的字节数：1、2或4
+    uint32_t flags;         // 见 DungeonFile::Flags
+    uint64_t seed;          // 生成种子（导入的地图为0）
+    int32_t minHealth;      // 最小初始健康值（HAS_MIN_HEALTH时有效）
+    uint32_t reserved;      // 保留，写0
+    uint64_t cellOffset;    // 地图数据偏移
+    uint64_t dpOffset;      // dp数据偏移（HAS_DP时有效）
+};
+
+static_assert(sizeof(DungeonFileHeader) == 64, "DungeonFileHeader必须为64字节");
+
+// 只读映射的二进制地图文件，析构时解除映射
+class DungeonFileMapping {
+public:
+    explicit DungeonFileMapping(const QString& fileName);
+    ~DungeonFileMapping();
+
+    DungeonFileMapping(const DungeonFileMapping&) = delete;
+    DungeonFileMapping& operator=(const DungeonFileMapping&) = delete;
+
+    const DungeonFileHeader& header() const { return m_header; }
+    const uchar* cellData() const { return m_data + m_header.cellOffset; }
+    const int* dpData() const;
+    const uint64_t* wallData() const;
+    bool hasMinHealth() const;
+    bool hasDp() const;
+    bool hasWalls() const;
+
+private:
+    QFile m_file;
+    uchar* m_data;
+    qint64 m_size;
+    DungeonFileHeader m_header;
+};
+
+namespace DungeonFile {
+
+const uint32_t VERSION = 1;
+const uint64_t ALIGNMENT = 64;     // 数据段对齐，便于向量化读取
+
+enum Flags : uint32_t {
+    HAS_MIN_HEALTH = 1u << 0,
+    HAS_DP = 1u << 1,
+    HAS_WALLS = 1u << 2
+};
+
+// 检查文件头与文件大小是否相符，不符时抛出DungeonFileException
+void validateHeader(const DungeonFileHeader& header, uint64_t size);
+
+// 墙壁位图段的偏移
+uint64_t wallOffset(const DungeonFileHeader& header);
+
+// 从已打开的文件开头读取并检查文件头，不映射文件（流式求解使用）
+DungeonFileHeader readHeader(QFile& file);
+
+// 能无损保存该地图的最小格子宽度
+int narrowestCellWidth(const DungeonSnapshot& snapshot);
+
+// 保存为二进制文件；cellWidth为4时打开可零拷贝
+void save(const QString& fileName, const DungeonSnapshot& snapshot, int cellWidth = 4, bool includeDp = true);
+
+// 只读映射打开文件，并让dungeon直接使用映射数据
+void open(const QString& fileName, Dungeon& dungeon);
+
+} // namespace DungeonFile
+
+#endif // DUNGEONFILE_H
@@ -1,7 +1,11 @@
 #include "dungeonmapmodel.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "tracer.h"
 #include <QFont>
 #include <QBrush>
-#include <QDebug>
+#include <algorithm>
+#include <climits>
 
 namespace DungeonColors {
 const QColor DefaultGray(0x95, 0xA5, 0xA6);    // 默认灰色 #95A5A6
@@ -10,18 +14,32 @@ const QColor PositiveGreen(0x2E, 0xCC, 0x71);  // 绿色增益 #2ECC71
 const QColor NegativeRed(0xE7, 0x4C, 0x3C);    // 红色伤害 #E74C3C
 const QColor StartEndBlue(0x34, 0x98, 0xDB);   // 起点/终点蓝 #3498DB
 const QColor BorderBlack(0x00, 0x00, 0x00);    // 边框黑色 #000000
+const QColor WaypointTeal(0x1A, 0xBC, 0x9C);   // 路点青色 #1ABC9C
+const QColor HintPurple(0x9B, 0x59, 0xB6);     // 提示路径紫 #9B59B6
+const QColor CorridorAmber(0xF8, 0xC4, 0x71);  // 最优走廊浅橙 #F8C471
+const QColor HeatDead(0x34, 0x49, 0x5E);       // 无存活路线 #34495E
+const QColor HeatTight(0xE7, 0x4C, 0x3C);      // 余量为0 #E74C3C
+const QColor HeatMedium(0xF1, 0xC4, 0x0F);     // 余量居中 #F1C40F
+const QColor HeatLoose(0x2E, 0xCC, 0x71);      // 余量最大 #2ECC71
+const QColor WallDark(0x2C, 0x3E, 0x50);       // 墙壁深色 #2C3E50
+
+QColor blend(const QColor& from, const QColor& to, double t) {
+    return QColor(static_cast<int>(from.red() + (to.red() - from.red()) * t),
+                  static_cast<int>(from.green() + (to.green() - from.green()) * t),
+                  static_cast<int>(from.blue() + (to.blue() - from.blue()) * t));
+}
 }
 
 DungeonMapModel::DungeonMapModel(QObject *parent)
-    : QAbstractTableModel(parent), m_dungeon(nullptr) {
+    : QAbstractTableModel(parent), m_heatMap(false), m_corridor(false) {
 }
 
-void DungeonMapModel::validateDungeon() const {
-    if (!m_dungeon) {
-        return; // 允许空dungeon，返回0行0列
+void DungeonMapModel::validateSnapshot() const {
+    if (!m_snapshot) {
+        return; // 允许空快照，返回0行0列
     }
 
-    if (m_dungeon->getRows() <= 0 || m_dungeon->getCols() <= 0) {
+    if (m_snapshot->rows <= 0 || m_snapshot->cols <= 0) {
         throw MapModelException("地图尺寸无效");
     }
 }
@@ -31,14 +49,14 @@ void DungeonMapModel::validateIndex(const QModelIndex& index) const {
         throw MapModelException("无效的模型索引");
     }
 
-    if (!m_dungeon) {
-        throw MapModelException("地下城对象为空");
+    if (!m_snapshot) {
+        throw MapModelException("地图快照为空");
     }
 
     int row = index.row();
     int col = index.column();
 
-    if (row < 0 || row >= m_dungeon->getRows() || col < 0 || col >= m_dungeon->getCols()) {
+    if (row < 0 || row >= m_snapshot->rows || col < 0 || col >= m_snapshot->cols) {
         throw MapModelException("索引超出范围");
     }
 }
@@ -46,10 +64,10 @@ void DungeonMapModel::validateIndex(const QModelIndex& index) const {
 int DungeonMapModel::rowCount(const QModelIndex &parent) const {
     Q_UNUSED(parent)
     try {
-        validateDungeon();
-        return m_dungeon ? m_dungeon->getRows() : 0;
+        validateSnapshot();
+        return m_snapshot ? m_snapshot->rows : 0;
     } catch (const std::exception& e) {
-        qDebug() << "rowCount error:" << e.what();
+        LOG_WARNING("rowCount error: %s", e.what());
         return 0;
     }
 }
@@ -57,17 +75,19 @@ int DungeonMapModel::rowCount(const QModelIndex &parent) const {
 int DungeonMapModel::columnCount(const QModelIndex &parent) const {
     Q_UNUSED(parent)
     try {
-        validateDungeon();
-        return m_dungeon ? m_dungeon->getCols() : 0;
+        validateSnapshot();
+        return m_snapshot ? m_snapshot->cols : 0;
     } catch (const std::exception& e) {
-        qDebug() << "columnCount error:" << e.what();
+        LOG_WARNING("columnCount error: %s", e.what());
         return 0;
     }
 }
 
 QVariant DungeonMapModel::data(const QModelIndex &index, int role) const {
+    TRACE_SCOPE("DungeonMapModel::data");
+    PerfMetrics::instance().countDataCall();
     try {
-        if (!m_dungeon || !index.isValid()) {
+        if (!m_snapshot || !index.isValid()) {
             return QVariant();
         }
 
@@ -76,16 +96,12 @@ QVariant DungeonMapModel::data(const QModelIndex &index, int role) const {
         int row = index.row();
         int col = index.column();
 
-        const auto& map = m_dungeon->getMap();
-
-        // 额外的安全检查
-        if (row >= static_cast<int>(map.size()) || col >= static_cast<int>(map[row].size())) {
-            throw MapModelException("访问地图数据时索引越界");
-        }
-
         switch (role) {
         case Qt::DisplayRole:
-            return QString::number(map[row][col]);
+            if (m_snapshot->isWall(row, col)) {
+                return QString("墙");
+            }
+            return QString::number(m_snapshot->getCell(row, col));
 
         case Qt::TextAlignmentRole:
             return Qt::AlignCenter;
@@ -106,15 +122,29 @@ QVariant DungeonMapModel::data(const QModelIndex &index, int role) const {
         case Qt::UserRole: // 用于边框颜色
             return getBorderColor(row, col);
 
+        case Qt::ToolTipRole:
+            if (m_snapshot->isWall(row, col)) {
+                return QString("墙壁，不能进入");
+            }
+            if (!m_snapshot->forward) {
+                return QVariant();
+            }
+            return QString("所需健康值: %1\n最大到达健康值: %2\n余量: %3")
+                .arg(m_snapshot->getDpValue(row, col) == INT_MAX ? QString("不在路线上")
+                                                                 : QString::number(m_snapshot->getDpValue(row, col)))
+                .arg(m_snapshot->getForwardValue(row, col))
+                .arg(m_snapshot->getSlack(row, col) >= 0 ? QString::number(m_snapshot->getSlack(row, col))
+                                                         : QString("无存活路线"));
+
         default:
             return QVariant();
         }
 
     } catch (const MapModelException& e) {
-        qDebug() << "Model data error:" << e.what();
+        LOG_WARNING("Model data error: %s", e.what());
         return QVariant();
     } catch (const std::exception& e) {
-        qDebug() << "Model data unexpected error:" << e.what();
+        LOG_ERROR("Model data unexpected error: %s", e.what());
         return QVariant();
     }
 }
@@ -126,25 +156,25 @@ QVariant DungeonMapModel::headerData(int section, Qt::Orientation orientation, i
         }
         return QVariant();
     } catch (const std::exception& e) {
-        qDebug() << "headerData error:" << e.what();
+        LOG_WARNING("headerData error: %s", e.what());
         return QVariant();
     }
 }
 
-void DungeonMapModel::setDungeon(const Dungeon* dungeon) {
+void DungeonMapModel::setSnapshot(DungeonSnapshotPtr snapshot) {
     try {
         beginResetModel();
-        m_dungeon = dungeon;
+        m_snapshot = std::move(snapshot);
 
-        if (m_dungeon) {
-            validateDungeon();
+        if (m_snapshot) {
+            validateSnapshot();
         }
 
         endResetModel();
 
     } catch (const std::exception& e) {
-        qDebug() << "setDungeon error:" << e.what();
-        m_dungeon = nullptr;
+        LOG_WARNING("setSnapshot error: %s", e.what());
+        m_snapshot = nullptr;
         endResetModel();
     }
 }
@@ -153,12 +183,12 @@ void DungeonMapModel::setPlayerPath(const std::vector<QPoint>& path) {
     try {
         m_playerPath = path;
 
-        if (m_dungeon && m_dungeon->getRows() > 0 && m_dungeon->getCols() > 0) {
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
             emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
         }
 
     } catch (const std::exception& e) {
-        qDebug() << "setPlayerPath error:" << e.what();
+        LOG_WARNING("setPlayerPath error: %s", e.what());
         m_playerPath.clear();
     }
 }
@@ -167,27 +197,86 @@ void DungeonMapModel::setAutoPath(const std::vector<QPoint>& path) {
     try {
         m_autoPath = path;
 
-        if (m_dungeon && m_dungeon->getRows() > 0 && m_dungeon->getCols() > 0) {
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
             emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
         }
 
     } catch (const std::exception& e) {
-        qDebug() << "setAutoPath error:" << e.what();
+        LOG_WARNING("setAutoPath error: %s", e.what());
         m_autoPath.clear();
     }
 }
 
+void DungeonMapModel::setHintPath(const std::vector<QPoint>& path) {
+    try {
+        m_hintPath = path;
+
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
+            emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
+        }
+
+    } catch (const std::exception& e) {
+        LOG_WARNING("setHintPath error: %s", e.what());
+        m_hintPath.clear();
+    }
+}
+
+void DungeonMapModel::setHeatMapEnabled(bool enabled) {
+    try {
+        m_heatMap = enabled;
+
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
+            emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
+        }
+
+    } catch (const std::exception& e) {
+        LOG_WARNING("setHeatMapEnabled error: %s", e.what());
+    }
+}
+
+void DungeonMapModel::setCorridorVisible(bool visible) {
+    try {
+        m_corridor = visible;
+
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
+            emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
+        }
+
+    } catch (const std::exception& e) {
+        LOG_WARNING("setCorridorVisible error: %s", e.what());
+    }
+}
+
+QColor DungeonMapModel::heatMapColor(const DungeonSnapshot& snapshot, int row, int col) {
+    if (!snapshot.forward) {
+        return DungeonColors::DefaultGray;
+    }
+
+    int slack = snapshot.getSlack(row, col);
+    if (slack < 0) {
+        return DungeonColors::HeatDead;
+    }
+
+    // 红(余量0) -> 黄 -> 绿(最大余量)
+    double t = snapshot.maxSlack > 0 ? static_cast<double>(slack) / snapshot.maxSlack : 1.0;
+    if (t < 0.5) {
+        return DungeonColors::blend(DungeonColors::HeatTight, DungeonColors::HeatMedium, t * 2);
+    }
+    return DungeonColors::blend(DungeonColors::HeatMedium, DungeonColors::HeatLoose, (t - 0.5) * 2);
+}
+
 void DungeonMapModel::clearPaths() {
     try {
         m_playerPath.clear();
         m_autoPath.clear();
+        m_hintPath.clear();
 
-        if (m_dungeon && m_dungeon->getRows() > 0 && m_dungeon->getCols() > 0) {
+        if (m_snapshot && m_snapshot->rows > 0 && m_snapshot->cols > 0) {
             emit dataChanged(index(0, 0), index(rowCount()-1, columnCount()-1));
         }
 
     } catch (const std::exception& e) {
-        qDebug() << "clearPaths error:" << e.what();
+        LOG_WARNING("clearPaths error: %s", e.what());
     }
 }
 
@@ -201,14 +290,14 @@ bool DungeonMapModel::isInPath(int row, int col, const std::vector<QPoint>& path
         return false;
 
     } catch (const std::exception& e) {
-        qDebug() << "isInPath error:" << e.what();
+        LOG_WARNING("isInPath error: %s", e.what());
         return false;
     }
 }
 
 QColor DungeonMapModel::getBackgroundColor(int row, int col) const {
     try {
-        if (!m_dungeon) {
+        if (!m_snapshot) {
             return DungeonColors::DefaultGray;
         }
 
@@ -217,14 +306,24 @@ QColor DungeonMapModel::getBackgroundColor(int row, int col) const {
             return DungeonColors::PathOrange;
         }
 
-        const auto& map = m_dungeon->getMap();
-
         // 边界检查
-        if (row >= static_cast<int>(map.size()) || col >= static_cast<int>(map[row].size())) {
+        if (row >= m_snapshot->rows || col >= m_snapshot->cols) {
             return DungeonColors::DefaultGray;
         }
 
-        int value = map[row][col];
+        if (m_snapshot->isWall(row, col)) {
+            return DungeonColors::WallDark;
+        }
+
+        if (m_corridor && m_snapshot->corridor && m_snapshot->corridor->contains(row, col)) {
+            return DungeonColors::CorridorAmber;
+        }
+
+        if (m_heatMap) {
+            return heatMapColor(*m_snapshot, row, col);
+        }
+
+        int value = m_snapshot->getCell(row, col);
 
         if (value > 0) {
             return DungeonColors::PositiveGreen;
@@ -235,27 +334,38 @@ QColor DungeonMapModel::getBackgroundColor(int row, int col) const {
         }
 
     } catch (const std::exception& e) {
-        qDebug() << "getBackgroundColor error:" << e.what();
+        LOG_WARNING("getBackgroundColor error: %s", e.what());
         return DungeonColors::DefaultGray;
     }
 }
 
 QColor DungeonMapModel::getBorderColor(int row, int col) const {
     try {
-        if (!m_dungeon) {
+        if (!m_snapshot) {
             return DungeonColors::BorderBlack;
         }
 
-        // 起点和终点
-        if ((row == 0 && col == 0) ||
-            (row == m_dungeon->getRows()-1 && col == m_dungeon->getCols()-1)) {
+        // 起点和公主格子
+        const RoutePlan& route = m_snapshot->route;
+        QPoint cell(col, row);
+        if (cell == route.start || route.isTarget(cell)) {
             return DungeonColors::StartEndBlue;
         }
 
+        // 路点
+        if (std::find(route.waypoints.begin(), route.waypoints.end(), cell) != route.waypoints.end()) {
+            return DungeonColors::WaypointTeal;
+        }
+
+        // 提示的最优剩余路径
+        if (isInPath(row, col, m_hintPath)) {
+            return DungeonColors::HintPurple;
+        }
+
         return DungeonColors::BorderBlack;
 
     } catch (const std::exception& e) {
-        qDebug() << "getBorderColor error:" << e.what();
+        LOG_WARNING("getBorderColor error: %s", e.what());
         return DungeonColors::BorderBlack;
     }
 }
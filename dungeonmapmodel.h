@@ -6,7 +6,7 @@
 #include <QPoint>
 #include <vector>
 #include <stdexcept>
-#include "dungeon.h"
+#include "dungeonsnapshot.h"
 
 
 
@@ -28,21 +28,34 @@ public:
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
     // 设置数据
-    void setDungeon(const Dungeon* dungeon);
+    void setSnapshot(DungeonSnapshotPtr snapshot);  // 只读取不可变快照，不直接引用Dungeon
     void setPlayerPath(const std::vector<QPoint>& path);
     void setAutoPath(const std::vector<QPoint>& path);
+    void setHintPath(const std::vector<QPoint>& path);  // 手动模式提示的最优剩余路径
     void clearPaths();
 
+    // 余量热力图：按每个格子的健康值余量着色
+    void setHeatMapEnabled(bool enabled);
+    bool isHeatMapEnabled() const { return m_heatMap; }
+    static QColor heatMapColor(const DungeonSnapshot& snapshot, int row, int col);
+
+    // 最优走廊：标出所有最优路径经过的格子
+    void setCorridorVisible(bool visible);
+    bool isCorridorVisible() const { return m_corridor; }
+
 private:
-    const Dungeon* m_dungeon;
+    DungeonSnapshotPtr m_snapshot;
     std::vector<QPoint> m_playerPath;
     std::vector<QPoint> m_autoPath;
+    std::vector<QPoint> m_hintPath;
+    bool m_heatMap;
+    bool m_corridor;
 
     bool isInPath(int row, int col, const std::vector<QPoint>& path) const;
     QColor getBackgroundColor(int row, int col) const;
     QColor getBorderColor(int row, int col) const;
     void validateIndex(const QModelIndex& index) const;
-    void validateDungeon() const;
+    void validateSnapshot() const;
 };
 
 #endif // DUNGEONMAPMODEL_H
@@ -0,0 +1,103 @@
+#ifndef DUNGEONSNAPSHOT_H
+#define DUNGEONSNAPSHOT_H
+
+#include <QPoint>
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "lexicographicsolver.h"
+#include "optimalcorridor.h"
+#include "routeplan.h"
+#include "wallmask.h"
+
+// 移动方式
+enum class MovementMode {
+    RIGHT_DOWN,     // 只能向右或向下
+    FOUR_WAY        // 可以向四个方向移动，每次进入房间都生效
+};
+
+// 某一版本地图的不可变求解结果
+// 地图和DP数据与生成它的Dungeon共享（或直接指向映射文件），
+// Dungeon之后再修改地图时会先复制一份，已发布的快照内容永远不变，
+// 因此任意多个视图和线程可以不加锁地同时读取。
+struct DungeonSnapshot {
+    int rows = 0;
+    int cols = 0;
+    uint64_t version = 0;               // 对应的地图版本
+    uint64_t seed = 0;                  // 生成种子
+    int minHealth = 0;                  // 最小初始健康值（从路线起点出发），无可行路线时为INT_MAX
+    int healthCap = 0;                  // 求解所用的健康上限，0表示不限
+    MovementMode movement = MovementMode::RIGHT_DOWN;
+    ObjectiveOrder objectives;          // 路径所用的次要目标，为空时按经典规则优先向下
+    std::shared_ptr<const int> map;     // 地图数据（行优先）
+    std::shared_ptr<const int> dp;      // DP表（行优先）
+    std::shared_ptr<const std::vector<uint64_t>> walls; // 障碍位图，没有墙壁时为空
+    std::vector<QPoint> path;           // 最优路径（四向移动时可能包含往返）
+    RoutePlan route;                    // 求解所用的路线，dp中不在路线上的格子为INT_MAX
+
+    // 正向DP：以forwardHealth出发到达格子（计入其效果前）时的最大健康值，0表示无法活着到达。
+    // 四向移动时可以无限回血，不提供正向表
+    int forwardHealth = 0;
+    int maxSlack = -1;                  // 所有格子中的最大余量
+    std::shared_ptr<const int> forward;
+
+    std::shared_ptr<const OptimalCorridor> corridor;    // 所有最优路径经过的格子（只用于经典路线）
+
+    // 只向右下走、不限健康上限的经典路线，最优走廊、前K条路径和dp直接查表都只适用于这种情况
+    bool isClassic() const {
+        return movement == MovementMode::RIGHT_DOWN && healthCap == 0 && route.isClassic(rows, cols);
+    }
+    bool isSolvable() const { return minHealth != INT_MAX; }
+
+    int getCell(int row, int col) const { return map.get()[cellIndex(row, col)]; }
+    const uint64_t* wallBits() const { return walls ? walls->data() : nullptr; }
+    bool isWall(int row, int col) const { return WallMask::isWall(wallBits(), cellIndex(row, col)); }
+    const int* getMapRow(int row) const { return map.get() + cellIndex(row, 0); }
+    int getDpValue(int row, int col) const { return dp.get()[cellIndex(row, col)]; }
+    const int* getDpRow(int row) const { return dp.get() + cellIndex(row, 0); }
+    int getForwardValue(int row, int col) const { return forward.get()[cellIndex(row, col)]; }
+
+    // 存在经过该格子并活着到达终点的路线时返回健康值余量，否则返回-1
+    int getSlack(int row, int col) const {
+        size_t k = cellIndex(row, col);
+        int need = dp.get()[k];
+        int best = forward.get()[k];
+        return best >= need ? best - need : -1;
+    }
+
+    size_t cellIndex(int row, int col) const { return static_cast<size_t>(row) * cols + col; }
+};
+
+using DungeonSnapshotPtr = std::shared_ptr<const DungeonSnapshot>;
+
+// 当前快照的发布点：求解方在旁边构建新快照后整体替换，
+// 读取方拿到的快照在其持有期间始终有效。
+//
+// 读写都要短暂加锁：锁内只复制或交换一个shared_ptr（一次引用计数原子操作），旧快照在锁外释放。
+// 不用std::atomic_load/atomic_store（C++20起弃用，实现上是全局共享的自旋锁池，会与无关的shared_ptr争用），
+// 也不做无锁方案：读取方每帧只取一次快照，争用只发生在发布的瞬间，一把专用的锁已经足够
+class SnapshotPublisher {
+public:
+    DungeonSnapshotPtr current() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_current;
+    }
+
+    void publish(DungeonSnapshotPtr snapshot) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_current.swap(snapshot);
+        }
+        // snapshot此时持有旧快照，在锁外释放
+    }
+
+    void clear() { publish(nullptr); }
+
+private:
+    mutable std::mutex m_mutex;
+    DungeonSnapshotPtr m_current;
+};
+
+#endif // DUNGEONSNAPSHOT_H
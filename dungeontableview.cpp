@@ -1,9 +1,12 @@
 #include "dungeontableview.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "tracer.h"
 #include <QPainter>
 #include <QPen>
 #include <QResizeEvent>
+#include <QPaintEvent>
 #include <QHeaderView>
-#include <QDebug>
 
 DungeonItemDelegate::DungeonItemDelegate(QObject *parent)
     : QStyledItemDelegate(parent) {
@@ -11,10 +14,11 @@ DungeonItemDelegate::DungeonItemDelegate(QObject *parent)
 
 void DungeonItemDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
                                 const QModelIndex &index) const {
+    TRACE_SCOPE("DungeonItemDelegate::paint");
     try {
         safePaint(painter, option, index);
     } catch (const std::exception& e) {
-        qDebug() << "Delegate paint error:" << e.what();
+        LOG_WARNING("Delegate paint error: %s", e.what());
         // 绘制默认样式作为后备
         QStyledItemDelegate::paint(painter, option, index);
     }
@@ -83,7 +87,7 @@ QSize DungeonItemDelegate::sizeHint(const QStyleOptionViewItem &option,
         Q_UNUSED(index)
         return QSize(50, 50); // 默认单元格大小
     } catch (const std::exception& e) {
-        qDebug() << "Delegate sizeHint error:" << e.what();
+        LOG_WARNING("Delegate sizeHint error: %s", e.what());
         return QSize(50, 50); // 返回默认大小
     }
 }
@@ -107,7 +111,7 @@ DungeonTableView::DungeonTableView(QWidget *parent)
         verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
 
     } catch (const std::exception& e) {
-        qDebug() << "DungeonTableView constructor error:" << e.what();
+        LOG_WARNING("DungeonTableView constructor error: %s", e.what());
         // 确保m_delegate不为空
         if (!m_delegate) {
             m_delegate = new DungeonItemDelegate(this);
@@ -120,7 +124,7 @@ void DungeonTableView::updateCellSize() {
     try {
         safeUpdateCellSize();
     } catch (const std::exception& e) {
-        qDebug() << "updateCellSize error:" << e.what();
+        LOG_WARNING("updateCellSize error: %s", e.what());
         // 设置默认大小作为后备
         horizontalHeader()->setDefaultSectionSize(50);
         verticalHeader()->setDefaultSectionSize(50);
@@ -189,8 +193,15 @@ void DungeonTableView::resizeEvent(QResizeEvent *event) {
         QTableView::resizeEvent(event);
         updateCellSize();
     } catch (const std::exception& e) {
-        qDebug() << "resizeEvent error:" << e.what();
+        LOG_WARNING("resizeEvent error: %s", e.what());
         // 调用基类的resizeEvent作为后备
         QTableView::resizeEvent(event);
     }
 }
+
+void DungeonTableView::paintEvent(QPaintEvent *event) {
+    // 整个视口重绘的耗时和其中的模型data()调用次数记为一帧
+    uint64_t begin = PerfMetrics::now();
+    QTableView::paintEvent(event);
+    PerfMetrics::instance().recordFrame(begin, PerfMetrics::now());
+}
@@ -0,0 +1,312 @@
+#include "fourwaysolver.h"
+#include "logger.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// 方向依次为右、下、左、上
+const int DX[4] = {1, 0, -1, 0};
+const int DY[4] = {0, 1, 0, -1};
+
+// m_parent取值：0~3为下一步的方向，TARGET为公主格子，PUMP+方向为与该方向的格子来回回血
+const uint8_t NONE = 0xFF;
+const uint8_t TARGET = 4;
+const uint8_t PUMP = 8;
+
+} // namespace
+
+void FourWaySolver::solve(const int* map, const uint64_t* walls, int rows, int cols,
+                          const std::vector<QPoint>& targets, int* need) {
+    try {
+        if (!map || !need || rows <= 0 || cols <= 0) {
+            throw FourWaySolverException("地图数据为空");
+        }
+        size_t count = static_cast<size_t>(rows) * cols;
+        if (count > UINT32_MAX) {
+            throw FourWaySolverException("地图过大");
+        }
+        if (targets.empty()) {
+            throw FourWaySolverException("至少需要一个公主格子");
+        }
+
+        m_rows = rows;
+        m_cols = cols;
+        m_parent.assign(count, NONE);
+        std::fill(need, need + count, INT_MAX);
+
+        // 没有墙壁时不做掩码和连通性检查
+        const uint64_t* mask = WallMask::any(walls, count) ? walls : nullptr;
+
+        // 相邻两次入队值之差不超过单格最大伤害，种子值不超过两倍，环形桶数按此确定
+        int maxDamage = 0;
+        for (size_t k = 0; k < count; ++k) {
+            maxDamage = std::max(maxDamage, -map[k]);
+        }
+        size_t ringSize = 2 * static_cast<size_t>(maxDamage) + 2;
+        std::vector<std::vector<uint32_t>> ring(ringSize);
+        size_t pending = 0;
+
+        auto push = [&](uint32_t k) {
+            ring[static_cast<size_t>(need[k]) % ringSize].push_back(k);
+            pending++;
+        };
+
+        for (const QPoint& t : targets) {
+            if (t.x() < 0 || t.x() >= cols || t.y() < 0 || t.y() >= rows) {
+                throw FourWaySolverException("公主格子超出地图范围");
+            }
+            size_t k = static_cast<size_t>(t.y()) * cols + t.x();
+            if (WallMask::isWall(mask, k)) {
+                continue;   // 被墙壁占据的公主格子无法到达
+            }
+            m_parent[k] = TARGET;
+            need[k] = std::max(1, 1 - map[k]);
+        }
+
+        // 有墙壁时回血对只有与公主连通才有用，先从公主格子出发标记连通的空地
+        std::vector<uint8_t> connected;
+        if (mask) {
+            connected.assign(count, 0);
+            std::vector<uint32_t> queue;
+            for (size_t k = 0; k < count; ++k) {
+                if (m_parent[k] == TARGET) {
+                    connected[k] = 1;
+                    queue.push_back(static_cast<uint32_t>(k));
+                }
+            }
+            for (size_t head = 0; head < queue.size(); ++head) {
+                int i = static_cast<int>(queue[head] / cols);
+                int j = static_cast<int>(queue[head] % cols);
+                for (int d = 0; d < 4; ++d) {
+                    int ni = i + DY[d];
+                    int nj = j + DX[d];
+                    if (ni < 0 || ni >= rows || nj < 0 || nj >= cols) {
+                        continue;
+                    }
+                    size_t nk = static_cast<size_t>(ni) * cols + nj;
+                    if (!connected[nk] && !WallMask::isWall(mask, nk)) {
+                        connected[nk] = 1;
+                        queue.push_back(static_cast<uint32_t>(nk));
+                    }
+                }
+            }
+        }
+
+        // 回血对：撑过第一个来回之后健康值可以无限增加，之后一定能走到公主
+        for (int i = 0; i < rows; ++i) {
+            for (int j = 0; j < cols; ++j) {
+                size_t k = static_cast<size_t>(i) * cols + j;
+                if (m_parent[k] == TARGET) {
+                    push(static_cast<uint32_t>(k));
+                    continue;
+                }
+                if (mask && !connected[k]) {
+                    continue;
+                }
+
+                for (int d = 0; d < 4; ++d) {
+                    int ni = i + DY[d];
+                    int nj = j + DX[d];
+                    if (ni < 0 || ni >= rows || nj < 0 || nj >= cols) {
+                        continue;
+                    }
+                    size_t nk = static_cast<size_t>(ni) * cols + nj;
+                    if (m_parent[nk] == TARGET || map[k] + map[nk] <= 0 || WallMask::isWall(mask, nk)) {
+                        continue;
+                    }
+
+                    int seed = std::max({1, 1 - map[k], 1 - map[k] - map[nk]});
+                    if (seed < need[k]) {
+                        need[k] = seed;
+                        m_parent[k] = static_cast<uint8_t>(PUMP + d);
+                    }
+                }
+
+                if (need[k] != INT_MAX) {
+                    push(static_cast<uint32_t>(k));
+                }
+            }
+        }
+
+        long long cursor = 1;
+        std::vector<uint32_t> immediate;
+
+        // w的所需值确定后更新以w为下一步的相邻格子
+        auto relax = [&](uint32_t w) {
+            int wi = static_cast<int>(w / cols);
+            int wj = static_cast<int>(w % cols);
+            for (int d = 0; d < 4; ++d) {
+                int ui = wi - DY[d];
+                int uj = wj - DX[d];
+                if (ui < 0 || ui >= rows || uj < 0 || uj >= cols) {
+                    continue;
+                }
+                size_t uk = static_cast<size_t>(ui) * cols + uj;
+                if (m_parent[uk] == TARGET || WallMask::isWall(mask, uk)) {
+                    continue;   // 到达公主即结束，不会从公主格子继续走；墙壁不能进入
+                }
+
+                long long candidate = std::max(1LL, static_cast<long long>(need[w]) - map[uk]);
+                if (candidate >= need[uk]) {
+                    continue;
+                }
+                if (candidate >= INT_MAX) {
+                    throw FourWaySolverException("所需健康值超出范围");
+                }
+
+                need[uk] = static_cast<int>(candidate);
+                m_parent[uk] = static_cast<uint8_t>(d);
+                if (candidate < cursor) {
+                    immediate.push_back(static_cast<uint32_t>(uk));  // 经过回血格子，比当前出队值还小
+                } else {
+                    push(static_cast<uint32_t>(uk));
+                }
+            }
+        };
+
+        size_t settled = 0;
+        for (; pending > 0; ++cursor) {
+            std::vector<uint32_t>& bucket = ring[static_cast<size_t>(cursor % static_cast<long long>(ringSize))];
+            while (!bucket.empty()) {
+                uint32_t k = bucket.back();
+                bucket.pop_back();
+                pending--;
+                if (need[k] != cursor) {
+                    continue;   // 已被更小的值取代
+                }
+
+                settled++;
+                relax(k);
+                while (!immediate.empty()) {
+                    uint32_t u = immediate.back();
+                    immediate.pop_back();
+                    relax(u);
+                }
+            }
+        }
+
+        LOG_DEBUG("Four-way solve: %d x %d settled %zu max key %lld", rows, cols, settled, cursor - 1);
+
+    } catch (const FourWaySolverException& e) {
+        m_parent.clear();
+        throw;
+    } catch (const std::exception& e) {
+        m_parent.clear();
+        throw FourWaySolverException(std::string("四向求解失败: ") + e.what());
+    }
+}
+
+std::vector<QPoint> FourWaySolver::tracePath(const int* map, const uint64_t* walls, const int* need,
+                                             const QPoint& start) const {
+    try {
+        if (m_parent.size() != static_cast<size_t>(m_rows) * m_cols ||
+            start.x() < 0 || start.x() >= m_cols || start.y() < 0 || start.y() >= m_rows) {
+            throw FourWaySolverException("尚未求解");
+        }
+
+        auto index = [this](const QPoint& p) { return static_cast<size_t>(p.y()) * m_cols + p.x(); };
+
+        // 被墙壁挡住、无法到达公主时只返回起点
+        if (need[index(start)] == INT_MAX) {
+            return std::vector<QPoint>(1, start);
+        }
+
+        std::vector<QPoint> path;
+        QPoint pos = start;
+        long long health = need[index(start)];
+        size_t maxSteps = m_parent.size();
+
+        // 沿下一步方向前进，每个方向都指向所需值确定得更早的格子，不会成环
+        for (size_t step = 0;; ++step) {
+            size_t k = index(pos);
+            path.push_back(pos);
+            health += map[k];
+            if (health <= 0 || step > maxSteps) {
+                throw FourWaySolverException("回溯路线失败");
+            }
+
+            uint8_t parent = m_parent[k];
+            if (parent == TARGET) {
+                break;
+            }
+            if (parent == NONE) {
+                throw FourWaySolverException("回溯路线失败：格子不可达");
+            }
+
+            if (parent >= PUMP) {
+                // 先来回回血到足够走完剩下的路，再沿最短路走到公主
+                int d = parent - PUMP;
+                QPoint partner(pos.x() + DX[d], pos.y() + DY[d]);
+                std::vector<QPoint> rest = pathToTarget(pos, walls);
+
+                long long sum = 0;
+                long long lowest = 0;
+                for (const QPoint& p : rest) {
+                    sum += map[index(p)];
+                    lowest = std::min(lowest, sum);
+                }
+
+                while (health < 1 - lowest) {
+                    path.push_back(partner);
+                    health += map[index(partner)];
+                    path.push_back(pos);
+                    health += map[k];
+                }
+                path.insert(path.end(), rest.begin(), rest.end());
+                break;
+            }
+
+            pos = QPoint(pos.x() + DX[parent], pos.y() + DY[parent]);
+        }
+
+        return path;
+
+    } catch (const FourWaySolverException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw FourWaySolverException(std::string("回溯路线失败: ") + e.what());
+    }
+}
+
+std::vector<QPoint> FourWaySolver::pathToTarget(const QPoint& from, const uint64_t* walls) const {
+    // 广度优先找最近的公主格子，from本身不在结果中
+    std::vector<uint8_t> cameFrom(m_parent.size(), NONE);
+    std::vector<uint32_t> queue;
+    size_t start = static_cast<size_t>(from.y()) * m_cols + from.x();
+    queue.push_back(static_cast<uint32_t>(start));
+    cameFrom[start] = TARGET;
+
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t k = queue[head];
+        if (m_parent[k] == TARGET) {
+            std::vector<QPoint> path;
+            for (size_t p = k; p != start;) {
+                int i = static_cast<int>(p / m_cols);
+                int j = static_cast<int>(p % m_cols);
+                path.push_back(QPoint(j, i));
+                int d = cameFrom[p];
+                p = static_cast<size_t>(i - DY[d]) * m_cols + (j - DX[d]);
+            }
+            std::reverse(path.begin(), path.end());
+            return path;
+        }
+
+        int i = static_cast<int>(k / m_cols);
+        int j = static_cast<int>(k % m_cols);
+        for (int d = 0; d < 4; ++d) {
+            int ni = i + DY[d];
+            int nj = j + DX[d];
+            if (ni < 0 || ni >= m_rows || nj < 0 || nj >= m_cols) {
+                continue;
+            }
+            size_t nk = static_cast<size_t>(ni) * m_cols + nj;
+            if (cameFrom[nk] == NONE && !WallMask::isWall(walls, nk)) {
+                cameFrom[nk] = static_cast<uint8_t>(d);
+                queue.push_back(static_cast<uint32_t>(nk));
+            }
+        }
+    }
+
+    throw FourWaySolverException("无法到达公主格子");
+}
@@ -0,0 +1,45 @@
+#ifndef FOURWAYSOLVER_H
+#define FOURWAYSOLVER_H
+
+#include <QPoint>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "wallmask.h"
+
+class FourWaySolverException : public std::runtime_error {
+public:
+    explicit FourWaySolverException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 四向移动、每次进入房间都生效时的最小初始健康值求解。
+//
+// need[v]为进入v（计入其效果前）所需的最小健康值，满足
+//   need[t] = max(1, 1 - map[t])                      t为公主格子，到达即结束
+//   need[v] = max(1, min(need[w]) - map[v])           w为v的四个相邻格子
+// 这是一个极小化路径上最大亏空的瓶颈问题。边权-map[v]可能为负，不能直接用Dijkstra，但网格是二分图，
+// 任意回路都由相邻两格成对组成，所以存在增益回路当且仅当某对相邻格子之和为正。
+// 这样的一对格子可以来回走无限回血，进入其中一格时只需能撑过第一个来回，直接作为种子值；
+// 其余相邻格子之和都不为正，经过回血格子后再走一步所需值就不会低于当前出队值，
+// 因此按所需值从小到大用桶队列（Dial算法）处理，回血格子产生的更小值立即就地展开即可，
+// 每个格子只出队常数次，桶数只与单格最大伤害有关。
+// 墙壁格子不能进入；有墙壁时回血对只在与公主连通的区域内作为种子。
+class FourWaySolver {
+public:
+    // 求解结果写入need（rows*cols，行优先），targets为公主格子，walls为空表示没有墙壁
+    void solve(const int* map, const uint64_t* walls, int rows, int cols, const std::vector<QPoint>& targets, int* need);
+
+    // 以need[start]从start出发到公主格子的一条可行路线，可能包含来回回血的往返；无法到达时只返回起点
+    std::vector<QPoint> tracePath(const int* map, const uint64_t* walls, const int* need, const QPoint& start) const;
+
+    void clear() { m_parent.clear(); }
+
+private:
+    int m_rows = 0;
+    int m_cols = 0;
+    std::vector<uint8_t> m_parent;  // 每格的下一步方向，见fourwaysolver.cpp
+
+    std::vector<QPoint> pathToTarget(const QPoint& from, const uint64_t* walls) const;
+};
+
+#endif // FOURWAYSOLVER_H
@@ -8,20 +8,77 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# 取消注释可在编译时移除内置跟踪（TRACE_SCOPE展开为空）
+#DEFINES += DUNGEON_NO_TRACE
+
+# 编译时移除低于该级别的日志（0=调试，1=信息，2=警告，3=错误，4=全部移除）
+#DEFINES += DUNGEON_LOG_LEVEL=2
+
 SOURCES += \
+    bandcluster.cpp \
+    checkpointsolver.cpp \
+    compactpath.cpp \
     dungeon.cpp \
+    dungeonarena.cpp \
+    dungeonfile.cpp \
     dungeonmapmodel.cpp \
     dungeontableview.cpp \
+    fourwaysolver.cpp \
+    healthquery.cpp \
+    hintengine.cpp \
+    lexicographicsolver.cpp \
+    logger.cpp \
     main.cpp \
     mainwindow.cpp \
-    maptablewindow.cpp
+    maphash.cpp \
+    mapimporter.cpp \
+    maptablewindow.cpp \
+    optimalcorridor.cpp \
+    perfmetrics.cpp \
+    replayvalidator.cpp \
+    routeplan.cpp \
+    solutioncache.cpp \
+    solverclient.cpp \
+    solverservice.cpp \
+    streamingsolver.cpp \
+    taskpool.cpp \
+    toppaths.cpp \
+    tracer.cpp \
+    wallmask.cpp
 
 HEADERS += \
+    bandcluster.h \
+    checkpointsolver.h \
+    compactpath.h \
     dungeon.h \
+    dungeonarena.h \
+    dungeonfile.h \
     dungeonmapmodel.h \
+    dungeonsnapshot.h \
     dungeontableview.h \
+    fourwaysolver.h \
+    healthquery.h \
+    healthstep.h \
+    hintengine.h \
+    lexicographicsolver.h \
+    logger.h \
     mainwindow.h \
-    maptablewindow.h
+    maphash.h \
+    mapimporter.h \
+    maptablewindow.h \
+    optimalcorridor.h \
+    perfmetrics.h \
+    replayvalidator.h \
+    routeplan.h \
+    solutioncache.h \
+    solverclient.h \
+    solverprotocol.h \
+    solverservice.h \
+    streamingsolver.h \
+    taskpool.h \
+    toppaths.h \
+    tracer.h \
+    wallmask.h
 
 FORMS += \
     mainwindow.ui
@@ -0,0 +1,241 @@
+#include "healthquery.h"
+#include "dungeon.h"
+#include "healthstep.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <random>
+
+namespace {
+
+// 共享同一终点的一组查询，order中按起点行从下到上排列
+struct TargetGroup {
+    int row;
+    int col;
+    int minRow;     // 本组起点的最小行、列，反向DP扫到这里为止
+    int minCol;
+    size_t begin;   // 在order中的起止位置
+    size_t end;
+};
+
+void validateQuery(const DungeonSnapshot& snapshot, const HealthQuery& query, size_t index) {
+    const QPoint& a = query.from;
+    const QPoint& b = query.to;
+    bool inside = a.x() >= 0 && a.y() >= 0 && b.x() < snapshot.cols && b.y() < snapshot.rows;
+    if (!inside || a.x() > b.x() || a.y() > b.y()) {
+        throw HealthQueryException("第" + std::to_string(index + 1) + "个查询无效：起点必须在终点左上方且都在地图内");
+    }
+}
+
+// 对一组查询做反向DP，buffer为该线程的一行状态；Walls为false时没有墙壁，不做掩码
+template <bool Walls>
+void solveGroup(const DungeonSnapshot& snapshot, const TargetGroup& group,
+                const std::vector<size_t>& order, const std::vector<HealthQuery>& queries,
+                std::vector<int>& results, std::vector<int>& buffer) {
+    buffer.resize(static_cast<size_t>(snapshot.cols));
+    int* dp = buffer.data();
+    int cap = snapshot.healthCap > 0 ? snapshot.healthCap : INT_MAX;
+    const uint64_t* walls = snapshot.wallBits();
+    size_t next = group.begin;
+
+    for (int i = group.row; i >= group.minRow && next < group.end; --i) {
+        const int* mapRow = snapshot.getMapRow(i);
+        size_t base = snapshot.cellIndex(i, 0);
+        auto block = [walls, base](int need, int j) {
+            return Walls ? WallMask::masked(need, WallMask::isWall(walls, base + j), INT_MAX) : need;
+        };
+
+        // 与Dungeon::solveDp()相同的递推（含健康上限和墙壁），终点右侧和下方视为不可走
+        if (i == group.row) {
+            dp[group.col] = block(neededHealth(1, mapRow[group.col], cap), group.col);
+            for (int j = group.col - 1; j >= group.minCol; --j) {
+                dp[j] = block(neededHealth(dp[j+1], mapRow[j], cap), j);
+            }
+        } else {
+            dp[group.col] = block(neededHealth(dp[group.col], mapRow[group.col], cap), group.col);
+            for (int j = group.col - 1; j >= group.minCol; --j) {
+                dp[j] = block(neededHealth(std::min(dp[j], dp[j+1]), mapRow[j], cap), j);
+            }
+        }
+
+        while (next < group.end && queries[order[next]].from.y() == i) {
+            size_t k = order[next++];
+            results[k] = dp[queries[k].from.x()];
+        }
+    }
+}
+
+} // namespace
+
+HealthQueryBatch::HealthQueryBatch(unsigned threadCount)
+    : m_threadCount(threadCount) {
+    if (m_threadCount == 0) {
+        m_threadCount = TaskPool::instance().workerCount() + 1;
+    }
+}
+
+std::vector<int> HealthQueryBatch::run(const DungeonSnapshot& snapshot, const std::vector<HealthQuery>& queries) const {
+    TRACE_SCOPE("HealthQueryBatch::run");
+    try {
+        if (!snapshot.map || snapshot.rows <= 0 || snapshot.cols <= 0) {
+            throw HealthQueryException("地图快照为空");
+        }
+
+        std::vector<int> results(queries.size(), 0);
+        std::vector<size_t> order;
+        order.reserve(queries.size());
+
+        // 自定义路线的dp表不是到右下角的解，不能直接查表；健康上限模式下的表可以，但为简单起见统一走扫描
+        bool classic = snapshot.isClassic();
+        QPoint exit(snapshot.cols - 1, snapshot.rows - 1);
+        for (size_t k = 0; k < queries.size(); ++k) {
+            validateQuery(snapshot, queries[k], k);
+
+            // 以地图终点为终点的查询就是全图dp表中的值
+            if (classic && snapshot.dp && queries[k].to == exit) {
+                results[k] = snapshot.getDpValue(queries[k].from.y(), queries[k].from.x());
+            } else {
+                order.push_back(k);
+            }
+        }
+
+        // 按终点分组，组内按起点行从下到上
+        std::sort(order.begin(), order.end(), [&queries](size_t a, size_t b) {
+            const HealthQuery& qa = queries[a];
+            const HealthQuery& qb = queries[b];
+            if (qa.to.y() != qb.to.y()) return qa.to.y() < qb.to.y();
+            if (qa.to.x() != qb.to.x()) return qa.to.x() < qb.to.x();
+            return qa.from.y() > qb.from.y();
+        });
+
+        std::vector<TargetGroup> groups;
+        for (size_t k = 0; k < order.size();) {
+            const HealthQuery& first = queries[order[k]];
+            TargetGroup group{first.to.y(), first.to.x(), first.from.y(), first.from.x(), k, k};
+            while (group.end < order.size() && queries[order[group.end]].to == first.to) {
+                const HealthQuery& query = queries[order[group.end]];
+                group.minRow = std::min(group.minRow, query.from.y());
+                group.minCol = std::min(group.minCol, query.from.x());
+                group.end++;
+            }
+            groups.push_back(group);
+            k = group.end;
+        }
+
+        // 各组的扫描范围差别很大，用共享计数器动态分配；界面上框选时等待结果，按高优先级提交
+        size_t taskCount = std::min<size_t>(m_threadCount, groups.size());
+        std::atomic<size_t> nextGroup(0);
+        bool walls = WallMask::any(snapshot.wallBits(), static_cast<size_t>(snapshot.rows) * snapshot.cols);
+
+        parallelFor(taskCount, TaskPriority::High, [&](size_t) {
+            std::vector<int> buffer;
+            for (size_t g = nextGroup++; g < groups.size(); g = nextGroup++) {
+                if (walls) {
+                    solveGroup<true>(snapshot, groups[g], order, queries, results, buffer);
+                } else {
+                    solveGroup<false>(snapshot, groups[g], order, queries, results, buffer);
+                }
+            }
+        });
+
+        LOG_DEBUG("Health queries answered: %zu with %zu sweeps", queries.size(), groups.size());
+        return results;
+
+    } catch (const HealthQueryException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw HealthQueryException(std::string("批量查询失败: ") + e.what());
+    }
+}
+
+HealthQueryBenchmarkResult runHealthQueryBenchmark(const HealthQueryBenchmarkOptions& options) {
+    TRACE_SCOPE("runHealthQueryBenchmark");
+    try {
+        if (options.mapSize <= 0 || options.queries <= 0 || options.sharedTargets <= 0 || options.baselineSamples < 0) {
+            throw HealthQueryException("基准测试参数必须为正数");
+        }
+
+        int size = options.mapSize;
+        std::mt19937_64 random(options.seed);
+        std::uniform_int_distribution<int> cellValue(-4, 2);
+        std::vector<int> cells(static_cast<size_t>(size) * size);
+        for (int& cell : cells) {
+            cell = cellValue(random);
+        }
+        Dungeon dungeon;
+        dungeon.loadMap(size, size, std::move(cells));
+        DungeonSnapshotPtr snapshot = dungeon.snapshot();
+
+        // 起点在终点左上方：两个坐标各自取两个随机数，小的给起点
+        std::uniform_int_distribution<int> coordinate(0, size - 1);
+        auto randomQuery = [&](QPoint to) {
+            int row = std::uniform_int_distribution<int>(0, to.y())(random);
+            int col = std::uniform_int_distribution<int>(0, to.x())(random);
+            return HealthQuery{QPoint(col, row), to};
+        };
+        std::vector<QPoint> targets(options.sharedTargets);
+        for (QPoint& target : targets) {
+            target = QPoint(coordinate(random), coordinate(random));
+        }
+        std::vector<HealthQuery> randomQueries;
+        std::vector<HealthQuery> sharedQueries;
+        std::vector<HealthQuery> exitQueries;
+        for (int k = 0; k < options.queries; ++k) {
+            int r1 = coordinate(random), r2 = coordinate(random);
+            int c1 = coordinate(random), c2 = coordinate(random);
+            randomQueries.push_back(HealthQuery{QPoint(std::min(c1, c2), std::min(r1, r2)),
+                                                QPoint(std::max(c1, c2), std::max(r1, r2))});
+            sharedQueries.push_back(randomQuery(targets[random() % targets.size()]));
+            exitQueries.push_back(randomQuery(QPoint(size - 1, size - 1)));
+        }
+
+        HealthQueryBatch batch;
+        HealthQueryBenchmarkResult result;
+        result.threads = TaskPool::instance().workerCount() + 1;
+        auto timed = [&](const std::vector<HealthQuery>& queries, double& seconds) {
+            uint64_t start = PerfMetrics::now();
+            std::vector<int> answers = batch.run(*snapshot, queries);
+            seconds = (PerfMetrics::now() - start) / 1e9;
+            return answers;
+        };
+        std::vector<int> answers = timed(randomQueries, result.randomSeconds);
+        timed(sharedQueries, result.sharedTargetSeconds);
+        timed(exitQueries, result.exitSeconds);
+
+        // 对照：与批量查询无关的实现，把每个查询的子矩形复制成一张新地图，由Dungeon::solveDp重新求解
+        size_t samples = std::min<size_t>(options.baselineSamples, randomQueries.size());
+        if (samples > 0) {
+            const int* map = snapshot->map.get();
+            uint64_t start = PerfMetrics::now();
+            for (size_t k = 0; k < samples; ++k) {
+                const HealthQuery& query = randomQueries[k];
+                int rows = query.to.y() - query.from.y() + 1;
+                int cols = query.to.x() - query.from.x() + 1;
+                std::vector<int> rect(static_cast<size_t>(rows) * cols);
+                for (int i = 0; i < rows; ++i) {
+                    const int* src = map + snapshot->cellIndex(query.from.y() + i, query.from.x());
+                    std::copy(src, src + cols, rect.begin() + static_cast<size_t>(i) * cols);
+                }
+                Dungeon reference;
+                reference.loadMap(rows, cols, std::move(rect));
+                if (reference.calculateMinHealth() != answers[k]) {
+                    ++result.mismatches;
+                }
+            }
+            result.baselineSeconds = (PerfMetrics::now() - start) / 1e9 * randomQueries.size() / samples;
+        }
+
+        LOG_INFO("Health query benchmark: %d x %d, %d queries, random %.3f s, shared targets %.3f s, exit %.3f s",
+                 size, size, options.queries, result.randomSeconds, result.sharedTargetSeconds, result.exitSeconds);
+        return result;
+
+    } catch (const HealthQueryException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw HealthQueryException(std::string("查询基准测试失败: ") + e.what());
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef HEALTHQUERY_H
+#define HEALTHQUERY_H
+
+#include <QPoint>
+#include <stdexcept>
+#include <vector>
+#include "dungeonsnapshot.h"
+
+// 一次A→B查询：从from出发只向右或向下走到to（x为列，y为行），
+// 结果为进入from之前所需的最小健康值，途经格子（含两端）之后健康值都需大于0；
+// 快照带有健康上限时按上限计算，不可行时为INT_MAX
+struct HealthQuery {
+    QPoint from;
+    QPoint to;
+};
+
+class HealthQueryException : public std::runtime_error {
+public:
+    explicit HealthQueryException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 离线批量回答A→B最小健康值查询，适合终点重复的批次（例如都到出口或到少数几个目标格）。
+// 所需健康值取决于前缀和，跨分割线时无法只凭两侧的单个数值拼接，
+// 所以不做分治预处理，唯一的复用是按终点合并查询：
+// - 终点为地图终点的查询直接读快照中的dp表，O(1)；
+// - 其余查询按终点分组，每组只做一次覆盖本组全部起点的反向DP，
+//   只保留一行状态，扫到起点所在行时直接取值；
+// - 各组相互独立，在任务池中并行处理（threadCount为0时按任务池的线程数）。
+// 终点各不相同时（如均匀随机的起终点对）每个查询各占一次子矩形扫描，总工作量与逐个重新求解相同，
+// 只是分摊到多个线程上，并不更快。
+class HealthQueryBatch {
+public:
+    explicit HealthQueryBatch(unsigned threadCount = 0);
+
+    // 结果与queries一一对应；有非法查询时抛出HealthQueryException
+    std::vector<int> run(const DungeonSnapshot& snapshot, const std::vector<HealthQuery>& queries) const;
+
+private:
+    unsigned m_threadCount;
+};
+
+struct HealthQueryBenchmarkOptions {
+    int mapSize = 2000;             // 地图边长
+    int queries = 100000;           // 每种查询分布的查询数
+    int sharedTargets = 64;         // 共享终点分布中不同终点的个数
+    int baselineSamples = 200;      // 逐个用Dungeon重新求解的抽样数，用时按比例外推，结果与批量查询核对
+    uint64_t seed = 1;
+};
+
+struct HealthQueryBenchmarkResult {
+    unsigned threads = 0;           // 批量查询使用的线程数
+    double randomSeconds = 0;       // 起点、终点都随机
+    double sharedTargetSeconds = 0; // 终点取自sharedTargets个固定格子，起点随机
+    double exitSeconds = 0;         // 终点都是地图终点，直接查表
+    double baselineSeconds = 0;     // 随机查询逐个复制子矩形、由Dungeon::solveDp重新求解的外推用时
+    size_t mismatches = 0;          // 抽样中批量结果与重新求解不同的查询数
+};
+
+// 基准测试：在mapSize×mapSize的随机地图上按三种分布各生成queries个查询，分别计时批量回答
+HealthQueryBenchmarkResult runHealthQueryBenchmark(const HealthQueryBenchmarkOptions& options);
+
+#endif // HEALTHQUERY_H
@@ -0,0 +1,33 @@
+#ifndef HEALTHSTEP_H
+#define HEALTHSTEP_H
+
+#include <algorithm>
+#include <climits>
+
+// 单个格子的正向/反向递推，各求解器共用。
+// cap为健康上限，INT_MAX表示不限；房间效果生效后健康值不超过上限。
+
+// 以arrive的健康值进入值为cell的格子后离开时的健康值，倒下时为0
+inline int leaveHealth(int arrive, int cell, int cap = INT_MAX) {
+    if (arrive <= 0) {
+        return 0;
+    }
+    long long health = static_cast<long long>(arrive) + cell;
+    if (health <= 0) {
+        return 0;
+    }
+    return health > cap ? cap : static_cast<int>(health);
+}
+
+// 离开格子后至少需要next时，进入值为cell的格子前至少需要的健康值，INT_MAX表示不可行。
+// 有上限时离开后的健康值为min(cap, h + cell)，它不小于next当且仅当next <= cap且h + cell >= next，
+// 所以只需在经典递推的基础上把超过上限的格子标为不可行，结果仍然精确。
+inline int neededHealth(int next, int cell, int cap = INT_MAX) {
+    if (next == INT_MAX || next > cap) {
+        return INT_MAX;
+    }
+    int need = std::max(1, next - cell);
+    return need > cap ? INT_MAX : need;
+}
+
+#endif // HEALTHSTEP_H
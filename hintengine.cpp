@@ -0,0 +1,93 @@
+#include "hintengine.h"
+#include "logger.h"
+#include <algorithm>
+#include <climits>
+
+void HintEngine::setSnapshot(DungeonSnapshotPtr snapshot) {
+    m_snapshot = std::move(snapshot);
+    reset();
+}
+
+void HintEngine::reset() {
+    m_bestPath.clear();
+    m_offset = 0;
+}
+
+MoveHint HintEngine::update(const QPoint& pos, int currentHealth, size_t nextWaypoint) {
+    MoveHint hint;
+
+    try {
+        if (!m_snapshot || !m_snapshot->dp) {
+            return hint;
+        }
+
+        const DungeonSnapshot& s = *m_snapshot;
+        if (s.movement == MovementMode::FOUR_WAY) {
+            return hint;    // 提示只按向右/向下两个方向计算
+        }
+        int row = pos.y();
+        int col = pos.x();
+        if (row < 0 || row >= s.rows || col < 0 || col >= s.cols) {
+            return hint;
+        }
+
+        hint.valid = true;
+        hint.rightAvailable = col + 1 < s.cols;
+        hint.downAvailable = row + 1 < s.rows;
+
+        // 当前格子的效果已经计入，下一步需要的就是相邻格子的dp值；
+        // 越过下一个路点的格子不在当前这一段内，视为无法获胜
+        QPoint limit = legLimit(s.route, s.rows, s.cols, nextWaypoint);
+        hint.atTarget = nextWaypoint >= s.route.waypoints.size() && s.route.isTarget(pos);
+        int rightNeed = hint.rightAvailable && col < limit.x() ? s.getDpValue(row, col + 1) : INT_MAX;
+        int downNeed = hint.downAvailable && row < limit.y() ? s.getDpValue(row + 1, col) : INT_MAX;
+
+        if (hint.atTarget) {
+            // 已在公主格子
+            hint.healthNeeded = 1;
+        } else {
+            hint.healthNeeded = std::min(rightNeed, downNeed);
+        }
+
+        hint.canStillWin = currentHealth >= hint.healthNeeded;
+        hint.slack = currentHealth - hint.healthNeeded;
+        hint.rightSafe = hint.rightAvailable && currentHealth >= rightNeed;
+        hint.downSafe = hint.downAvailable && currentHealth >= downNeed;
+
+        // 与Dungeon回溯最优路径的规则一致：相等时优先向下
+        if (hint.atTarget || (downNeed == INT_MAX && rightNeed == INT_MAX)) {
+            hint.recommended = QPoint();
+        } else if (downNeed <= rightNeed) {
+            hint.recommended = QPoint(0, 1);
+        } else {
+            hint.recommended = QPoint(1, 0);
+        }
+
+        // 玩家沿着上次的最优路径前进时只需移动起点
+        if (m_offset + 1 < m_bestPath.size() && m_bestPath[m_offset + 1] == pos) {
+            m_offset++;
+        } else if (m_offset >= m_bestPath.size() || m_bestPath[m_offset] != pos) {
+            tracePathFrom(pos, nextWaypoint);
+        }
+
+        return hint;
+
+    } catch (const std::exception& e) {
+        LOG_WARNING("HintEngine update error: %s", e.what());
+        reset();
+        return MoveHint();
+    }
+}
+
+std::vector<QPoint> HintEngine::remainingPath() const {
+    if (m_offset >= m_bestPath.size()) {
+        return {};
+    }
+    return std::vector<QPoint>(m_bestPath.begin() + m_offset, m_bestPath.end());
+}
+
+void HintEngine::tracePathFrom(const QPoint& pos, size_t nextWaypoint) {
+    const DungeonSnapshot& s = *m_snapshot;
+    m_bestPath = traceRoute(s.dp.get(), s.rows, s.cols, s.route, pos, nextWaypoint);
+    m_offset = 0;
+}
@@ -0,0 +1,44 @@
+#ifndef HINTENGINE_H
+#define HINTENGINE_H
+
+#include <QPoint>
+#include <vector>
+#include "dungeonsnapshot.h"
+
+// 手动模式下某一时刻的提示
+struct MoveHint {
+    bool valid = false;         // 是否有可用的快照和合法位置
+    bool canStillWin = false;   // 当前健康值是否仍足以到达终点
+    int healthNeeded = 0;       // 离开当前格子时至少需要的健康值
+    int slack = 0;              // 当前健康值与所需健康值之差
+    bool atTarget = false;      // 已经过所有路点并到达公主格子
+    bool rightAvailable = false;
+    bool downAvailable = false;
+    bool rightSafe = false;     // 向右走之后仍可能获胜
+    bool downSafe = false;      // 向下走之后仍可能获胜
+    QPoint recommended;         // 推荐的移动方向，(0,0)表示无
+};
+
+// 基于已求解DP表的提示引擎。dp[i][j]就是进入(i,j)时需要的最小健康值，
+// 所以每次移动只需比较相邻格子的dp值，不需要重新求解。
+// 最优剩余路径在玩家按推荐方向移动时只前移起点，偏离时才重新沿dp回溯。
+class HintEngine {
+public:
+    void setSnapshot(DungeonSnapshotPtr snapshot);
+    void reset();
+
+    // 玩家到达pos（已计入该格效果）后调用，nextWaypoint是尚未经过的第一个路点
+    MoveHint update(const QPoint& pos, int currentHealth, size_t nextWaypoint = 0);
+
+    // 从当前格子经剩余路点到公主格子的最优剩余路径
+    std::vector<QPoint> remainingPath() const;
+
+private:
+    DungeonSnapshotPtr m_snapshot;
+    std::vector<QPoint> m_bestPath;     // 最近一次回溯得到的最优路径
+    size_t m_offset = 0;                // 当前格子在m_bestPath中的位置
+
+    void tracePathFrom(const QPoint& pos, size_t nextWaypoint);
+};
+
+#endif // HINTENGINE_H
@@ -0,0 +1,441 @@
+#include "lexicographicsolver.h"
+#include "healthstep.h"
+#include "logger.h"
+#include <algorithm>
+#include <climits>
+#include <sstream>
+
+namespace {
+
+const char* objectiveToken(Objective objective) {
+    switch (objective) {
+    case Objective::FINAL_HEALTH:
+        return "health";
+    case Objective::DAMAGE_ROOMS:
+        return "rooms";
+    case Objective::PEAK_DAMAGE:
+        return "peak";
+    }
+    return "";
+}
+
+int bitsFor(uint64_t value) {
+    int bits = 1;
+    while (bits < 64 && (value >> bits) != 0) {
+        ++bits;
+    }
+    return bits;
+}
+
+// 64位键中各字段的位置，没有选中的目标shift为-1
+struct KeyLayout {
+    int needShift = 0;
+    uint64_t lowMask = 0;       // 所需健康值以下的全部位
+    int sumShift = -1;          // 终点健康值：存放路线上界减去后缀之和
+    int roomsShift = -1;
+    int peakShift = -1;
+    uint64_t peakMask = 0;
+    uint64_t sumBase = 0;       // 空后缀对应的终点健康字段值
+
+    KeyLayout(const ObjectiveOrder& order, uint64_t length, uint64_t maxGain, uint64_t maxDamage) {
+        // 从最后一个目标开始由低位向高位分配
+        int used = 0;
+        for (auto it = order.tieBreaks.rbegin(); it != order.tieBreaks.rend(); ++it) {
+            switch (*it) {
+            case Objective::FINAL_HEALTH:
+                sumShift = used;
+                sumBase = length * maxGain;
+                used += bitsFor(length * (maxGain + maxDamage));
+                break;
+            case Objective::DAMAGE_ROOMS:
+                roomsShift = used;
+                used += bitsFor(length);
+                break;
+            case Objective::PEAK_DAMAGE:
+                peakShift = used;
+                peakMask = (uint64_t(1) << bitsFor(maxDamage)) - 1;
+                used += bitsFor(maxDamage);
+                break;
+            }
+        }
+
+        if (used + bitsFor(1 + length * maxDamage) > 64) {
+            throw LexicographicException("地图取值范围过大，所选目标无法打包为64位");
+        }
+        needShift = used;
+        lowMask = (uint64_t(1) << used) - 1;
+    }
+
+    // 离开格子后的最优后缀为next时，进入值为cell的格子的键；damage为max(0, -cell)。
+    // 不用分支，避免随机地图上的分支预测失败
+    template <bool Peak>
+    uint64_t step(uint64_t next, int cell, uint64_t delta, uint64_t damage) const {
+        long long need = static_cast<long long>(next >> needShift) - cell;
+        need = need < 1 ? 1 : need;
+        uint64_t key = (next & lowMask) + delta;
+        if (Peak) {
+            uint64_t peak = (key >> peakShift) & peakMask;
+            key += (damage > peak ? damage - peak : 0) << peakShift;
+        }
+        return key | (static_cast<uint64_t>(need) << needShift);
+    }
+
+    // 本格对累加字段的增量，后缀之和增加cell即字段减少cell，各字段都不会越界，整体相加不会互相进位
+    uint64_t delta(int cell) const {
+        uint64_t result = 0;
+        if (sumShift >= 0) {
+            result += static_cast<uint64_t>(-static_cast<long long>(cell)) << sumShift;
+        }
+        if (roomsShift >= 0) {
+            result += static_cast<uint64_t>(cell < 0) << roomsShift;
+        }
+        return result;
+    }
+};
+
+// 不可行的键：墙壁格子以及只能走向墙壁的格子，比任何可行键都大，因此比较时自然不会被选中
+const uint64_t BLOCKED = UINT64_MAX;
+
+// 反向扫描，写入dp和每格的方向位（1为向下）
+template <bool Peak, bool Walls>
+void sweep(const KeyLayout& layout, const int* map, const uint64_t* walls, int rows, int cols, int* dp,
+           std::vector<uint64_t>& down, bool checkRange) {
+    // 两行键滚动使用，公主格子之后是所需健康值为1的空后缀
+    std::vector<uint64_t> below(cols);
+    std::vector<uint64_t> current(cols);
+    const uint64_t terminal = (uint64_t(1) << layout.needShift) |
+                              (layout.sumShift >= 0 ? layout.sumBase << layout.sumShift : 0);
+
+    auto cellStep = [&layout, walls, cols](uint64_t next, int cell, int i, int j) {
+        uint64_t damage = cell < 0 ? static_cast<uint64_t>(-static_cast<long long>(cell)) : 0;
+        uint64_t key = layout.step<Peak>(next, cell, layout.delta(cell), damage);
+        if (Walls) {
+            // 后继不可行或本格是墙壁时整格不可行，不用分支
+            size_t k = static_cast<size_t>(i) * cols + j;
+            bool blocked = (next == BLOCKED) | ((walls[k >> 6] >> (k & 63)) & 1);
+            key |= -static_cast<uint64_t>(blocked);
+        }
+        return key;
+    };
+    auto setDown = [&down, cols](int i, int j, bool value) {
+        size_t k = static_cast<size_t>(i) * cols + j;
+        down[k >> 6] |= static_cast<uint64_t>(value) << (k & 63);
+    };
+
+    for (int i = rows - 1; i >= 0; --i) {
+        const int* mapRow = map + static_cast<size_t>(i) * cols;
+        int* dpRow = dp + static_cast<size_t>(i) * cols;
+
+        // 最后一列只能向下（最后一行的最后一格就是公主）
+        if (i == rows - 1) {
+            current[cols - 1] = cellStep(terminal, mapRow[cols - 1], i, cols - 1);
+        } else {
+            current[cols - 1] = cellStep(below[cols - 1], mapRow[cols - 1], i, cols - 1);
+            setDown(i, cols - 1, true);
+        }
+
+        for (int j = cols - 2; j >= 0; --j) {
+            uint64_t right = cellStep(current[j + 1], mapRow[j], i, j);
+            if (i == rows - 1) {
+                current[j] = right;     // 最后一行只能向右
+                continue;
+            }
+
+            // 与经典回溯一致，键相同时优先向下
+            uint64_t downKey = cellStep(below[j], mapRow[j], i, j);
+            bool goDown = downKey <= right;
+            current[j] = goDown ? downKey : right;
+            setDown(i, j, goDown);
+        }
+
+        for (int j = 0; j < cols; ++j) {
+            if (Walls && current[j] == BLOCKED) {
+                dpRow[j] = INT_MAX;
+                continue;
+            }
+            uint64_t need = current[j] >> layout.needShift;
+            if (checkRange && need > static_cast<uint64_t>(INT_MAX)) {
+                throw LexicographicException("所需健康值超出范围");
+            }
+            dpRow[j] = static_cast<int>(need);
+        }
+
+        std::swap(below, current);
+    }
+}
+
+// 经典反向递推，只写dp（首个次要目标为终点健康时由正向扫描选路线）
+void classicSweep(const int* map, const uint64_t* walls, int rows, int cols, int* dp) {
+    for (int i = rows - 1; i >= 0; --i) {
+        for (int j = cols - 1; j >= 0; --j) {
+            size_t k = static_cast<size_t>(i) * cols + j;
+            int next = 1;
+            if (i < rows - 1 || j < cols - 1) {
+                next = INT_MAX;
+                if (i < rows - 1) {
+                    next = dp[k + cols];
+                }
+                if (j < cols - 1) {
+                    next = std::min(next, dp[k + 1]);
+                }
+            }
+            dp[k] = WallMask::masked(neededHealth(next, map[k]), WallMask::isWall(walls, k), INT_MAX);
+        }
+    }
+}
+
+// 正向扫描中一个前缀的状态：离开格子时的健康值（0表示到不了或已倒下）和第二目标的值（越小越好）
+struct Prefix {
+    long long health = 0;
+    uint64_t second = 0;
+
+    bool betterThan(const Prefix& other) const {
+        return health != other.health ? health > other.health : second < other.second;
+    }
+};
+
+// 首个次要目标为终点健康时的精确解：从最小健康值start出发，每格保留离开时健康值最高的前缀，
+// 健康值相同时保留第二目标较好的。健康值多的前缀接上任何后缀都活得下来且终点健康更高，
+// 伤害房间数可加、单次伤害取最大值，前缀较好时接同一后缀结果也不差，所以逐格保留最优前缀即为全局最优。
+// 记录每格的最优前缀是否来自上方，从终点回溯后把路线上的方向写入down
+void forwardSweep(const int* map, const uint64_t* walls, int rows, int cols, long long start,
+                  const ObjectiveOrder& order, std::vector<uint64_t>& down) {
+    bool rooms = order.tieBreaks.size() > 1 && order.tieBreaks[1] == Objective::DAMAGE_ROOMS;
+    bool peak = order.tieBreaks.size() > 1 && order.tieBreaks[1] == Objective::PEAK_DAMAGE;
+    size_t count = static_cast<size_t>(rows) * cols;
+    std::vector<uint64_t> fromAbove(WallMask::wordCount(count), 0);
+    std::vector<Prefix> above(cols);
+    std::vector<Prefix> current(cols);
+
+    auto enter = [&](const Prefix& prefix, size_t k) {
+        Prefix result;
+        if (prefix.health <= 0 || WallMask::isWall(walls, k)) {
+            return result;
+        }
+        int cell = map[k];
+        long long health = prefix.health + cell;
+        if (health <= 0) {
+            return result;
+        }
+        uint64_t damage = cell < 0 ? static_cast<uint64_t>(-static_cast<long long>(cell)) : 0;
+        result.health = health;
+        result.second = rooms ? prefix.second + (cell < 0) : peak ? std::max(prefix.second, damage) : 0;
+        return result;
+    };
+
+    for (int i = 0; i < rows; ++i) {
+        for (int j = 0; j < cols; ++j) {
+            size_t k = static_cast<size_t>(i) * cols + j;
+            if (i == 0 && j == 0) {
+                Prefix origin;
+                origin.health = start;
+                current[0] = enter(origin, k);
+                continue;
+            }
+
+            // 相同时取来自上方的前缀，与经典回溯优先向下一致
+            Prefix fromLeft = j > 0 ? enter(current[j - 1], k) : Prefix();
+            Prefix fromUp = i > 0 ? enter(above[j], k) : Prefix();
+            bool up = i > 0 && (j == 0 || !fromLeft.betterThan(fromUp));
+            current[j] = up ? fromUp : fromLeft;
+            WallMask::setWall(fromAbove.data(), k, up);
+        }
+        std::swap(above, current);
+    }
+
+    int i = rows - 1;
+    int j = cols - 1;
+    while (i > 0 || j > 0) {
+        size_t k = static_cast<size_t>(i) * cols + j;
+        if (WallMask::isWall(fromAbove.data(), k)) {
+            --i;
+            WallMask::setWall(down.data(), static_cast<size_t>(i) * cols + j, true);
+        } else {
+            --j;
+        }
+    }
+}
+
+} // namespace
+
+const char* objectiveName(Objective objective) {
+    switch (objective) {
+    case Objective::FINAL_HEALTH:
+        return "终点健康最高";
+    case Objective::DAMAGE_ROOMS:
+        return "伤害房间最少";
+    case Objective::PEAK_DAMAGE:
+        return "单次伤害最低";
+    }
+    return "";
+}
+
+void ObjectiveOrder::validate() const {
+    if (tieBreaks.size() > MAX_TIE_BREAKS) {
+        throw LexicographicException("最多只能选择两个次要目标");
+    }
+    for (size_t i = 0; i < tieBreaks.size(); ++i) {
+        if (std::find(tieBreaks.begin() + i + 1, tieBreaks.end(), tieBreaks[i]) != tieBreaks.end()) {
+            throw LexicographicException(std::string("优化目标重复: ") + objectiveName(tieBreaks[i]));
+        }
+    }
+}
+
+ObjectiveOrder ObjectiveOrder::parse(const std::string& text) {
+    ObjectiveOrder order;
+    std::istringstream stream(text);
+    std::string token;
+
+    while (std::getline(stream, token, ',')) {
+        token.erase(0, token.find_first_not_of(" \t"));
+        token.erase(token.find_last_not_of(" \t") + 1);
+        if (token.empty() || token == "none") {
+            continue;
+        }
+
+        if (token == objectiveToken(Objective::FINAL_HEALTH)) {
+            order.tieBreaks.push_back(Objective::FINAL_HEALTH);
+        } else if (token == objectiveToken(Objective::DAMAGE_ROOMS)) {
+            order.tieBreaks.push_back(Objective::DAMAGE_ROOMS);
+        } else if (token == objectiveToken(Objective::PEAK_DAMAGE)) {
+            order.tieBreaks.push_back(Objective::PEAK_DAMAGE);
+        } else {
+            throw LexicographicException("未知的优化目标: " + token + "（可选health、rooms、peak）");
+        }
+    }
+
+    order.validate();
+    return order;
+}
+
+std::string ObjectiveOrder::toString() const {
+    if (tieBreaks.empty()) {
+        return "none";
+    }
+
+    std::string result;
+    for (Objective objective : tieBreaks) {
+        if (!result.empty()) {
+            result += ",";
+        }
+        result += objectiveToken(objective);
+    }
+    return result;
+}
+
+PathObjectives evaluatePath(const int* map, int cols, const std::vector<QPoint>& path, int startHealth) {
+    PathObjectives result;
+    long long health = startHealth;
+
+    for (const QPoint& p : path) {
+        int cell = map[static_cast<size_t>(p.y()) * cols + p.x()];
+        health += cell;
+        if (cell < 0) {
+            result.damageRooms++;
+            result.peakDamage = std::max(result.peakDamage, -cell);
+        }
+    }
+
+    result.finalHealth = static_cast<int>(std::min<long long>(health, INT_MAX));
+    return result;
+}
+
+void LexicographicSolver::solve(const int* map, const uint64_t* walls, int rows, int cols,
+                                const ObjectiveOrder& order, int* dp) {
+    try {
+        if (!map || !dp || rows <= 0 || cols <= 0) {
+            throw LexicographicException("地图数据为空");
+        }
+        order.validate();
+
+        size_t count = static_cast<size_t>(rows) * cols;
+        m_rows = rows;
+        m_cols = cols;
+        m_down.assign((count + 63) / 64, 0);
+
+        if (!order.empty() && order.tieBreaks.front() == Objective::FINAL_HEALTH) {
+            classicSweep(map, walls, rows, cols, dp);
+            m_solvable = dp[0] != INT_MAX;
+            if (m_solvable) {
+                forwardSweep(map, walls, rows, cols, dp[0], order, m_down);
+            }
+            LOG_DEBUG("Lexicographic solve: %d x %d objectives %s by forward sweep",
+                      rows, cols, order.toString().c_str());
+            return;
+        }
+
+        int minCell = 0;
+        int maxCell = 0;
+        for (size_t k = 0; k < count; ++k) {
+            minCell = std::min(minCell, map[k]);
+            maxCell = std::max(maxCell, map[k]);
+        }
+
+        uint64_t length = static_cast<uint64_t>(rows) + cols - 1;
+        KeyLayout layout(order, length, static_cast<uint64_t>(maxCell),
+                         static_cast<uint64_t>(-static_cast<long long>(minCell)));
+
+        // 所需健康值的上界不超过INT_MAX时不必逐格检查
+        bool checkRange = 1 + length * static_cast<uint64_t>(-static_cast<long long>(minCell)) >
+                          static_cast<uint64_t>(INT_MAX);
+        // 没有墙壁时使用不带掩码的扫描，保持原来的速度
+        bool hasWalls = WallMask::any(walls, count);
+        if (layout.peakShift >= 0) {
+            if (hasWalls) {
+                sweep<true, true>(layout, map, walls, rows, cols, dp, m_down, checkRange);
+            } else {
+                sweep<true, false>(layout, map, walls, rows, cols, dp, m_down, checkRange);
+            }
+        } else {
+            if (hasWalls) {
+                sweep<false, true>(layout, map, walls, rows, cols, dp, m_down, checkRange);
+            } else {
+                sweep<false, false>(layout, map, walls, rows, cols, dp, m_down, checkRange);
+            }
+        }
+        m_solvable = dp[0] != INT_MAX;
+
+        LOG_DEBUG("Lexicographic solve: %d x %d objectives %s tie-break bits %d",
+                  rows, cols, order.toString().c_str(), layout.needShift);
+
+    } catch (const LexicographicException& e) {
+        m_down.clear();
+        throw;
+    } catch (const std::exception& e) {
+        m_down.clear();
+        throw LexicographicException(std::string("多目标求解失败: ") + e.what());
+    }
+}
+
+std::vector<QPoint> LexicographicSolver::tracePath() const {
+    if (m_down.size() != (static_cast<size_t>(m_rows) * m_cols + 63) / 64 || m_down.empty()) {
+        throw LexicographicException("尚未求解");
+    }
+
+    std::vector<QPoint> path;
+    path.reserve(static_cast<size_t>(m_rows) + m_cols - 1);
+
+    // 被墙壁挡住时与经典回溯一致，只返回起点
+    if (!m_solvable) {
+        path.push_back(QPoint(0, 0));
+        return path;
+    }
+
+    int i = 0;
+    int j = 0;
+    while (true) {
+        path.push_back(QPoint(j, i));
+        if (i == m_rows - 1 && j == m_cols - 1) {
+            break;
+        }
+
+        size_t k = static_cast<size_t>(i) * m_cols + j;
+        if ((m_down[k >> 6] >> (k & 63)) & 1) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+
+    return path;
+}
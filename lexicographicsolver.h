@@ -0,0 +1,83 @@
+#ifndef LEXICOGRAPHICSOLVER_H
+#define LEXICOGRAPHICSOLVER_H
+
+#include <QPoint>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "wallmask.h"
+
+class LexicographicException : public std::runtime_error {
+public:
+    explicit LexicographicException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 所需初始健康值相同时的次要优化目标
+enum class Objective {
+    FINAL_HEALTH,   // 到达公主时的健康值最高
+    DAMAGE_ROOMS,   // 经过的伤害房间最少
+    PEAK_DAMAGE     // 单个房间的最大伤害最低
+};
+
+// 目标顺序：最小初始健康值始终是第一目标，tieBreaks依次为第二、第三目标，为空时按经典规则优先向下
+struct ObjectiveOrder {
+    static const size_t MAX_TIE_BREAKS = 2;
+
+    std::vector<Objective> tieBreaks;
+
+    bool empty() const { return tieBreaks.empty(); }
+    void validate() const;
+
+    // 命令行格式：逗号分隔的health、rooms、peak，例如"health,rooms"
+    static ObjectiveOrder parse(const std::string& text);
+    std::string toString() const;
+
+    bool operator==(const ObjectiveOrder& other) const { return tieBreaks == other.tieBreaks; }
+    bool operator!=(const ObjectiveOrder& other) const { return !(*this == other); }
+};
+
+const char* objectiveName(Objective objective);
+
+// 一条路线的各项目标值，startHealth为出发时的健康值
+struct PathObjectives {
+    int finalHealth = 0;
+    int damageRooms = 0;
+    int peakDamage = 0;
+};
+
+PathObjectives evaluatePath(const int* map, int cols, const std::vector<QPoint>& path, int startHealth);
+
+// 按目标顺序字典序优化的经典路线求解（只向右下走、不限健康上限）。
+//
+// 首个次要目标为终点健康最高时精确求解：经典反向递推得到dp后，从最小健康值出发正向扫描，
+// 每格保留离开时健康值最高（相同时第二目标较好）的前缀，再从终点回溯，
+// 结果在所有只需最小健康值的路线中按字典序最优。
+//
+// 其他顺序把每个格子的（所需健康值, 第二目标, 第三目标）打包为一个64位键，高位为所需健康值，
+// 各字段都编码为越小越好的非负整数，字段宽度由路线长度和单格最大增益/伤害确定，保证互不进位。
+// 每格对向下、向右两个候选分别套用本格的效果后取较小的键，一次反向扫描同时得到dp和每格的选择方向。
+// 由于max(1, ...)的截断，候选的所需健康值可能相同，此时由后续目标决定，
+// 因此结果只在“每一段后缀都所需健康值最小”的路线（dp紧路线，经典回溯的路线都在其中）中按字典序最优，
+// 需要最小健康值但不是dp紧的路线不参与比较。
+// 终点健康值和伤害房间数沿路线累加，字典序比较精确；单次伤害取最大值，
+// 排在它之后的目标只在后缀最大伤害相同的候选之间比较，不保证全局最优。
+// 墙壁格子的键为全1，比任何可行键都大，dp中写为INT_MAX。
+class LexicographicSolver {
+public:
+    // 求解结果写入dp（rows*cols，行优先），与经典递推的结果相同；walls为空表示没有墙壁
+    void solve(const int* map, const uint64_t* walls, int rows, int cols, const ObjectiveOrder& order, int* dp);
+
+    // 沿求解时记录的方向从左上角走到右下角
+    std::vector<QPoint> tracePath() const;
+
+    void clear() { m_down.clear(); }
+
+private:
+    int m_rows = 0;
+    int m_cols = 0;
+    bool m_solvable = false;
+    std::vector<uint64_t> m_down;   // 每格一位，1表示向下
+};
+
+#endif // LEXICOGRAPHICSOLVER_H
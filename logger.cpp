@@ -0,0 +1,230 @@
+#include "logger.h"
+#include "tracer.h"
+#include <QDebug>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+const uint64_t RATE_WINDOW_NS = 1000000000ULL;
+
+struct LogSlot {
+    std::atomic<size_t> sequence{0};
+    LogLevel level = LogLevel::Debug;
+    uint32_t omitted = 0;
+    uint64_t time = 0;
+    char text[Logger::MESSAGE_SIZE];
+};
+
+// 有界多生产者队列：每个槽的sequence表示它当前可被哪个位置写入/读出，生产者用CAS抢占写入位置。
+// 只有后台线程消费。程序退出时不析构，避免与仍在记录的线程竞争；后台线程由Logger::shutdown()结束并回收
+struct LogSink {
+    LogSlot slots[Logger::QUEUE_CAPACITY];
+    std::atomic<size_t> enqueuePos{0};
+    std::atomic<size_t> dequeuePos{0};
+    std::atomic<size_t> dropped{0};
+
+    // 后台线程队列为空时在idle上休眠，sleeping为true；发布消息的生产者看到sleeping时
+    // 把它清为false并在锁内通知，同一次休眠只有一个生产者获取锁，其余生产者不加锁
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::atomic<bool> sleeping{false};
+    bool stopping = false;              // 由idleMutex保护
+    std::atomic<bool> stopped{false};   // 后台线程已回收，之后的消息在调用线程直接输出
+    std::thread worker;
+
+    LogSink() {
+        for (size_t i = 0; i < Logger::QUEUE_CAPACITY; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        worker = std::thread(&LogSink::run, this);
+    }
+
+    LogSlot* claim() {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            LogSlot& slot = slots[pos % Logger::QUEUE_CAPACITY];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            if (seq == pos) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (seq < pos) {
+                // 上一轮的消息还没输出，缓冲区已满
+                return nullptr;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void publish(LogSlot* slot) {
+        size_t pos = slot->sequence.load(std::memory_order_relaxed);
+        slot->sequence.store(pos + 1, std::memory_order_release);
+
+        // 与run()中的栅栏配对：要么后台线程休眠前看到这条消息，要么这里看到sleeping
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false, std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idle.notify_one();
+        }
+    }
+
+    bool hasPending() const {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        return slots[pos % Logger::QUEUE_CAPACITY].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    bool drainOne() {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        LogSlot& slot = slots[pos % Logger::QUEUE_CAPACITY];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) {
+            return false;
+        }
+
+        output(slot);
+        slot.sequence.store(pos + Logger::QUEUE_CAPACITY, std::memory_order_release);
+        dequeuePos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    static void output(const LogSlot& slot) {
+        char line[Logger::MESSAGE_SIZE + 64];
+        int n = std::snprintf(line, sizeof(line), "[%.3f] %s", slot.time / 1e9, slot.text);
+        if (slot.omitted > 0 && n > 0 && static_cast<size_t>(n) < sizeof(line)) {
+            std::snprintf(line + n, sizeof(line) - n, " (省略%u条)", slot.omitted);
+        }
+
+        switch (slot.level) {
+        case LogLevel::Debug:
+            qDebug() << line;
+            break;
+        case LogLevel::Info:
+            qInfo() << line;
+            break;
+        case LogLevel::Warning:
+            qWarning() << line;
+            break;
+        case LogLevel::Error:
+            qCritical() << line;
+            break;
+        }
+    }
+
+    void run() {
+        for (;;) {
+            while (drainOne()) {
+            }
+
+            std::unique_lock<std::mutex> lock(idleMutex);
+            sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!hasPending()) {
+                if (stopping) {
+                    sleeping.store(false, std::memory_order_relaxed);
+                    return;
+                }
+                idle.wait(lock, [this] { return !sleeping.load(std::memory_order_relaxed) || stopping; });
+            }
+            sleeping.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
+LogSink& sink() {
+    static LogSink* instance = new LogSink;
+    return *instance;
+}
+
+// 按调用点限流，返回是否放行；放行时取出之前省略的条数
+bool admit(LogSite& site, uint64_t now, uint32_t& omitted) {
+    uint64_t start = site.windowStart.load(std::memory_order_relaxed);
+    if (now - start >= RATE_WINDOW_NS &&
+        site.windowStart.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        site.inWindow.store(0, std::memory_order_relaxed);
+    }
+
+    if (site.inWindow.fetch_add(1, std::memory_order_relaxed) >= Logger::LOG_SITE_LIMIT) {
+        site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    omitted = site.suppressed.exchange(0, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace
+
+namespace Logger {
+
+void write(LogSite& site, LogLevel level, const char* format, ...) {
+    uint64_t now = Tracer::now();
+    uint32_t omitted = 0;
+    if (!admit(site, now, omitted)) {
+        return;
+    }
+
+    LogSink& s = sink();
+    if (s.stopped.load(std::memory_order_acquire)) {
+        // 已经关闭，没有后台线程可交付，直接输出
+        LogSlot late;
+        late.level = level;
+        late.omitted = omitted;
+        late.time = now;
+        va_list args;
+        va_start(args, format);
+        std::vsnprintf(late.text, MESSAGE_SIZE, format, args);
+        va_end(args);
+        LogSink::output(late);
+        return;
+    }
+
+    LogSlot* slot = s.claim();
+    if (!slot) {
+        s.dropped.fetch_add(1, std::memory_order_relaxed);
+        site.suppressed.fetch_add(omitted, std::memory_order_relaxed);
+        return;
+    }
+
+    slot->level = level;
+    slot->omitted = omitted;
+    slot->time = now;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(slot->text, MESSAGE_SIZE, format, args);
+    va_end(args);
+
+    s.publish(slot);
+}
+
+void flush() {
+    LogSink& s = sink();
+    size_t target = s.enqueuePos.load(std::memory_order_acquire);
+    while (!s.stopped.load(std::memory_order_acquire) && s.dequeuePos.load(std::memory_order_acquire) < target) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void shutdown() {
+    LogSink& s = sink();
+    if (s.stopped.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s.idleMutex);
+        s.stopping = true;
+    }
+    s.idle.notify_one();
+    s.worker.join();    // 后台线程先输出队列中已发布的消息再退出
+    s.stopped.store(true, std::memory_order_release);
+}
+
+size_t droppedCount() {
+    return sink().dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace Logger
@@ -0,0 +1,90 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 分级日志：调用方把格式化好的消息放进无锁环形缓冲区，由后台线程统一输出到Qt的消息处理器。
+//
+// 调用线程只做一次定长缓冲区内的vsnprintf和几次原子操作，不分配内存、不做IO；只有后台线程空闲休眠时，
+// 唤醒它的那条消息会短暂获取一次锁并通知，其余时候不加锁。缓冲区满时丢弃新消息并计数。
+// 后台线程在main结束时由shutdown()回收。每个调用点各自限流，一秒内超过LOG_SITE_LIMIT条时省略多出的部分，
+// 下一秒的第一条消息附带省略的条数。
+//
+// 编译时定义DUNGEON_LOG_LEVEL（0=调试，1=信息，2=警告，3=错误，4=全部移除）可以移除低于该级别的日志，
+// 被移除的调用连参数都不求值。
+enum class LogLevel {
+    Debug = 0,
+    Info = 1,
+    Warning = 2,
+    Error = 3
+};
+
+#ifndef DUNGEON_LOG_LEVEL
+#define DUNGEON_LOG_LEVEL 0
+#endif
+
+// 一个日志调用点的限流状态（由宏生成的函数内静态对象，常量初始化，没有构造开销）
+struct LogSite {
+    std::atomic<uint64_t> windowStart{0};   // 当前限流窗口的起始时间（纳秒）
+    std::atomic<uint32_t> inWindow{0};      // 窗口内已放行的条数
+    std::atomic<uint32_t> suppressed{0};    // 被省略、尚未报告的条数
+};
+
+namespace Logger {
+
+// 环形缓冲区的槽数和每条消息的最大长度（超长截断）
+const size_t QUEUE_CAPACITY = 1024;
+const size_t MESSAGE_SIZE = 232;
+
+// 每个调用点每秒最多放行的条数
+const uint32_t LOG_SITE_LIMIT = 20;
+
+#if defined(__GNUC__)
+__attribute__((format(printf, 3, 4)))
+#endif
+void write(LogSite& site, LogLevel level, const char* format, ...);
+
+// 等待已入队的消息全部输出（退出前调用）
+void flush();
+
+// 输出队列中的消息并回收后台线程（main结束时调用一次）；之后的日志在调用线程直接输出
+void shutdown();
+
+// 因缓冲区满而丢弃的消息数
+size_t droppedCount();
+
+} // namespace Logger
+
+#define DUNGEON_LOG(level, ...)                        \
+    do {                                               \
+        static LogSite logSite_;                       \
+        Logger::write(logSite_, level, __VA_ARGS__);   \
+    } while (0)
+
+#if DUNGEON_LOG_LEVEL <= 0
+#define LOG_DEBUG(...) DUNGEON_LOG(LogLevel::Debug, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if DUNGEON_LOG_LEVEL <= 1
+#define LOG_INFO(...) DUNGEON_LOG(LogLevel::Info, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if DUNGEON_LOG_LEVEL <= 2
+#define LOG_WARNING(...) DUNGEON_LOG(LogLevel::Warning, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) ((void)0)
+#endif
+
+#if DUNGEON_LOG_LEVEL <= 3
+#define LOG_ERROR(...) DUNGEON_LOG(LogLevel::Error, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#endif // LOGGER_H
@@ -1,16 +1,558 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QTextStream>
+#include <csignal>
+#include <cstring>
+#include <memory>
+#include "bandcluster.h"
+#include "checkpointsolver.h"
+#include "dungeon.h"
+#include "dungeonfile.h"
+#include "healthquery.h"
+#include "logger.h"
 #include "mainwindow.h"
+#include "optimalcorridor.h"
+#include "perfmetrics.h"
+#include "replayvalidator.h"
+#include "solverclient.h"
+#include "solverservice.h"
+#include "streamingsolver.h"
+#include "taskpool.h"
+#include "toppaths.h"
+#include "tracer.h"
+
+namespace {
+
+// 不打开窗口的命令行模式，只创建QCoreApplication，没有显示器的服务器上也能运行
+const char* const HEADLESS_OPTIONS[] = {
+    "stream-solve", "stream-self-check", "checkpoint-solve", "band-solve", "serve", "load-test", "validate-replays",
+    "query-benchmark", "top-paths-benchmark", "corridor-check"
+};
+
+bool isHeadless(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        for (const char* name : HEADLESS_OPTIONS) {
+            size_t length = std::strlen(name);
+            const char* arg = argv[i];
+            if (std::strncmp(arg, "--", 2) == 0 && std::strncmp(arg + 2, name, length) == 0 &&
+                (arg[2 + length] == '\0' || arg[2 + length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// main的每条返回路径上都关闭日志：输出剩余消息并回收后台线程。最先构造、最后析构，晚于QCoreApplication
+struct LoggerShutdown {
+    ~LoggerShutdown() { Logger::shutdown(); }
+};
+
+} // namespace
 
 int main(int argc, char *argv[]) {
-    QApplication app(argc, argv);
+    LoggerShutdown loggerShutdown;
+
+    // 多进程求解的工作进程不创建界面，求解完自己的一带即退出
+    if (argc > 1 && std::strcmp(argv[1], BandCluster::WORKER_FLAG) == 0) {
+        return BandCluster::workerMain(argc - 2, argv + 2);
+    }
+
+    std::unique_ptr<QCoreApplication> app(isHeadless(argc, argv) ? new QCoreApplication(argc, argv)
+                                                                  : new QApplication(argc, argv));
 
     // 设置应用程序图标和信息
-    app.setApplicationName("地下城游戏");
-    app.setApplicationVersion("2.0");
-    app.setOrganizationName("Dungeon Game Studio");
+    app->setApplicationName("地下城游戏");
+    app->setApplicationVersion("2.0");
+    app->setOrganizationName("Dungeon Game Studio");
+
+    // 命令行参数
+    QCommandLineParser parser;
+    parser.setApplicationDescription("地下城游戏");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption objectivesOption(
+        "objectives",
+        "所需初始健康值相同时依次比较的次要目标，逗号分隔：health（终点健康最高）、"
+        "rooms（伤害房间最少）、peak（单次伤害最低），最多两个。health排在第一时在所有最小健康值路线中比较，"
+        "其他目标排在第一时只比较每一步都保持dp等式的路线",
+        "list");
+    parser.addOption(objectivesOption);
+    QCommandLineOption traceOption(
+        "trace",
+        "从启动开始录制跟踪，退出时写入Chrome/Perfetto跟踪文件",
+        "file");
+    parser.addOption(traceOption);
+    QCommandLineOption workersOption(
+        "workers",
+        "任务池的工作线程数（默认比CPU核数少一个）",
+        "count");
+    parser.addOption(workersOption);
+    QCommandLineOption pinOption(
+        "pin-workers",
+        "把任务池的每个工作线程绑定到各自的CPU");
+    parser.addOption(pinOption);
+    QCommandLineOption streamSolveOption(
+        "stream-solve",
+        "不打开窗口，逐块读取.dgn地图文件求解（用于超过内存的地图），输出最小初始健康值后退出",
+        "file");
+    parser.addOption(streamSolveOption);
+    QCommandLineOption memoryLimitOption(
+        "memory-limit",
+        "流式求解的内存上限（MB，默认64，自检默认16）",
+        "mb");
+    parser.addOption(memoryLimitOption);
+    QCommandLineOption decisionFileOption(
+        "decision-file",
+        "流式求解时写出每格一位的决策文件，并据此输出最优路径的长度",
+        "file");
+    parser.addOption(decisionFileOption);
+    QCommandLineOption streamSelfCheckOption(
+        "stream-self-check",
+        "不打开窗口，生成文件大小至少为内存上限4倍的地图写入file，按--memory-limit流式求解，"
+        "与Dungeon::solveDp比较最小初始健康值和路径，不一致时返回非零退出码",
+        "file");
+    parser.addOption(streamSelfCheckOption);
+    QCommandLineOption checkpointSolveOption(
+        "checkpoint-solve",
+        "不打开窗口，映射.dgn地图文件并用检查点DP求解（只保存每k行的dp，回溯时分带重算），输出结果后退出",
+        "file");
+    parser.addOption(checkpointSolveOption);
+    QCommandLineOption checkpointIntervalOption(
+        "checkpoint-interval",
+        "检查点DP的行间隔（默认约为行数的平方根）",
+        "rows");
+    parser.addOption(checkpointIntervalOption);
+    QCommandLineOption bandSolveOption(
+        "band-solve",
+        "不打开窗口，把.dgn地图按行分带交给多个工作进程求解（相邻两带用套接字传递边界行），输出结果后退出",
+        "file");
+    parser.addOption(bandSolveOption);
+    QCommandLineOption processesOption(
+        "processes",
+        "多进程求解的工作进程数（默认4）",
+        "count");
+    parser.addOption(processesOption);
+    QCommandLineOption dpOutputOption(
+        "dp-output",
+        "多进程求解时完整dp表的输出文件（默认为地图文件名加.dp）",
+        "file");
+    parser.addOption(dpOutputOption);
+    QCommandLineOption verifyOption(
+        "verify",
+        "多进程求解后把地图载入Dungeon单进程求解，与dp输出文件逐位比较，不同时返回非零退出码");
+    parser.addOption(verifyOption);
+    QCommandLineOption serveOption(
+        "serve",
+        "不打开窗口，作为求解服务在指定的Unix域套接字上监听，收到SIGINT或SIGTERM时退出",
+        "socket");
+    parser.addOption(serveOption);
+    QCommandLineOption loadTestOption(
+        "load-test",
+        "对指定套接字上的求解服务压测，输出吞吐和p50/p99延迟后退出",
+        "socket");
+    parser.addOption(loadTestOption);
+    QCommandLineOption clientsOption(
+        "clients",
+        "压测的并发连接数（默认4）",
+        "count");
+    parser.addOption(clientsOption);
+    QCommandLineOption requestsOption(
+        "requests",
+        "压测中每个连接的请求数（默认1000）",
+        "count");
+    parser.addOption(requestsOption);
+    QCommandLineOption mapSizeOption(
+        "map-size",
+        "压测和基准测试地图的边长（压测默认20，基准测试默认2000）",
+        "size");
+    parser.addOption(mapSizeOption);
+    QCommandLineOption validateReplaysOption(
+        "validate-replays",
+        "不打开窗口，批量验证录像文件中的手动模式游戏，输出各结果的局数和验证速度后退出",
+        "file");
+    parser.addOption(validateReplaysOption);
+    QCommandLineOption replayMapOption(
+        "replay-map",
+        "验证录像时登记的.dgn地图文件（可重复），没有种子的录像按地图哈希在其中查找",
+        "file");
+    parser.addOption(replayMapOption);
+    QCommandLineOption queryBenchmarkOption(
+        "query-benchmark",
+        "不打开窗口，在随机地图上分别计时随机、共享终点和以地图终点为终点的A→B最小健康值批量查询后退出");
+    parser.addOption(queryBenchmarkOption);
+    QCommandLineOption queriesOption(
+        "queries",
+        "基准测试中每种分布的查询数（默认100000）",
+        "count");
+    parser.addOption(queriesOption);
+    QCommandLineOption topPathsBenchmarkOption(
+        "top-paths-benchmark",
+        "不打开窗口，在随机地图上按k = 1, 10, 100, …计时前k条路径的枚举后退出");
+    parser.addOption(topPathsBenchmarkOption);
+    QCommandLineOption maxKOption(
+        "max-k",
+        "前k条路径基准测试的最大k（默认10000）",
+        "k");
+    parser.addOption(maxKOption);
+    QCommandLineOption corridorCheckOption(
+        "corridor-check",
+        "不打开窗口，在随机小地图上枚举全部路径，核对最优走廊和dp紧路径计数，不一致时返回非零退出码");
+    parser.addOption(corridorCheckOption);
+    QCommandLineOption checkMapsOption(
+        "check-maps",
+        "交叉检查的随机地图数（默认3000）",
+        "count");
+    parser.addOption(checkMapsOption);
+    parser.process(*app);
+
+    ObjectiveOrder objectives;
+    try {
+        objectives = ObjectiveOrder::parse(parser.value(objectivesOption).toStdString());
+    } catch (const std::exception& e) {
+        qCritical() << "参数错误:" << e.what();
+        return 1;
+    }
+
+    bool workersOk = true;
+    unsigned workers = parser.isSet(workersOption) ? parser.value(workersOption).toUInt(&workersOk) : 0;
+    if (!workersOk || (parser.isSet(workersOption) && workers == 0)) {
+        qCritical() << "参数错误: 工作线程数必须是正整数";
+        return 1;
+    }
+    TaskPool::configure(workers, parser.isSet(pinOption));
+
+    if (parser.isSet(streamSolveOption) || parser.isSet(streamSelfCheckOption)) {
+        bool limitOk = true;
+        size_t defaultLimit = parser.isSet(streamSelfCheckOption) ? StreamingSolver::SELF_CHECK_MEMORY_LIMIT
+                                                                  : StreamingSolver::DEFAULT_MEMORY_LIMIT;
+        size_t limitMb = parser.isSet(memoryLimitOption) ? parser.value(memoryLimitOption).toUInt(&limitOk)
+                                                         : defaultLimit >> 20;
+        if (!limitOk || limitMb == 0) {
+            qCritical() << "参数错误: 内存上限必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        if (parser.isSet(streamSelfCheckOption)) {
+            try {
+                StreamingSelfCheckResult check = StreamingSolver(limitMb << 20).selfCheck(parser.value(streamSelfCheckOption));
+                out << "地图: " << check.stream.rows << " x " << check.stream.cols << "，文件 " << check.fileBytes / 1e6
+                    << " MB，内存上限 " << limitMb << " MB，缓冲区 " << check.stream.bufferBytes / 1e6 << " MB" << Qt::endl;
+                out << "最小初始健康值: 流式 " << check.stream.minHealth << "，solveDp " << check.expectedMinHealth
+                    << (check.minHealthMatches ? "，一致" : "，不一致") << Qt::endl;
+                out << "最优路径（" << check.pathLength << " 格）" << (check.pathMatches ? "一致" : "不一致") << Qt::endl;
+                out << "流式求解用时 " << check.stream.seconds << " 秒" << Qt::endl;
+                Logger::flush();
+                return check.passed() ? 0 : 1;
+            } catch (const std::exception& e) {
+                qCritical() << "流式求解自检失败:" << e.what();
+                Logger::flush();
+                return 1;
+            }
+        }
+
+        try {
+            QString decisionFile = parser.value(decisionFileOption);
+            StreamingSolveResult result = StreamingSolver(limitMb << 20).solve(parser.value(streamSolveOption), decisionFile);
+            out << "地图: " << result.rows << " x " << result.cols << Qt::endl;
+            if (result.minHealth == INT_MAX) {
+                out << "没有可行路线" << Qt::endl;
+            } else {
+                out << "最小初始健康值: " << result.minHealth << Qt::endl;
+            }
+            out << "读取: " << result.bytesRead / 1e6 << " MB，用时 " << result.seconds << " 秒，缓冲区 "
+                << result.bufferBytes / 1e6 << " MB" << Qt::endl;
+            if (!decisionFile.isEmpty()) {
+                out << "最优路径长度: " << StreamingSolver::tracePath(decisionFile).size() << Qt::endl;
+            }
+        } catch (const std::exception& e) {
+            qCritical() << "流式求解失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(checkpointSolveOption)) {
+        bool intervalOk = true;
+        int interval = parser.isSet(checkpointIntervalOption) ? parser.value(checkpointIntervalOption).toInt(&intervalOk) : 0;
+        if (!intervalOk || interval < 0) {
+            qCritical() << "参数错误: 检查点间隔必须是非负整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            DungeonFileMapping file(parser.value(checkpointSolveOption));
+            const DungeonFileHeader& header = file.header();
+            CheckpointSolver solver(interval);
+            solver.solve(file.cellData(), static_cast<int>(header.cellWidth), file.wallData(),
+                         static_cast<int>(header.rows), static_cast<int>(header.cols));
+            size_t pathLength = solver.tracePath().size();
+            out << "地图: " << header.rows << " x " << header.cols << Qt::endl;
+            if (solver.minHealth() == INT_MAX) {
+                out << "没有可行路线" << Qt::endl;
+            } else {
+                out << "最小初始健康值: " << solver.minHealth() << "，最优路径长度: " << pathLength << Qt::endl;
+            }
+            out << "检查点间隔: " << solver.interval() << " 行，检查点 " << solver.checkpointBytes() / 1e6
+                << " MB，峰值 " << solver.peakBytes() / 1e6 << " MB" << Qt::endl;
+        } catch (const std::exception& e) {
+            qCritical() << "检查点求解失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(bandSolveOption)) {
+        bool processesOk = true;
+        int processes = parser.isSet(processesOption) ? parser.value(processesOption).toInt(&processesOk) : 4;
+        if (!processesOk || processes <= 0) {
+            qCritical() << "参数错误: 进程数必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            QString mapFile = parser.value(bandSolveOption);
+            QString dpFile = parser.isSet(dpOutputOption) ? parser.value(dpOutputOption) : mapFile + ".dp";
+            BandSolveResult result = BandCluster(QCoreApplication::applicationFilePath(), processes).solve(mapFile, dpFile);
+            out << "地图: " << result.rows << " x " << result.cols << "，" << result.processes << " 个进程" << Qt::endl;
+            if (result.minHealth == INT_MAX) {
+                out << "没有可行路线" << Qt::endl;
+            } else {
+                out << "最小初始健康值: " << result.minHealth << Qt::endl;
+            }
+            out << "用时 " << result.seconds << " 秒，dp表已写入 " << dpFile << Qt::endl;
+            if (parser.isSet(verifyOption)) {
+                if (!BandCluster::verify(mapFile, dpFile)) {
+                    out << "校验失败: dp表与Dungeon::solveDp的结果不同" << Qt::endl;
+                    Logger::flush();
+                    return 1;
+                }
+                out << "校验通过: dp表与Dungeon::solveDp的结果逐位相同" << Qt::endl;
+            }
+        } catch (const std::exception& e) {
+            qCritical() << "多进程求解失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(serveOption)) {
+#if defined(__unix__) || defined(__APPLE__)
+        // 先屏蔽信号再启动服务线程，各线程继承屏蔽，由这里统一等待
+        sigset_t signals;
+        sigemptyset(&signals);
+        sigaddset(&signals, SIGINT);
+        sigaddset(&signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        try {
+            SolverService service(parser.value(serveOption));
+            service.start();
+            int received = 0;
+            sigwait(&signals, &received);
+            service.stop();
+        } catch (const std::exception& e) {
+            qCritical() << "求解服务失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+#else
+        qCritical() << "当前平台不支持求解服务";
+        return 1;
+#endif
+    }
+
+    if (parser.isSet(loadTestOption)) {
+        LoadTestOptions options;
+        bool ok = true;
+        if (parser.isSet(clientsOption)) {
+            options.clients = parser.value(clientsOption).toInt(&ok);
+        }
+        if (ok && parser.isSet(requestsOption)) {
+            options.requestsPerClient = parser.value(requestsOption).toInt(&ok);
+        }
+        if (ok && parser.isSet(mapSizeOption)) {
+            options.rows = options.cols = parser.value(mapSizeOption).toInt(&ok);
+        }
+        if (!ok) {
+            qCritical() << "参数错误: 压测参数必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            LoadTestResult result = runLoadTest(parser.value(loadTestOption).toStdString(), options);
+            out << "请求: " << result.requests << "，失败 " << result.failures << "，用时 " << result.seconds
+                << " 秒，每秒 " << result.requestsPerSecond << " 个" << Qt::endl;
+            out << "往返延迟: p50 " << result.p50Micros << " 微秒，p99 " << result.p99Micros << " 微秒" << Qt::endl;
+            out << "服务端: 完成 " << result.server.completed << " 个请求，" << result.server.batches << " 批，p50 "
+                << result.server.p50Micros << " 微秒，p99 " << result.server.p99Micros << " 微秒" << Qt::endl;
+        } catch (const std::exception& e) {
+            qCritical() << "压测失败:" << e.what();
+            return 1;
+        }
+        return 0;
+    }
+
+    if (parser.isSet(validateReplaysOption)) {
+        QTextStream out(stdout);
+        try {
+            ReplayValidator validator;
+            for (const QString& mapFile : parser.values(replayMapOption)) {
+                Dungeon dungeon;
+                DungeonFile::open(mapFile, dungeon);
+                validator.addMap(dungeon);
+            }
+
+            ReplayBatch batch = ReplayBatch::load(parser.value(validateReplaysOption));
+            uint64_t start = PerfMetrics::now();
+            std::vector<ReplayResult> results = validator.validate(batch);
+            double seconds = (PerfMetrics::now() - start) / 1e9;
+
+            size_t counts[5] = {};
+            for (const ReplayResult& result : results) {
+                counts[static_cast<int>(result.outcome)]++;
+            }
+            out << "录像: " << results.size() << " 局，地图 " << validator.mapCount() << " 张" << Qt::endl;
+            out << "胜利 " << counts[static_cast<int>(ReplayOutcome::WON)]
+                << "，失败 " << counts[static_cast<int>(ReplayOutcome::LOST)]
+                << "，未完成 " << counts[static_cast<int>(ReplayOutcome::UNFINISHED)]
+                << "，非法 " << counts[static_cast<int>(ReplayOutcome::INVALID)]
+                << "，地图未知 " << counts[static_cast<int>(ReplayOutcome::UNKNOWN_MAP)] << Qt::endl;
+            out << "用时 " << seconds << " 秒，每秒 " << (seconds > 0 ? results.size() / seconds : 0) << " 局" << Qt::endl;
+        } catch (const std::exception& e) {
+            qCritical() << "验证录像失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(queryBenchmarkOption)) {
+        HealthQueryBenchmarkOptions options;
+        bool ok = true;
+        if (parser.isSet(mapSizeOption)) {
+            options.mapSize = parser.value(mapSizeOption).toInt(&ok);
+        }
+        if (ok && parser.isSet(queriesOption)) {
+            options.queries = parser.value(queriesOption).toInt(&ok);
+        }
+        if (!ok) {
+            qCritical() << "参数错误: 基准测试参数必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            HealthQueryBenchmarkResult result = runHealthQueryBenchmark(options);
+            out << "地图: " << options.mapSize << " x " << options.mapSize << "，每种分布 " << options.queries
+                << " 个查询，" << result.threads << " 个线程" << Qt::endl;
+            out << "随机起终点: " << result.randomSeconds << " 秒" << Qt::endl;
+            out << "共享终点（" << options.sharedTargets << " 个）: " << result.sharedTargetSeconds << " 秒" << Qt::endl;
+            out << "终点为地图终点: " << result.exitSeconds << " 秒" << Qt::endl;
+            out << "随机查询逐个用Dungeon::solveDp重新求解（抽样 " << options.baselineSamples << " 个外推）: " << result.baselineSeconds
+                << " 秒，抽样结果不一致 " << result.mismatches << " 个" << Qt::endl;
+        } catch (const std::exception& e) {
+            qCritical() << "查询基准测试失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(topPathsBenchmarkOption)) {
+        TopPathsBenchmarkOptions options;
+        bool ok = true;
+        if (parser.isSet(mapSizeOption)) {
+            options.mapSize = parser.value(mapSizeOption).toInt(&ok);
+        }
+        if (ok && parser.isSet(maxKOption)) {
+            options.maxK = parser.value(maxKOption).toInt(&ok);
+        }
+        if (!ok || options.mapSize <= 0 || options.maxK <= 0) {
+            qCritical() << "参数错误: 基准测试参数必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            TopPathsBenchmarkResult result = runTopPathsBenchmark(options);
+            out << "地图: " << options.mapSize << " x " << options.mapSize << "，求解dp表 " << result.solveSeconds
+                << " 秒" << Qt::endl;
+            for (const TopPathsBenchmarkRun& run : result.runs) {
+                out << "k = " << run.k << ": " << run.seconds << " 秒，所需健康值 " << run.bestHealth << " ~ "
+                    << run.worstHealth << Qt::endl;
+            }
+            if (!result.consistent) {
+                out << "结果异常: 路径条数、排序或第1条的健康值不符" << Qt::endl;
+                Logger::flush();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            qCritical() << "前K条路径基准测试失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+        Logger::flush();
+        return 0;
+    }
+
+    if (parser.isSet(corridorCheckOption)) {
+        bool ok = true;
+        int maps = parser.isSet(checkMapsOption) ? parser.value(checkMapsOption).toInt(&ok) : 3000;
+        if (!ok || maps <= 0) {
+            qCritical() << "参数错误: 地图数必须是正整数";
+            return 1;
+        }
+
+        QTextStream out(stdout);
+        try {
+            size_t failures = crossCheckOptimalCorridor(maps);
+            out << "最优走廊交叉检查: " << maps << " 张地图，不一致 " << failures << " 张" << Qt::endl;
+            Logger::flush();
+            return failures == 0 ? 0 : 1;
+        } catch (const std::exception& e) {
+            qCritical() << "最优走廊交叉检查失败:" << e.what();
+            Logger::flush();
+            return 1;
+        }
+    }
+
+    QString traceFile = parser.value(traceOption);
+    if (!traceFile.isEmpty()) {
+        Tracer::setEnabled(true);
+    }
 
     MainWindow window;
+    window.setObjectiveOrder(objectives);
     window.show();
 
-    return app.exec();
+    int result = app->exec();
+
+    if (!traceFile.isEmpty()) {
+        try {
+            Tracer::setEnabled(false);
+            Tracer::writeChromeTrace(traceFile);
+        } catch (const std::exception& e) {
+            qCritical() << "导出跟踪失败:" << e.what();
+        }
+    }
+
+    // 后台日志线程不随程序退出等待，这里输出剩余的日志
+    Logger::flush();
+    return result;
 }
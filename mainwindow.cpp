@@ -1,12 +1,25 @@
 #include "mainwindow.h"
+#include "mapimporter.h"
+#include "dungeonfile.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "solutioncache.h"
+#include "taskpool.h"
+#include "tracer.h"
 #include <QApplication>
+#include <QFileDialog>
+#include <QMenu>
+#include <QScrollBar>
+#include <QStandardPaths>
 #include <sstream>
-#include <QDebug>
+#include <algorithm>
+#include <climits>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent), dungeon(5, 5), pathIndex(0), currentMode(GameMode::AUTO),
     tableWindow(nullptr), stackedWidget(nullptr), mapModel(nullptr), mapTableView(nullptr) {
     try {
+        setupSolutionCache();
         setupUI();
         pathTimer = new QTimer(this);
         connect(pathTimer, &QTimer::timeout, this, &MainWindow::showNextPathStep);
@@ -24,12 +37,12 @@ MainWindow::~MainWindow() {
             pathTimer->stop();
         }
     } catch (const std::exception& e) {
-        qDebug() << "Destructor error:" << e.what();
+        LOG_WARNING("Destructor error: %s", e.what());
     }
 }
 
 void MainWindow::handleException(const std::exception& e, const QString& operation) {
-    qDebug() << operation << "发生错误:" << e.what();
+    LOG_ERROR("%s发生错误: %s", operation.toUtf8().constData(), e.what());
 
     QString message = QString("%1时发生错误:\n%2\n\n程序将尝试继续运行，但可能功能受限。")
                           .arg(operation)
@@ -50,6 +63,129 @@ void MainWindow::handleException(const std::exception& e, const QString& operati
     }
 }
 
+void MainWindow::setupSolutionCache() {
+    auto cache = std::make_shared<SolutionCache>();
+
+    // 磁盘缓存让相同地图在程序重启后也不必重新求解；只保存最小健康值和路径，目录总大小有上限
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheDir.isEmpty()) {
+        try {
+            cache->setDiskDirectory(cacheDir + "/solutions");
+        } catch (const std::exception& e) {
+            LOG_WARNING("Solution cache disk directory unavailable: %s", e.what());
+        }
+    }
+
+    dungeon.setSolutionCache(cache);
+}
+
+QString MainWindow::solutionCacheSummary() const {
+    auto cache = dungeon.getSolutionCache();
+    if (!cache) {
+        return QString();
+    }
+
+    SolutionCacheStats stats = cache->stats();
+    return QString("🗃️ 求解缓存: 命中 %1 次 (磁盘 %2) | 未命中 %3 次")
+        .arg(stats.memoryHits + stats.diskHits)
+        .arg(stats.diskHits)
+        .arg(stats.misses);
+}
+
+QString MainWindow::minHealthText() const {
+    DungeonSnapshotPtr snapshot = snapshotPublisher.current();
+    if (!snapshot) {
+        return QString();
+    }
+
+    QString text = snapshot->isSolvable() ? QString::number(snapshot->minHealth) : QString("无可行路线");
+    if (snapshot->healthCap > 0) {
+        text += QString(" (健康上限 %1)").arg(snapshot->healthCap);
+    }
+    if (snapshot->movement == MovementMode::FOUR_WAY) {
+        text += " (四向移动，按每次进入都生效分析)";
+    }
+    return text;
+}
+
+std::string MainWindow::moveKeysText() const {
+    return dungeon.getMovementMode() == MovementMode::FOUR_WAY ? "⬅️➡️⬆️⬇️" : "➡️⬇️";
+}
+
+QString MainWindow::objectiveSummary() const {
+    DungeonSnapshotPtr snapshot = snapshotPublisher.current();
+    if (!snapshot || snapshot->objectives.empty() || !snapshot->isSolvable()) {
+        return QString();
+    }
+
+    PathObjectives values = evaluatePath(snapshot->map.get(), snapshot->cols, snapshot->path, snapshot->minHealth);
+    QString order;
+    for (Objective objective : snapshot->objectives.tieBreaks) {
+        order += QString(" > ") + objectiveName(objective);
+    }
+    return QString("🎯 终点健康: %1 | 伤害房间: %2 | 最大单次伤害: %3 (健康值最小%4)")
+        .arg(values.finalHealth)
+        .arg(values.damageRooms)
+        .arg(values.peakDamage)
+        .arg(order);
+}
+
+void MainWindow::setObjectiveOrder(const ObjectiveOrder& order) {
+    dungeon.setObjectiveOrder(order);
+    syncObjectiveBoxes();
+}
+
+void MainWindow::syncObjectiveBoxes() {
+    if (!secondaryObjectiveBox || !tertiaryObjectiveBox) {
+        return;
+    }
+
+    // 按Dungeon中的当前设置显示，不触发重新求解
+    const std::vector<Objective>& tieBreaks = dungeon.getObjectiveOrder().tieBreaks;
+    QComboBox* boxes[] = {secondaryObjectiveBox, tertiaryObjectiveBox};
+    for (size_t n = 0; n < 2; ++n) {
+        int value = n < tieBreaks.size() ? static_cast<int>(tieBreaks[n]) : -1;
+        boxes[n]->blockSignals(true);
+        boxes[n]->setCurrentIndex(boxes[n]->findData(value));
+        boxes[n]->blockSignals(false);
+    }
+    tertiaryObjectiveBox->setEnabled(!tieBreaks.empty());
+}
+
+void MainWindow::applyObjectiveOrder() {
+    try {
+        ObjectiveOrder order;
+        int secondary = secondaryObjectiveBox->currentData().toInt();
+        int tertiary = tertiaryObjectiveBox->currentData().toInt();
+        if (secondary >= 0) {
+            order.tieBreaks.push_back(static_cast<Objective>(secondary));
+            if (tertiary >= 0) {
+                order.tieBreaks.push_back(static_cast<Objective>(tertiary));
+            }
+        }
+
+        dungeon.setObjectiveOrder(order);
+        syncObjectiveBoxes();
+        if (snapshotPublisher.current()) {
+            safeShowLoadedMap("🎯 优化目标已更新!");
+        }
+    } catch (const std::exception& e) {
+        syncObjectiveBoxes();   // 恢复为有效的设置
+        handleException(e, "设置优化目标");
+    }
+}
+
+QString MainWindow::corridorSummary() const {
+    DungeonSnapshotPtr snapshot = snapshotPublisher.current();
+    if (!snapshot || !snapshot->corridor) {
+        return QString();
+    }
+
+    return QString("🛤️ 最优路径: %1 条（只计每步保持dp等式的路径） | 最优走廊: %2 格")
+        .arg(QString::fromStdString(snapshot->corridor->pathCountText()))
+        .arg(snapshot->corridor->cellCount);
+}
+
 void MainWindow::setupUI() {
     try {
         // 创建堆叠窗口
@@ -150,10 +286,28 @@ void MainWindow::setupGameInterface() {
         colsSpinBox->setValue(5);
         controlLayout->addWidget(colsSpinBox);
 
+        controlLayout->addWidget(new QLabel("健康上限:"));
+        healthCapSpinBox = new QSpinBox();
+        healthCapSpinBox->setRange(0, 100000);
+        healthCapSpinBox->setSpecialValueText("不限");
+        healthCapSpinBox->setKeyboardTracking(false);  // 输入完成后再重新求解
+        controlLayout->addWidget(healthCapSpinBox);
+
+        controlLayout->addWidget(new QLabel("墙壁比例:"));
+        wallDensitySpinBox = new QSpinBox();
+        wallDensitySpinBox->setRange(0, 40);
+        wallDensitySpinBox->setSuffix("%");
+        wallDensitySpinBox->setToolTip("生成地图时随机放置墙壁的比例，起点、路点和公主格子保持为空地");
+        controlLayout->addWidget(wallDensitySpinBox);
+
         generateBtn = new QPushButton("生成地图");
         generateBtn->setStyleSheet("background-color: #3498DB; color: white; padding: 8px 16px; border: none; border-radius: 4px;");
         controlLayout->addWidget(generateBtn);
 
+        importBtn = new QPushButton("打开地图");
+        importBtn->setStyleSheet("background-color: #1ABC9C; color: white; padding: 8px 16px; border: none; border-radius: 4px;");
+        controlLayout->addWidget(importBtn);
+
         // 游戏模式选择
         controlLayout->addWidget(new QLabel("模式:"));
         modeGroup = new QButtonGroup(this);
@@ -175,12 +329,60 @@ void MainWindow::setupGameInterface() {
         resetBtn->setEnabled(false);
         controlLayout->addWidget(resetBtn);
 
+        hintCheckBox = new QCheckBox("显示提示");
+        hintCheckBox->setChecked(true);
+        hintCheckBox->setFocusPolicy(Qt::NoFocus);  // 不抢走方向键焦点
+        controlLayout->addWidget(hintCheckBox);
+
+        heatMapCheckBox = new QCheckBox("余量热力图");
+        heatMapCheckBox->setFocusPolicy(Qt::NoFocus);
+        controlLayout->addWidget(heatMapCheckBox);
+
+        corridorCheckBox = new QCheckBox("最优走廊");
+        corridorCheckBox->setFocusPolicy(Qt::NoFocus);
+        controlLayout->addWidget(corridorCheckBox);
+
+        fourWayCheckBox = new QCheckBox("四向移动");
+        fourWayCheckBox->setToolTip("手动模式中每个房间只在第一次进入时生效；最小健康值和自动路径按每次进入都生效分析");
+        fourWayCheckBox->setFocusPolicy(Qt::NoFocus);
+        controlLayout->addWidget(fourWayCheckBox);
+
+        // 所需初始健康值相同时依次比较的目标
+        controlLayout->addWidget(new QLabel("次要目标:"));
+        secondaryObjectiveBox = new QComboBox();
+        tertiaryObjectiveBox = new QComboBox();
+        for (QComboBox* box : {secondaryObjectiveBox, tertiaryObjectiveBox}) {
+            box->addItem("无", -1);
+            for (Objective objective : {Objective::FINAL_HEALTH, Objective::DAMAGE_ROOMS, Objective::PEAK_DAMAGE}) {
+                box->addItem(objectiveName(objective), static_cast<int>(objective));
+            }
+            box->setFocusPolicy(Qt::NoFocus);
+            box->setToolTip("只用于只向右下走、不限健康上限的经典路线。终点健康排在第一时在所有最小健康值路线中比较；"
+                            "其他目标排在第一时只比较每一步都保持dp等式的路线");
+            controlLayout->addWidget(box);
+        }
+        syncObjectiveBoxes();
+
         // 显示表格按钮
         showTableBtn = new QPushButton("显示表格");
         showTableBtn->setStyleSheet("background-color: #9B59B6; color: white; padding: 8px 16px; border: none; border-radius: 4px;");
         showTableBtn->setEnabled(false);
         controlLayout->addWidget(showTableBtn);
 
+        traceBtn = new QPushButton("⏺ 录制跟踪");
+        traceBtn->setCheckable(true);
+        traceBtn->setFocusPolicy(Qt::NoFocus);
+        traceBtn->setToolTip("记录生成、求解和绘制的耗时，停止时导出为Chrome/Perfetto跟踪文件");
+#ifdef DUNGEON_NO_TRACE
+        traceBtn->setVisible(false);    // 跟踪已在编译时移除
+#endif
+        controlLayout->addWidget(traceBtn);
+
+        perfHudCheckBox = new QCheckBox("性能面板");
+        perfHudCheckBox->setFocusPolicy(Qt::NoFocus);
+        perfHudCheckBox->setToolTip("显示生成、求解、绘制耗时和内存占用");
+        controlLayout->addWidget(perfHudCheckBox);
+
         returnBtn = new QPushButton("返回主菜单");
         returnBtn->setStyleSheet("background-color: #E74C3C; color: white; padding: 8px 16px; border: none; border-radius: 4px;");
         controlLayout->addWidget(returnBtn);
@@ -202,6 +404,10 @@ void MainWindow::setupGameInterface() {
         positionLabel->setStyleSheet("font-size: 14px; color: #3498DB;");
         statusLayout->addWidget(positionLabel);
 
+        hintLabel = new QLabel("");
+        hintLabel->setStyleSheet("font-size: 14px; color: #9B59B6;");
+        statusLayout->addWidget(hintLabel);
+
         statusLayout->addStretch();
         gameLayout->addLayout(statusLayout);
 
@@ -218,8 +424,20 @@ void MainWindow::setupGameInterface() {
 
         mapTableView->setModel(mapModel);
         mapTableView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+        mapTableView->setContextMenuPolicy(Qt::CustomContextMenu);
         gameLayout->addWidget(mapTableView, 1);
 
+        // 性能面板是视图的子控件（不在视口内），不透明背景，刷新面板不会引起地图重绘
+        perfHudLabel = new QLabel(mapTableView);
+        perfHudLabel->setAutoFillBackground(true);
+        perfHudLabel->setStyleSheet("background-color: #2C3E50; color: #ECF0F1; font-family: monospace; "
+                                    "font-size: 12px; padding: 6px;");
+        perfHudLabel->setAttribute(Qt::WA_TransparentForMouseEvents);
+        perfHudLabel->hide();
+
+        perfHudTimer = new QTimer(this);
+        perfHudTimer->setInterval(250);
+
         // 信息显示
         infoText = new QTextEdit();
         infoText->setMaximumHeight(120);
@@ -229,6 +447,7 @@ void MainWindow::setupGameInterface() {
 
         // 连接信号
         connect(generateBtn, &QPushButton::clicked, this, &MainWindow::generateNewMap);
+        connect(importBtn, &QPushButton::clicked, this, &MainWindow::importMap);
         connect(startBtn, &QPushButton::clicked, [this]() {
             if (autoModeBtn->isChecked()) {
                 startAutoMode();
@@ -237,7 +456,57 @@ void MainWindow::setupGameInterface() {
             }
         });
         connect(resetBtn, &QPushButton::clicked, this, &MainWindow::resetManualGame);
+        connect(healthCapSpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int cap) {
+            try {
+                // 上限在生成新地图后继续有效
+                dungeon.setHealthCap(cap);
+                if (snapshotPublisher.current()) {
+                    safeShowLoadedMap("❤️ 健康上限已更新!");
+                }
+            } catch (const std::exception& e) {
+                handleException(e, "设置健康上限");
+            }
+        });
+        connect(wallDensitySpinBox, QOverload<int>::of(&QSpinBox::valueChanged), [this](int percent) {
+            try {
+                // 下次生成地图时生效
+                dungeon.setWallDensity(percent);
+            } catch (const std::exception& e) {
+                handleException(e, "设置墙壁比例");
+            }
+        });
+        connect(secondaryObjectiveBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &MainWindow::applyObjectiveOrder);
+        connect(tertiaryObjectiveBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+                this, &MainWindow::applyObjectiveOrder);
+        connect(fourWayCheckBox, &QCheckBox::toggled, [this](bool checked) {
+            try {
+                dungeon.setMovementMode(checked ? MovementMode::FOUR_WAY : MovementMode::RIGHT_DOWN);
+                if (snapshotPublisher.current()) {
+                    safeShowLoadedMap("🧭 移动方式已更新!");
+                }
+            } catch (const std::exception& e) {
+                // 当前设置不支持四向移动时恢复勾选状态
+                fourWayCheckBox->blockSignals(true);
+                fourWayCheckBox->setChecked(!checked);
+                fourWayCheckBox->blockSignals(false);
+                handleException(e, "设置移动方式");
+            }
+        });
+        connect(hintCheckBox, &QCheckBox::toggled, [this]() {
+            try {
+                updateHint();
+            } catch (const std::exception& e) {
+                handleException(e, "切换提示");
+            }
+        });
+        connect(heatMapCheckBox, &QCheckBox::toggled, mapModel, &DungeonMapModel::setHeatMapEnabled);
+        connect(corridorCheckBox, &QCheckBox::toggled, mapModel, &DungeonMapModel::setCorridorVisible);
         connect(showTableBtn, &QPushButton::clicked, this, &MainWindow::showTableWindow);
+        connect(traceBtn, &QPushButton::toggled, this, &MainWindow::toggleTracing);
+        connect(perfHudCheckBox, &QCheckBox::toggled, this, &MainWindow::togglePerfHud);
+        connect(perfHudTimer, &QTimer::timeout, this, &MainWindow::updatePerfHud);
+        connect(mapTableView, &QWidget::customContextMenuRequested, this, &MainWindow::showRouteMenu);
         connect(returnBtn, &QPushButton::clicked, this, &MainWindow::returnToMenu);
 
         stackedWidget->addWidget(gameWidget);
@@ -261,13 +530,16 @@ void MainWindow::showGameRules() {
             "• 绿色房间：增益房间(+健康值)\n"
             "• 红色房间：伤害房间(-健康值)\n"
             "• 灰色房间：中性房间(无影响)\n"
+            "• 深色“墙”：墙壁，不能进入\n"
             "• 蓝色边框：起点和终点位置\n"
             "• 橙色背景：走过的路径\n\n"
 
             "🎯 移动规则：\n"
             "• 只能向右→或向下↓移动\n"
+            "• 勾选四向移动后可上下左右移动，每个房间只在第一次进入时生效\n"
             "• 手动模式使用方向键控制\n"
             "• 健康值≤0时游戏失败\n"
+            "• 被墙壁挡住无路可走时游戏失败\n"
             "• 到达终点且健康值>0时获胜\n\n"
 
             "📊 表格功能：\n"
@@ -422,6 +694,54 @@ void MainWindow::safeGenerateNewMap() {
     dungeon.setSize(rows, cols);
     dungeon.generateMap();
 
+    safeShowLoadedMap("🗺️ 大地图已生成!");
+}
+
+void MainWindow::importMap() {
+    try {
+        safeImportMap();
+    } catch (const std::exception& e) {
+        handleException(e, "导入地图");
+    }
+}
+
+void MainWindow::safeImportMap() {
+    QString fileName = QFileDialog::getOpenFileName(this, "打开地图", QString(),
+                                                    "Map Files (*.csv *.dgn);;CSV Files (*.csv);;Dungeon Files (*.dgn)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    if (resultLabel) {
+        resultLabel->setText("正在导入地图，请稍候...");
+    }
+
+    QApplication::processEvents(); // 刷新界面
+
+    if (fileName.endsWith(".dgn", Qt::CaseInsensitive)) {
+        // 二进制地图直接映射，不复制数据
+        DungeonFile::open(fileName, dungeon);
+    } else {
+        MapCsvImporter importer;
+        importer.importFile(fileName, dungeon);
+    }
+
+    // 尺寸在控件范围内时同步到控件
+    if (rowsSpinBox && colsSpinBox) {
+        rowsSpinBox->setValue(qBound(rowsSpinBox->minimum(), dungeon.getRows(), rowsSpinBox->maximum()));
+        colsSpinBox->setValue(qBound(colsSpinBox->minimum(), dungeon.getCols(), colsSpinBox->maximum()));
+    }
+
+    safeShowLoadedMap("📂 大地图已导入!");
+}
+
+void MainWindow::safeShowLoadedMap(const QString& largeMapTitle) {
+    int rows = dungeon.getRows();
+    int cols = dungeon.getCols();
+
+    // 发布新地图的快照，视图和表格窗口都只读取快照
+    publishSnapshot();
+
     safeUpdateMapDisplay();
     clearPathDisplay();
 
@@ -441,9 +761,13 @@ void MainWindow::safeGenerateNewMap() {
     if (positionLabel) {
         positionLabel->setText("");
     }
+    if (hintLabel) {
+        hintLabel->setText("");
+    }
+    hintEngine.setSnapshot(snapshotPublisher.current());
 
-    // 计算最小健康值
-    int minHealth = dungeon.calculateMinHealth();
+    // 最小健康值已在快照中
+    QString minHealth = minHealthText();
 
     if (rows > 15 || cols > 15) {
         // 大地图模式
@@ -451,17 +775,27 @@ void MainWindow::safeGenerateNewMap() {
             resultLabel->setText(QString("大地图模式 (%1×%2) - 最小初始健康值: %3").arg(rows).arg(cols).arg(minHealth));
         }
 
+        // 超出生成上限的导入地图不自动打开表格，避免一次创建过多表格项
+        bool autoShowTable = static_cast<long long>(rows) * cols <= 100 * 100;
+
         std::ostringstream info;
-        info << "🗺️ 大地图已生成! (" << rows << "×" << cols << ")\n";
-        info << "📊 最小初始健康值: " << minHealth << "\n";
-        info << "表格窗口已自动打开";  // 修改：提示信息
+        info << largeMapTitle.toStdString() << " (" << rows << "×" << cols << ")\n";
+        info << "📊 最小初始健康值: " << minHealth.toStdString() << "\n";
+        info << (autoShowTable ? "表格窗口已自动打开" : "点击'显示表格'查看详细数据") << "\n";
+        info << corridorSummary().toStdString() << "\n";
+        if (!objectiveSummary().isEmpty()) {
+            info << objectiveSummary().toStdString() << "\n";
+        }
+        info << solutionCacheSummary().toStdString();
 
         if (infoText) {
             infoText->setText(QString::fromStdString(info.str()));
         }
 
-        // 新增：大地图自动弹出表格窗口
-        safeShowTableWindow();
+        // 大地图自动弹出表格窗口
+        if (autoShowTable) {
+            safeShowTableWindow();
+        }
     } else {
         // 小地图模式
         if (resultLabel) {
@@ -469,9 +803,14 @@ void MainWindow::safeGenerateNewMap() {
         }
 
         std::ostringstream info;
-        info << "地图尺寸: " << rows << "×" << cols << " | 最小健康值: " << minHealth << "\n";
-        info << "🔵 蓝色边框: 起点(骑士) | 🔵 蓝色边框: 终点(公主)\n";
-        info << "🟢 绿色: 增益房间 | 🔴 红色: 伤害房间 | ⚫ 灰色: 中性房间";
+        info << "地图尺寸: " << rows << "×" << cols << " | 最小健康值: " << minHealth.toStdString() << "\n";
+        info << "🔵 蓝色边框: 起点(骑士) | 🔵 蓝色边框: 终点(公主) | 青色边框: 路点 | 右键格子编辑路线\n";
+        info << "🟢 绿色: 增益房间 | 🔴 红色: 伤害房间 | ⚫ 灰色: 中性房间\n";
+        info << corridorSummary().toStdString() << "\n";
+        if (!objectiveSummary().isEmpty()) {
+            info << objectiveSummary().toStdString() << "\n";
+        }
+        info << solutionCacheSummary().toStdString();
 
         if (infoText) {
             infoText->setText(QString::fromStdString(info.str()));
@@ -479,6 +818,11 @@ void MainWindow::safeGenerateNewMap() {
     }
 }
 
+void MainWindow::publishSnapshot() {
+    // 同一地图版本的快照会被复用，不会重复求解
+    snapshotPublisher.publish(dungeon.snapshot());
+}
+
 void MainWindow::updateMapDisplay() {
     try {
         safeUpdateMapDisplay();
@@ -500,7 +844,7 @@ void MainWindow::safeUpdateMapDisplay() {
         // 大地图：完全断开TableView连接
         mapTableView->setModel(nullptr);
         mapTableView->hide();
-        mapModel->setDungeon(nullptr);
+        mapModel->setSnapshot(nullptr);
 
         if (autoModeBtn) autoModeBtn->setEnabled(false);
         if (manualModeBtn) manualModeBtn->setEnabled(false);
@@ -508,7 +852,7 @@ void MainWindow::safeUpdateMapDisplay() {
         if (resetBtn) resetBtn->setEnabled(false);
     } else {
         // 小地图：正常连接
-        mapModel->setDungeon(&dungeon);
+        mapModel->setSnapshot(snapshotPublisher.current());
         mapTableView->setModel(mapModel);
         mapTableView->show();
         mapTableView->updateCellSize();
@@ -530,11 +874,20 @@ void MainWindow::startAutoMode() {
 
 void MainWindow::safeStartAutoMode() {
     currentMode = GameMode::AUTO;
-    int minHealth = dungeon.calculateMinHealth();
-    autoPath = dungeon.getOptimalPath();
+
+    DungeonSnapshotPtr snapshot = snapshotPublisher.current();
+    if (!snapshot) {
+        throw MainWindowException("地图尚未生成");
+    }
+
+    if (!snapshot->isSolvable()) {
+        throw MainWindowException("当前健康上限下没有可行路线");
+    }
+
+    autoPath = snapshot->path;
 
     if (resultLabel) {
-        resultLabel->setText(QString("自动模式 - 最小初始健康点数: %1").arg(minHealth));
+        resultLabel->setText(QString("自动模式 - 最小初始健康点数: %1").arg(minHealthText()));
     }
 
     std::ostringstream info;
@@ -569,6 +922,7 @@ void MainWindow::startManualMode() {
 void MainWindow::safeStartManualMode() {
     currentMode = GameMode::MANUAL;
     dungeon.resetGame(100);
+    hintEngine.setSnapshot(snapshotPublisher.current());
 
     safeUpdateManualDisplay();
 
@@ -585,7 +939,7 @@ void MainWindow::safeStartManualMode() {
 
     std::ostringstream info;
     info << "🎮 手动模式开始!\n";
-    info << "使用方向键 ➡️⬇️ 控制骑士移动\n";
+    info << "使用方向键 " << moveKeysText() << " 控制骑士移动\n";
     info << "目标: 到达终点且健康值 > 0";
 
     if (infoText) {
@@ -599,6 +953,7 @@ void MainWindow::resetManualGame() {
     try {
         if (currentMode == GameMode::MANUAL) {
             dungeon.resetGame(100);
+            hintEngine.reset();
             safeUpdateManualDisplay();
 
             if (resultLabel) {
@@ -607,7 +962,7 @@ void MainWindow::resetManualGame() {
 
             std::ostringstream info;
             info << "🔄 游戏已重置!\n";
-            info << "使用方向键 ➡️⬇️ 控制骑士移动\n";
+            info << "使用方向键 " << moveKeysText() << " 控制骑士移动\n";
             info << "目标: 到达终点且健康值 > 0";
 
             if (infoText) {
@@ -646,12 +1001,219 @@ void MainWindow::safeUpdateManualDisplay() {
         positionLabel->setText(QString("📍 位置: (%1, %2)").arg(playerPos.x()).arg(playerPos.y()));
     }
 
+    updateHint();
+
     // 检查游戏结束
     if (dungeon.getGameState() != GameState::PLAYING) {
         showGameResult();
     }
 }
 
+void MainWindow::updateHint() {
+    if (!mapModel) {
+        return;
+    }
+
+    bool enabled = hintCheckBox && hintCheckBox->isChecked() &&
+                   currentMode == GameMode::MANUAL && dungeon.getGameState() == GameState::PLAYING;
+
+    MoveHint hint;
+    if (enabled) {
+        // 直接读取快照中已求解的dp表，不触发重新求解
+        hint = hintEngine.update(dungeon.getPlayerPosition(), dungeon.getCurrentHealth(), dungeon.getNextWaypoint());
+    }
+
+    if (!hint.valid) {
+        mapModel->setHintPath({});
+        if (hintLabel) {
+            hintLabel->setText("");
+        }
+        return;
+    }
+
+    mapModel->setHintPath(hintEngine.remainingPath());
+
+    if (hintLabel) {
+        QString text;
+        if (hint.healthNeeded == INT_MAX) {
+            text = "⚠️ 已无法到达公主";
+        } else if (!hint.canStillWin) {
+            text = QString("⚠️ 已无法获胜 (还差 %1)").arg(-hint.slack);
+        } else if (hint.atTarget) {
+            text = "✅ 已到达终点";
+        } else {
+            QString right = !hint.rightAvailable ? "—" : (hint.rightSafe ? "✅" : "❌");
+            QString down = !hint.downAvailable ? "—" : (hint.downSafe ? "✅" : "❌");
+            QString best = hint.recommended == QPoint(1, 0) ? "➡️" : "⬇️";
+            text = QString("💡 仍可获胜 (余量 %1) | ➡️%2 ⬇️%3 | 推荐 %4")
+                       .arg(hint.slack).arg(right).arg(down).arg(best);
+        }
+        hintLabel->setText(text);
+    }
+}
+
+void MainWindow::showRouteMenu(const QPoint& pos) {
+    try {
+        safeShowRouteMenu(pos);
+    } catch (const std::exception& e) {
+        handleException(e, "编辑路线");
+    }
+}
+
+void MainWindow::toggleTracing(bool recording) {
+    try {
+        if (recording) {
+            Tracer::setEnabled(true);
+            traceBtn->setText("⏹ 停止并导出");
+            return;
+        }
+
+        Tracer::setEnabled(false);
+        traceBtn->setText("⏺ 录制跟踪");
+
+        QString fileName = QFileDialog::getSaveFileName(this, "导出跟踪", "dungeon_trace.json",
+                                                        "Trace Files (*.json)");
+        if (fileName.isEmpty()) {
+            return;
+        }
+        Tracer::writeChromeTrace(fileName);
+        QMessageBox::information(this, "导出成功",
+                                 QString("共%1个事件（丢弃%2个），可在chrome://tracing或Perfetto中打开:\n%3")
+                                     .arg(Tracer::eventCount()).arg(Tracer::droppedCount()).arg(fileName));
+    } catch (const std::exception& e) {
+        handleException(e, "导出跟踪");
+    }
+}
+
+void MainWindow::togglePerfHud(bool visible) {
+    try {
+        if (!visible) {
+            perfHudTimer->stop();
+            perfHudLabel->hide();
+            return;
+        }
+        updatePerfHud();
+        perfHudLabel->show();
+        perfHudLabel->raise();
+        perfHudTimer->start();
+    } catch (const std::exception& e) {
+        handleException(e, "切换性能面板");
+    }
+}
+
+void MainWindow::updatePerfHud() {
+    try {
+        perfHudLabel->setText(perfHudText());
+        perfHudLabel->adjustSize();
+
+        // 跟随视图大小停靠在右上角（避开竖直滚动条）
+        int right = mapTableView->width() - mapTableView->frameWidth();
+        if (mapTableView->verticalScrollBar()->isVisible()) {
+            right -= mapTableView->verticalScrollBar()->width();
+        }
+        perfHudLabel->move(std::max(0, right - perfHudLabel->width() - 4), mapTableView->frameWidth() + 4);
+    } catch (const std::exception& e) {
+        perfHudTimer->stop();
+        handleException(e, "刷新性能面板");
+    }
+}
+
+QString MainWindow::perfHudText() const {
+    PerfSample s = PerfMetrics::instance().sample();
+
+    auto ms = [](uint64_t ns) { return QString::number(ns / 1e6, 'f', 2) + " ms"; };
+    auto bytes = [](uint64_t n) {
+        if (n >= (uint64_t(1) << 20)) {
+            return QString::number(n / 1048576.0, 'f', 1) + " MB";
+        }
+        return QString::number(n / 1024.0, 'f', 1) + " KB";
+    };
+
+    QStringList lines;
+    lines << QString("生成: %1 (%2次尝试)").arg(ms(s.generateNs)).arg(s.generateAttempts);
+    lines << QString("求解: %1, %2 格/秒").arg(ms(s.solveNs)).arg(s.cellsPerSecond(), 0, 'e', 2);
+    lines << QString("路径长度: %1").arg(s.pathLength);
+    lines << QString("绘制: %1/帧, data() %2次/帧").arg(ms(s.framePaintNs)).arg(s.frameDataCalls);
+    lines << QString("按键延迟: %1, 累计%2帧").arg(ms(s.keyLatencyNs)).arg(s.frames);
+    lines << QString("内存: 地图 %1, DP %2, 叠加层 %3")
+                 .arg(bytes(s.mapBytes)).arg(bytes(s.dpBytes)).arg(bytes(s.overlayBytes));
+    lines << QString("缓冲区池: %1 (峰值 %2)").arg(bytes(s.arenaBytes)).arg(bytes(s.arenaPeakBytes));
+
+    TaskPoolStats pool = TaskPool::instance().stats();
+    lines << QString("任务池: %1线程, 排队%2, 已执行%3, 窃取%4")
+                 .arg(pool.workers).arg(pool.queued).arg(pool.executed).arg(pool.steals);
+    return lines.join('\n');
+}
+
+void MainWindow::safeShowRouteMenu(const QPoint& pos) {
+    if (!mapTableView) {
+        throw MainWindowException("地图视图未初始化");
+    }
+
+    QModelIndex index = mapTableView->indexAt(pos);
+    if (!index.isValid()) {
+        return;
+    }
+
+    QPoint cell(index.column(), index.row());
+    RoutePlan plan = dungeon.getRoute();
+    bool isWaypoint = std::find(plan.waypoints.begin(), plan.waypoints.end(), cell) != plan.waypoints.end();
+    bool isWall = dungeon.isWall(cell.y(), cell.x());
+    bool onRoute = cell == plan.start || isWaypoint || plan.isTarget(cell);
+
+    QMenu menu(this);
+    QAction* startAction = menu.addAction("设为起点");
+    QAction* waypointAction = menu.addAction("添加路点");
+    QAction* targetAction = menu.addAction("设为公主");
+    QAction* extraTargetAction = menu.addAction("添加候选公主");
+    menu.addSeparator();
+    QAction* removeAction = menu.addAction("移除路点/公主");
+    QAction* classicAction = menu.addAction("恢复默认路线");
+    menu.addSeparator();
+    QAction* wallAction = menu.addAction(isWall ? "拆除墙壁" : "设为墙壁");
+    startAction->setEnabled(!isWall);
+    waypointAction->setEnabled(!isWaypoint && !isWall);
+    targetAction->setEnabled(!isWall);
+    extraTargetAction->setEnabled(!plan.isTarget(cell) && !isWall);
+    removeAction->setEnabled(isWaypoint || plan.isTarget(cell));
+    wallAction->setEnabled(!onRoute);   // 起点、路点和公主格子不能是墙
+
+    QAction* chosen = menu.exec(mapTableView->viewport()->mapToGlobal(pos));
+    if (!chosen) {
+        return;
+    }
+
+    if (chosen == wallAction) {
+        dungeon.setWall(cell.y(), cell.x(), !isWall);
+        safeShowLoadedMap("🧱 墙壁已更新!");
+        return;
+    }
+
+    if (chosen == startAction) {
+        plan.start = cell;
+    } else if (chosen == waypointAction) {
+        // 路点只能依次向右下排列，按位置插入到合适的顺序
+        auto it = std::upper_bound(plan.waypoints.begin(), plan.waypoints.end(), cell,
+                                   [](const QPoint& a, const QPoint& b) {
+                                       return a.x() + a.y() < b.x() + b.y();
+                                   });
+        plan.waypoints.insert(it, cell);
+    } else if (chosen == targetAction) {
+        plan.targets.assign(1, cell);
+    } else if (chosen == extraTargetAction) {
+        plan.targets.push_back(cell);
+    } else if (chosen == removeAction) {
+        plan.waypoints.erase(std::remove(plan.waypoints.begin(), plan.waypoints.end(), cell), plan.waypoints.end());
+        plan.targets.erase(std::remove(plan.targets.begin(), plan.targets.end(), cell), plan.targets.end());
+    } else if (chosen == classicAction) {
+        plan = RoutePlan::classic(dungeon.getRows(), dungeon.getCols());
+    }
+
+    // 无法走通的路线由Dungeon拒绝并提示，当前路线保持不变
+    dungeon.setRoute(plan);
+    safeShowLoadedMap("🛤️ 路线已更新!");
+}
+
 void MainWindow::showGameResult() {
     try {
         GameState state = dungeon.getGameState();
@@ -687,12 +1249,19 @@ void MainWindow::keyPressEvent(QKeyEvent *event) {
             case Qt::Key_Down:
                 moved = dungeon.movePlayer(0, 1);
                 break;
+            case Qt::Key_Left:
+                moved = dungeon.movePlayer(-1, 0);   // 仅四向移动模式可用
+                break;
+            case Qt::Key_Up:
+                moved = dungeon.movePlayer(0, -1);
+                break;
             default:
                 QMainWindow::keyPressEvent(event);
                 return;
             }
 
             if (moved) {
+                PerfMetrics::instance().markKeyPress();
                 safeUpdateManualDisplay();
             }
         }
@@ -741,7 +1310,7 @@ void MainWindow::clearPathDisplay() {
             mapModel->clearPaths();
         }
     } catch (const std::exception& e) {
-        qDebug() << "clearPathDisplay error:" << e.what();
+        LOG_WARNING("clearPathDisplay error: %s", e.what());
         // 不显示错误对话框，这是内部清理操作
     }
 }
@@ -781,8 +1350,13 @@ void MainWindow::safeShowTableWindow() {
         tableWindow = nullptr;
     }
 
+    DungeonSnapshotPtr snapshot = snapshotPublisher.current();
+    if (!snapshot) {
+        throw MainWindowException("地图尚未生成");
+    }
+
     // 创建新的表格窗口
-    tableWindow = new MapTableWindow(&dungeon, this);
+    tableWindow = new MapTableWindow(snapshot, this);
     if (!tableWindow) {
         throw MainWindowException("创建表格窗口失败");
     }
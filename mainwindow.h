@@ -10,12 +10,15 @@
 #include <QSpinBox>
 #include <QRadioButton>
 #include <QButtonGroup>
+#include <QCheckBox>
+#include <QComboBox>
 #include <QTextEdit>
 #include <QTimer>
 #include <QKeyEvent>
 #include <QMessageBox>
 #include <stdexcept>
 #include "dungeon.h"
+#include "hintengine.h"
 #include "dungeonmapmodel.h"
 #include "dungeontableview.h"
 #include "maptablewindow.h"
@@ -32,6 +35,9 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
+    // 设置次要优化目标并同步到界面（命令行参数用）
+    void setObjectiveOrder(const ObjectiveOrder& order);
+
 protected:
     void keyPressEvent(QKeyEvent *event) override;
 
@@ -40,14 +46,27 @@ private slots:
     void returnToMenu();
     void showGameRules();
     void generateNewMap();
+    void importMap();
     void startAutoMode();
     void startManualMode();
     void resetManualGame();
     void showNextPathStep();
     void showTableWindow();
+    void showRouteMenu(const QPoint& pos);
+    void toggleTracing(bool recording);
+    void togglePerfHud(bool visible);
+    void updatePerfHud();
 
 private:
     void setupUI();
+    void setupSolutionCache();
+    QString solutionCacheSummary() const;
+    QString corridorSummary() const;
+    QString minHealthText() const;
+    std::string moveKeysText() const;
+    QString objectiveSummary() const;
+    void applyObjectiveOrder();
+    void syncObjectiveBoxes();
     void setupMainMenu();
     void setupGameInterface();
     void updateMapDisplay();
@@ -58,11 +77,17 @@ private:
 
     // 安全的操作方法
     void safeGenerateNewMap();
+    void safeImportMap();
+    void safeShowLoadedMap(const QString& largeMapTitle);
+    void publishSnapshot();
     void safeUpdateMapDisplay();
     void safeStartAutoMode();
     void safeStartManualMode();
     void safeShowTableWindow();
+    void safeShowRouteMenu(const QPoint& pos);
     void safeUpdateManualDisplay();
+    void updateHint();
+    QString perfHudText() const;
     void handleException(const std::exception& e, const QString& operation);
 
     // UI组件
@@ -83,7 +108,10 @@ private:
 
     QSpinBox* rowsSpinBox;
     QSpinBox* colsSpinBox;
+    QSpinBox* healthCapSpinBox; // 健康上限，0表示不限
+    QSpinBox* wallDensitySpinBox;   // 生成地图时的墙壁比例（百分比）
     QPushButton* generateBtn;
+    QPushButton* importBtn;
 
     QButtonGroup* modeGroup;
     QRadioButton* autoModeBtn;
@@ -91,19 +119,32 @@ private:
 
     QPushButton* startBtn;
     QPushButton* resetBtn;
+    QCheckBox* hintCheckBox;    // 手动模式提示开关
+    QCheckBox* heatMapCheckBox; // 余量热力图开关
+    QCheckBox* corridorCheckBox;    // 最优走廊开关
+    QCheckBox* fourWayCheckBox;     // 四向移动开关
+    QComboBox* secondaryObjectiveBox;   // 第二目标
+    QComboBox* tertiaryObjectiveBox;    // 第三目标
     QPushButton* returnBtn;
     QPushButton* showTableBtn;  // 新增显示表格按钮
+    QPushButton* traceBtn;      // 录制跟踪，停止时导出trace JSON
+    QCheckBox* perfHudCheckBox; // 性能面板开关
 
     QLabel* resultLabel;
     QLabel* healthLabel;
     QLabel* positionLabel;
+    QLabel* hintLabel;
 
     DungeonMapModel* mapModel;
     DungeonTableView* mapTableView;
     QTextEdit* infoText;
+    QLabel* perfHudLabel;       // 叠在地图右上角的性能面板
+    QTimer* perfHudTimer;       // 面板显示时定时取样
 
     // 游戏逻辑
     Dungeon dungeon;
+    SnapshotPublisher snapshotPublisher;    // 视图读取的当前地图快照
+    HintEngine hintEngine;                  // 手动模式的实时提示
     std::vector<QPoint> autoPath;
     QTimer* pathTimer;
     int pathIndex;
@@ -0,0 +1,86 @@
+#include "maphash.h"
+#include <cstring>
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t mixRound(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    acc = rotl(acc, 31);
+    return acc * PRIME1;
+}
+
+inline uint64_t avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME2;
+    h ^= h >> 29;
+    h *= PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+} // namespace
+
+std::string MapHash::toHex() const {
+    static const char digits[] = "0123456789abcdef";
+    std::string result(32, '0');
+    for (int k = 0; k < 16; ++k) {
+        result[15 - k] = digits[(high >> (4 * k)) & 0xF];
+        result[31 - k] = digits[(low >> (4 * k)) & 0xF];
+    }
+    return result;
+}
+
+MapHash hashMap(const int* cells, int rows, int cols, const uint64_t* walls) {
+    size_t count = static_cast<size_t>(rows) * cols;
+    uint64_t shape = (static_cast<uint64_t>(static_cast<uint32_t>(rows)) << 32) | static_cast<uint32_t>(cols);
+
+    // 尺寸参与初始值，相同数据不同形状得到不同哈希
+    uint64_t acc[4] = {
+        shape + PRIME1 + PRIME2,
+        shape + PRIME2,
+        shape,
+        shape - PRIME1
+    };
+
+    // 主循环：每次8个格子，两两拼成一个64位输入分给四条通道
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t lanes[4];
+        std::memcpy(lanes, cells + i, sizeof(lanes));
+        for (int l = 0; l < 4; ++l) {
+            acc[l] = mixRound(acc[l], lanes[l]);
+        }
+    }
+
+    // 剩余不足8个的格子
+    for (int l = 0; i < count; ++i, l = (l + 1) & 3) {
+        acc[l] = mixRound(acc[l], static_cast<uint32_t>(cells[i]) ^ (static_cast<uint64_t>(i) << 32));
+    }
+
+    // 障碍位图只有非零的字参与，并带上字序号，全是空地时哈希不变
+    if (walls) {
+        size_t words = (count + 63) / 64;
+        for (size_t w = 0; w < words; ++w) {
+            if (walls[w]) {
+                acc[w & 3] = mixRound(acc[w & 3], walls[w] ^ rotl(w * PRIME3, 17));
+            }
+        }
+    }
+
+    uint64_t mergedLow = rotl(acc[0], 1) + rotl(acc[1], 7) + rotl(acc[2], 12) + rotl(acc[3], 18);
+    uint64_t mergedHigh = rotl(acc[0], 23) ^ rotl(acc[1], 41) ^ rotl(acc[2], 53) ^ rotl(acc[3], 5);
+
+    MapHash result;
+    result.low = avalanche(mergedLow ^ (count * PRIME4));
+    result.high = avalanche(mergedHigh + mixRound(mergedLow, shape) + PRIME3);
+    return result;
+}
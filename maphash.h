@@ -0,0 +1,33 @@
+#ifndef MAPHASH_H
+#define MAPHASH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// 地图内容的128位哈希，同时覆盖尺寸和全部格子
+struct MapHash {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const MapHash& other) const { return low == other.low && high == other.high; }
+    bool operator!=(const MapHash& other) const { return !(*this == other); }
+
+    // 32位十六进制字符串，用作磁盘缓存文件名
+    std::string toHex() const;
+};
+
+namespace std {
+template <>
+struct hash<MapHash> {
+    size_t operator()(const MapHash& h) const { return static_cast<size_t>(h.low ^ (h.high * 0x9E3779B97F4A7C15ULL)); }
+};
+}
+
+// 计算行优先地图数据的哈希。四条相互独立的64位累加通道，
+// 每次处理8个格子，编译器可以将其展开为向量指令。
+// walls为障碍位图（可为空），没有墙壁时与不传位图的结果相同
+MapHash hashMap(const int* cells, int rows, int cols, const uint64_t* walls = nullptr);
+
+#endif // MAPHASH_H
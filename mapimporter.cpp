@@ -0,0 +1,343 @@
+#include "mapimporter.h"
+#include "logger.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include <QFile>
+#include <algorithm>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <functional>
+
+namespace {
+
+// 每个线程至少处理的字节数，太小的文件不值得切块
+const size_t MIN_CHUNK_BYTES = 1 << 20;
+
+struct ChunkResult {
+    long long lineCount = 0;                // 本块的数据行数
+    long long errorCount = 0;               // 本块的错误总数
+    std::vector<MapImportError> errors;     // 本块记录下来的错误（有上限）
+    std::vector<size_t> walls;              // 本块中墙壁格子的下标
+};
+
+const char* findLineEnd(const char* p, const char* end) {
+    const void* nl = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return nl ? static_cast<const char*>(nl) : end;
+}
+
+const char* trimLineEnd(const char* begin, const char* end) {
+    while (end > begin && (end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t')) {
+        --end;
+    }
+    return end;
+}
+
+const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) {
+        ++p;
+    }
+    return p;
+}
+
+long long countFields(const char* begin, const char* end) {
+    return static_cast<long long>(std::count(begin, end, ',')) + 1;
+}
+
+void recordError(ChunkResult& result, long long line, const std::string& message) {
+    result.errorCount++;
+    if (result.errors.size() < MapCsvImporter::MAX_REPORTED_ERRORS) {
+        result.errors.push_back({line, message});
+    }
+}
+
+// 解析一行数据到row中，成功返回true；base为该行首格在整个网格中的下标
+bool parseRow(const char* begin, const char* end, int cols, int* row, size_t base,
+              long long line, ChunkResult& result) {
+    const char* p = begin;
+
+    for (int c = 0; c < cols; ++c) {
+        p = skipSpaces(p, end);
+
+        // X表示墙壁，数值记为0
+        if (p < end && (*p == 'X' || *p == 'x')) {
+            row[c] = 0;
+            result.walls.push_back(base + c);
+            p = skipSpaces(p + 1, end);
+            if (c + 1 < cols) {
+                if (p >= end || *p != ',') {
+                    recordError(result, line, "第" + std::to_string(c + 1) + "列含有非法字符");
+                    return false;
+                }
+                ++p;
+            }
+            continue;
+        }
+
+        int value = 0;
+        auto parsed = std::from_chars(p, end, value);
+        if (parsed.ec == std::errc::result_out_of_range) {
+            recordError(result, line, "第" + std::to_string(c + 1) + "列数值超出范围");
+            return false;
+        }
+        if (parsed.ec != std::errc()) {
+            long long fields = countFields(begin, end);
+            if (fields != cols) {
+                recordError(result, line, "列数不匹配（期望" + std::to_string(cols) +
+                                              "，实际" + std::to_string(fields) + "）");
+            } else {
+                recordError(result, line, "第" + std::to_string(c + 1) + "列不是有效整数");
+            }
+            return false;
+        }
+
+        row[c] = value;
+        p = skipSpaces(parsed.ptr, end);
+
+        if (c + 1 < cols) {
+            if (p >= end || *p != ',') {
+                long long fields = countFields(begin, end);
+                if (fields != cols) {
+                    recordError(result, line, "列数不匹配（期望" + std::to_string(cols) +
+                                                  "，实际" + std::to_string(fields) + "）");
+                } else {
+                    recordError(result, line, "第" + std::to_string(c + 1) + "列含有非法字符");
+                }
+                return false;
+            }
+            ++p;
+        }
+    }
+
+    if (p != end) {
+        recordError(result, line, "列数不匹配（期望" + std::to_string(cols) +
+                                      "，实际" + std::to_string(countFields(begin, end)) + "）");
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+MapCsvImporter::MapCsvImporter(unsigned threadCount)
+    : m_threadCount(threadCount) {
+    if (m_threadCount == 0) {
+        m_threadCount = TaskPool::instance().workerCount() + 1;
+    }
+}
+
+unsigned MapCsvImporter::chooseThreadCount(size_t dataSize) const {
+    size_t byBytes = std::max<size_t>(1, dataSize / MIN_CHUNK_BYTES);
+    return static_cast<unsigned>(std::min<size_t>(m_threadCount, byBytes));
+}
+
+void MapCsvImporter::importFile(const QString& fileName, Dungeon& dungeon) {
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        throw MapImportException("无法打开文件: " + file.errorString().toStdString());
+    }
+
+    qint64 size = file.size();
+    if (size <= 0) {
+        throw MapImportException("文件为空");
+    }
+
+    // 整个文件只读映射，解析时不做额外复制
+    uchar* data = file.map(0, size);
+    if (!data) {
+        throw MapImportException("内存映射文件失败: " + file.errorString().toStdString());
+    }
+
+    try {
+        importBuffer(reinterpret_cast<const char*>(data), static_cast<size_t>(size), dungeon);
+    } catch (...) {
+        file.unmap(data);
+        throw;
+    }
+
+    file.unmap(data);
+}
+
+void MapCsvImporter::importBuffer(const char* data, size_t size, Dungeon& dungeon) {
+    TRACE_SCOPE("MapCsvImporter::importBuffer");
+    try {
+        const char* pos = data;
+        const char* end = data + size;
+
+        // 跳过UTF-8 BOM
+        if (size >= 3 && std::memcmp(data, "\xEF\xBB\xBF", 3) == 0) {
+            pos += 3;
+        }
+
+        // 跳过 # 说明行和空行，找到列标题行
+        long long lineNo = 0;
+        const char* headerBegin = nullptr;
+        const char* headerEnd = nullptr;
+
+        while (pos < end) {
+            const char* lineEnd = findLineEnd(pos, end);
+            const char* contentEnd = trimLineEnd(pos, lineEnd);
+            const char* contentBegin = skipSpaces(pos, contentEnd);
+            ++lineNo;
+
+            pos = (lineEnd < end) ? lineEnd + 1 : end;
+
+            if (contentBegin == contentEnd || *contentBegin == '#') {
+                continue;
+            }
+
+            headerBegin = contentBegin;
+            headerEnd = contentEnd;
+            break;
+        }
+
+        if (!headerBegin) {
+            throw MapImportException("文件中没有找到列标题行");
+        }
+
+        long long colCount = countFields(headerBegin, headerEnd);
+        if (colCount > INT_MAX) {
+            throw MapImportException("列数过多");
+        }
+        int cols = static_cast<int>(colCount);
+        long long firstDataLine = lineNo + 1;
+
+        // 数据区，去掉末尾的空行
+        const char* dataBegin = pos;
+        const char* dataEnd = end;
+        while (dataEnd > dataBegin && (dataEnd[-1] == '\n' || dataEnd[-1] == '\r' ||
+                                       dataEnd[-1] == ' ' || dataEnd[-1] == '\t')) {
+            --dataEnd;
+        }
+
+        if (dataBegin >= dataEnd) {
+            throw MapImportException("文件中没有地图数据行");
+        }
+
+        // 按行边界切块
+        size_t dataSize = static_cast<size_t>(dataEnd - dataBegin);
+        unsigned chunkCount = chooseThreadCount(dataSize);
+
+        std::vector<const char*> bounds;
+        bounds.push_back(dataBegin);
+        for (unsigned k = 1; k < chunkCount; ++k) {
+            const char* cut = dataBegin + dataSize / chunkCount * k;
+            if (cut <= bounds.back()) {
+                continue;
+            }
+            cut = findLineEnd(cut, dataEnd);
+            if (cut >= dataEnd) {
+                break;
+            }
+            bounds.push_back(cut + 1);
+        }
+        bounds.push_back(dataEnd);
+        chunkCount = static_cast<unsigned>(bounds.size() - 1);
+
+        std::vector<ChunkResult> results(chunkCount);
+
+        // 在各块上并行执行task（批量任务，普通优先级），任务中的异常在汇合后重新抛出
+        auto runParallel = [chunkCount](const std::function<void(unsigned)>& task) {
+            parallelFor(chunkCount, TaskPriority::Normal, [&task](size_t k) { task(static_cast<unsigned>(k)); });
+        };
+
+        // 第一遍：统计每块的行数（最后一块末尾没有换行符）
+        runParallel([&](unsigned k) {
+            long long newlines = std::count(bounds[k], bounds[k + 1], '\n');
+            results[k].lineCount = (k + 1 == chunkCount) ? newlines + 1 : newlines;
+        });
+
+        std::vector<long long> firstRow(chunkCount, 0);
+        long long totalRows = 0;
+        for (unsigned k = 0; k < chunkCount; ++k) {
+            firstRow[k] = totalRows;
+            totalRows += results[k].lineCount;
+        }
+
+        if (totalRows > INT_MAX) {
+            throw MapImportException("行数过多");
+        }
+        int rows = static_cast<int>(totalRows);
+
+        // 先检查尺寸，避免分配后才失败
+        Dungeon::validateLoadedMapSize(rows, cols);
+        std::vector<int> grid(static_cast<size_t>(rows) * cols);
+
+        // 第二遍：各线程解析自己的块，直接写入目标网格
+        runParallel([&](unsigned k) {
+            ChunkResult& result = results[k];
+            const char* p = bounds[k];
+            const char* chunkEnd = bounds[k + 1];
+            long long row = firstRow[k];
+
+            while (p < chunkEnd) {
+                const char* lineEnd = findLineEnd(p, chunkEnd);
+                const char* contentEnd = trimLineEnd(p, lineEnd);
+                long long line = firstDataLine + row;
+
+                int* target = grid.data() + static_cast<size_t>(row) * cols;
+
+                if (p == contentEnd) {
+                    recordError(result, line, "空行");
+                } else {
+                    parseRow(p, contentEnd, cols, target, static_cast<size_t>(row) * cols, line, result);
+                }
+
+                ++row;
+                p = lineEnd + 1;
+            }
+        });
+
+        // 汇总错误
+        long long errorCount = 0;
+        std::vector<MapImportError> errors;
+        for (const auto& result : results) {
+            errorCount += result.errorCount;
+            errors.insert(errors.end(), result.errors.begin(), result.errors.end());
+        }
+
+        if (errorCount > 0) {
+            std::sort(errors.begin(), errors.end(),
+                      [](const MapImportError& a, const MapImportError& b) { return a.line < b.line; });
+            if (errors.size() > MAX_REPORTED_ERRORS) {
+                errors.resize(MAX_REPORTED_ERRORS);
+            }
+
+            std::string message = "导入失败，共有" + std::to_string(errorCount) + "行格式错误:";
+            for (const auto& error : errors) {
+                message += "\n第" + std::to_string(error.line) + "行: " + error.message;
+            }
+            if (errorCount > static_cast<long long>(errors.size())) {
+                message += "\n...";
+            }
+
+            throw MapImportException(message, std::move(errors));
+        }
+
+        // 墙壁通常很少，各块只记下标，这里再串行合成位图
+        std::vector<uint64_t> wallBits;
+        for (const auto& result : results) {
+            if (!result.walls.empty() && wallBits.empty()) {
+                wallBits.assign(WallMask::wordCount(grid.size()), 0);
+            }
+            for (size_t k : result.walls) {
+                WallMask::setWall(wallBits.data(), k, true);
+            }
+        }
+
+        dungeon.loadMap(rows, cols, std::move(grid), std::move(wallBits));
+
+        LOG_INFO("CSV imported: %d x %d using %u threads", rows, cols, chunkCount);
+
+    } catch (const MapImportException& e) {
+        throw;
+    } catch (const DungeonException& e) {
+        throw MapImportException(e.what());
+    } catch (const std::bad_alloc& e) {
+        throw MapImportException("内存分配失败，地图过大");
+    } catch (const std::exception& e) {
+        throw MapImportException(std::string("导入地图时发生未知错误: ") + e.what());
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef MAPIMPORTER_H
+#define MAPIMPORTER_H
+
+#include <QString>
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include "dungeon.h"
+
+// 导入过程中发现的单行错误
+struct MapImportError {
+    long long line;         // 文件中的行号（从1开始）
+    std::string message;    // 错误描述
+};
+
+class MapImportException : public std::runtime_error {
+public:
+    MapImportException(const std::string& message, std::vector<MapImportError> errors = {})
+        : std::runtime_error(message), m_errors(std::move(errors)) {}
+
+    const std::vector<MapImportError>& errors() const { return m_errors; }
+
+private:
+    std::vector<MapImportError> m_errors;
+};
+
+// CSV地图导入器，读取 MapTableWindow::exportToFile() 写出的格式：
+// 若干 # 开头的说明行和空行，一行列标题，之后每行一条地图数据，X表示墙壁。
+// 文件以内存映射方式读取，按行边界切块后在任务池中并行解析（threadCount为0时按任务池的线程数）。
+class MapCsvImporter {
+public:
+    explicit MapCsvImporter(unsigned threadCount = 0);
+
+    // 导入文件并载入到dungeon，出错时抛出MapImportException
+    void importFile(const QString& fileName, Dungeon& dungeon);
+
+    // 解析内存中的CSV内容（importFile内部使用，也可用于已映射的数据）
+    void importBuffer(const char* data, size_t size, Dungeon& dungeon);
+
+    // 最多报告的错误行数
+    static const size_t MAX_REPORTED_ERRORS = 20;
+
+private:
+    unsigned m_threadCount;
+
+    unsigned chooseThreadCount(size_t dataSize) const;
+};
+
+#endif // MAPIMPORTER_H
@@ -1,15 +1,25 @@
 #include "maptablewindow.h"
+#include "dungeonfile.h"
+#include "dungeonmapmodel.h"
+#include "logger.h"
+#include "toppaths.h"
+#include "healthquery.h"
+#include "tracer.h"
 #include <QApplication>
 #include <QScreen>
 #include <QMessageBox>
 #include <QFileDialog>
+#include <QInputDialog>
 #include <QTextStream>
-
-MapTableWindow::MapTableWindow(const Dungeon* dungeon, QWidget *parent)
-    : QDialog(parent), m_dungeon(dungeon), m_minHealth(0) {
-    if (m_dungeon) {
-        m_minHealth = const_cast<Dungeon*>(m_dungeon)->calculateMinHealth();
-        m_optimalPath = const_cast<Dungeon*>(m_dungeon)->getOptimalPath();  // 新增：获取最优路径
+#include <algorithm>
+#include <climits>
+
+MapTableWindow::MapTableWindow(DungeonSnapshotPtr snapshot, QWidget *parent)
+    : QDialog(parent), m_snapshot(std::move(snapshot)), m_minHealth(0), m_heatMap(false) {
+    if (m_snapshot) {
+        // 快照中已带有求解结果，这里无需再求解
+        m_minHealth = m_snapshot->minHealth;
+        m_optimalPath = m_snapshot->path;
     }
     setupUI();
     populateTable();
@@ -17,7 +27,7 @@ MapTableWindow::MapTableWindow(const Dungeon* dungeon, QWidget *parent)
 }
 
 void MapTableWindow::setupUI() {
-    setWindowTitle(QString("地图表格 - %1×%2").arg(m_dungeon->getRows()).arg(m_dungeon->getCols()));
+    setWindowTitle(QString("地图表格 - %1×%2").arg(m_snapshot->rows).arg(m_snapshot->cols));
     setModal(false); // 允许同时打开多个窗口
 
     // 设置窗口大小
@@ -36,16 +46,23 @@ void MapTableWindow::setupUI() {
 
     // 信息标签
     m_infoLabel = new QLabel();
-    m_infoLabel->setText(QString("地图尺寸: %1×%2 | 最小初始健康值: %3")
-                             .arg(m_dungeon->getRows())
-                             .arg(m_dungeon->getCols())
-                             .arg(m_minHealth));
+    m_infoText = QString("地图尺寸: %1×%2 | 最小初始健康值: %3")
+                     .arg(m_snapshot->rows)
+                     .arg(m_snapshot->cols)
+                     .arg(m_snapshot->isSolvable() ? QString::number(m_minHealth) : QString("无可行路线"));
+    if (m_snapshot->healthCap > 0) {
+        m_infoText += QString(" | 健康上限: %1").arg(m_snapshot->healthCap);
+    }
+    if (m_snapshot->corridor) {
+        m_infoText += QString(" | 最优路径: %1 条（dp紧路径）").arg(QString::fromStdString(m_snapshot->corridor->pathCountText()));
+    }
+    m_infoLabel->setText(m_infoText);
     m_infoLabel->setStyleSheet("font-size: 16px; font-weight: bold; color: #2C3E50; padding: 10px;");
     m_infoLabel->setAlignment(Qt::AlignCenter);
     mainLayout->addWidget(m_infoLabel);
 
     // 创建表格
-    m_tableWidget = new QTableWidget(m_dungeon->getRows(), m_dungeon->getCols(), this);
+    m_tableWidget = new QTableWidget(m_snapshot->rows, m_snapshot->cols, this);
     m_tableWidget->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
     mainLayout->addWidget(m_tableWidget, 1);
 
@@ -56,6 +73,25 @@ void MapTableWindow::setupUI() {
     m_exportBtn->setStyleSheet("background-color: #3498DB; color: white; padding: 8px 16px; border: none; border-radius: 4px; font-size: 14px;");
     buttonLayout->addWidget(m_exportBtn);
 
+    m_exportBinaryBtn = new QPushButton("导出为二进制");
+    m_exportBinaryBtn->setStyleSheet("background-color: #1ABC9C; color: white; padding: 8px 16px; border: none; border-radius: 4px; font-size: 14px;");
+    buttonLayout->addWidget(m_exportBinaryBtn);
+
+    m_heatMapBtn = new QPushButton("余量热力图");
+    m_heatMapBtn->setCheckable(true);
+    m_heatMapBtn->setEnabled(m_snapshot->forward != nullptr);
+    m_heatMapBtn->setStyleSheet("QPushButton { background-color: #9B59B6; color: white; padding: 8px 16px; border: none; border-radius: 4px; font-size: 14px; }"
+                                "QPushButton:checked { background-color: #6C3483; }");
+    buttonLayout->addWidget(m_heatMapBtn);
+
+    m_topPathsBtn = new QPushButton("前K条路径");
+    m_topPathsBtn->setStyleSheet("background-color: #F39C12; color: white; padding: 8px 16px; border: none; border-radius: 4px; font-size: 14px;");
+    buttonLayout->addWidget(m_topPathsBtn);
+    if (!m_snapshot->isClassic()) {
+        m_topPathsBtn->setEnabled(false);
+        m_topPathsBtn->setToolTip("自定义路线和健康上限模式暂不支持");
+    }
+
     buttonLayout->addStretch();
 
     m_closeBtn = new QPushButton("关闭");
@@ -66,6 +102,10 @@ void MapTableWindow::setupUI() {
 
     // 连接信号
     connect(m_exportBtn, &QPushButton::clicked, this, &MapTableWindow::exportToFile);
+    connect(m_exportBinaryBtn, &QPushButton::clicked, this, &MapTableWindow::exportToBinaryFile);
+    connect(m_heatMapBtn, &QPushButton::toggled, this, &MapTableWindow::toggleHeatMap);
+    connect(m_topPathsBtn, &QPushButton::clicked, this, &MapTableWindow::showTopPaths);
+    connect(m_tableWidget, &QTableWidget::itemSelectionChanged, this, &MapTableWindow::updateSelectionQuery);
     connect(m_closeBtn, &QPushButton::clicked, this, &QDialog::accept);
 }
 
@@ -113,22 +153,23 @@ void MapTableWindow::setupUI() {
 // }
 
 void MapTableWindow::populateTable() {
-    if (!m_dungeon) return;
-
-    const auto& map = m_dungeon->getMap();
+    if (!m_snapshot) return;
+    TRACE_SCOPE("MapTableWindow::populateTable");
 
     // 设置行列标题
-    for (int i = 0; i < m_dungeon->getRows(); ++i) {
+    for (int i = 0; i < m_snapshot->rows; ++i) {
         m_tableWidget->setVerticalHeaderItem(i, new QTableWidgetItem(QString::number(i)));
     }
-    for (int j = 0; j < m_dungeon->getCols(); ++j) {
+    for (int j = 0; j < m_snapshot->cols; ++j) {
         m_tableWidget->setHorizontalHeaderItem(j, new QTableWidgetItem(QString::number(j)));
     }
 
     // 填充数据
-    for (int i = 0; i < m_dungeon->getRows(); ++i) {
-        for (int j = 0; j < m_dungeon->getCols(); ++j) {
-            QTableWidgetItem* item = new QTableWidgetItem(QString::number(map[i][j]));
+    for (int i = 0; i < m_snapshot->rows; ++i) {
+        for (int j = 0; j < m_snapshot->cols; ++j) {
+            int value = m_snapshot->getCell(i, j);
+            bool wall = m_snapshot->isWall(i, j);
+            QTableWidgetItem* item = new QTableWidgetItem(wall ? QString("墙") : QString::number(value));
 
             // 设置文本居中
             item->setTextAlignment(Qt::AlignCenter);
@@ -139,26 +180,25 @@ void MapTableWindow::populateTable() {
             font.setPointSize(10);
             item->setFont(font);
 
-            // 检查是否在最优路径中
-            bool inOptimalPath = false;
-            for (const auto& point : m_optimalPath) {
-                if (point.x() == j && point.y() == i) {
-                    inOptimalPath = true;
-                    break;
-                }
-            }
+            item->setForeground(QBrush(Qt::white));
 
-            // 设置颜色
-            if (inOptimalPath) {
-                item->setBackground(QBrush(QColor("#F39C12")));  // 新增：橙色表示最优路径
-            } else {
-                item->setBackground(QBrush(getCellColor(map[i][j])));
+            if (wall) {
+                item->setToolTip("墙壁，不能进入");
+            } else if (m_snapshot->forward) {
+                int slack = m_snapshot->getSlack(i, j);
+                item->setToolTip(QString("所需健康值: %1\n最大到达健康值: %2\n余量: %3")
+                                     .arg(m_snapshot->getDpValue(i, j) == INT_MAX ? QString("不在路线上")
+                                                                                  : QString::number(m_snapshot->getDpValue(i, j)))
+                                     .arg(m_snapshot->getForwardValue(i, j))
+                                     .arg(slack >= 0 ? QString::number(slack) : QString("无存活路线")));
             }
-            item->setForeground(QBrush(Qt::white));
 
-            // 起点和终点特殊标记
-            if ((i == 0 && j == 0) || (i == m_dungeon->getRows()-1 && j == m_dungeon->getCols()-1)) {
-                // 加粗边框表示起点和终点
+            // 起点、路点和公主格子特殊标记
+            const RoutePlan& route = m_snapshot->route;
+            QPoint cell(j, i);
+            if (cell == route.start || route.isTarget(cell) ||
+                std::find(route.waypoints.begin(), route.waypoints.end(), cell) != route.waypoints.end()) {
+                // 加大字号表示路线上的关键格子
                 font.setPointSize(12);
                 item->setFont(font);
             }
@@ -166,13 +206,107 @@ void MapTableWindow::populateTable() {
             m_tableWidget->setItem(i, j, item);
         }
     }
+
+    applyCellColors();
+}
+
+void MapTableWindow::applyCellColors() {
+    TRACE_SCOPE("MapTableWindow::applyCellColors");
+    std::vector<char> inOptimalPath(static_cast<size_t>(m_snapshot->rows) * m_snapshot->cols, 0);
+    for (const auto& point : m_optimalPath) {
+        inOptimalPath[m_snapshot->cellIndex(point.y(), point.x())] = 1;
+    }
+
+    for (int i = 0; i < m_snapshot->rows; ++i) {
+        for (int j = 0; j < m_snapshot->cols; ++j) {
+            QTableWidgetItem* item = m_tableWidget->item(i, j);
+            if (!item) continue;
+
+            if (m_snapshot->isWall(i, j)) {
+                item->setBackground(QBrush(QColor("#2C3E50")));  // 深色表示墙壁
+            } else if (inOptimalPath[m_snapshot->cellIndex(i, j)]) {
+                item->setBackground(QBrush(QColor("#F39C12")));  // 橙色表示最优路径
+            } else if (m_heatMap) {
+                item->setBackground(QBrush(DungeonMapModel::heatMapColor(*m_snapshot, i, j)));
+            } else {
+                item->setBackground(QBrush(getCellColor(m_snapshot->getCell(i, j))));
+            }
+        }
+    }
+}
+
+void MapTableWindow::toggleHeatMap(bool enabled) {
+    m_heatMap = enabled;
+    applyCellColors();
+}
+
+void MapTableWindow::showTopPaths() {
+    bool ok = false;
+    int k = QInputDialog::getInt(this, "前K条路径", "路径条数K:", 10, 1, 10000, 1, &ok);
+    if (!ok) return;
+
+    std::vector<RankedPath> paths;
+    try {
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        paths = enumerateTopPaths(m_snapshot->map.get(), m_snapshot->dp.get(),
+                                  m_snapshot->rows, m_snapshot->cols, k);
+        QApplication::restoreOverrideCursor();
+    } catch (const std::exception& e) {
+        QApplication::restoreOverrideCursor();
+        QMessageBox::warning(this, "枚举失败", QString::fromStdString(e.what()));
+        return;
+    }
+
+    if (paths.empty()) return;
+
+    // 与最优健康值相同的路径越多，地图越不存在唯一的"必经路线"
+    int best = paths.front().requiredHealth;
+    int tied = static_cast<int>(std::count_if(paths.begin(), paths.end(),
+                                              [best](const RankedPath& p) { return p.requiredHealth == best; }));
+
+    QString text = QString("共找到 %1 条路径，其中 %2 条与最优相同（所需健康值 %3）\n第 %1 条所需健康值: %4\n\n")
+                       .arg(paths.size()).arg(tied).arg(best).arg(paths.back().requiredHealth);
+
+    const size_t shown = std::min<size_t>(paths.size(), 20);
+    for (size_t i = 0; i < shown; ++i) {
+        text += QString("#%1: %2\n").arg(i + 1).arg(paths[i].requiredHealth);
+    }
+    if (shown < paths.size()) {
+        text += "...";
+    }
+
+    QMessageBox::information(this, "前K条路径", text);
+}
+
+void MapTableWindow::updateSelectionQuery() {
+    QList<QTableWidgetSelectionRange> ranges = m_tableWidget->selectedRanges();
+    if (ranges.size() != 1 || ranges.front().rowCount() * ranges.front().columnCount() < 2) {
+        m_infoLabel->setText(m_infoText);
+        return;
+    }
+
+    // 框选区域的左上角到右下角
+    const QTableWidgetSelectionRange& range = ranges.front();
+    HealthQuery query{QPoint(range.leftColumn(), range.topRow()), QPoint(range.rightColumn(), range.bottomRow())};
+
+    try {
+        std::vector<int> result = HealthQueryBatch(1).run(*m_snapshot, {query});
+        m_infoLabel->setText(QString("%1 | (%2,%3)→(%4,%5) 所需健康值: %6")
+                                 .arg(m_infoText)
+                                 .arg(range.topRow()).arg(range.leftColumn())
+                                 .arg(range.bottomRow()).arg(range.rightColumn())
+                                 .arg(result.front() == INT_MAX ? QString("不可行") : QString::number(result.front())));
+    } catch (const std::exception& e) {
+        m_infoLabel->setText(m_infoText);
+        LOG_WARNING("Selection query failed: %s", e.what());
+    }
 }
 
 void MapTableWindow::setupTableStyle() {
     // 设置表格样式
     m_tableWidget->setAlternatingRowColors(false);
     m_tableWidget->setSelectionBehavior(QAbstractItemView::SelectItems);
-    m_tableWidget->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_tableWidget->setSelectionMode(QAbstractItemView::ContiguousSelection);  // 框选A→B区域
 
     // 设置表格网格
     m_tableWidget->setShowGrid(true);
@@ -181,21 +315,21 @@ void MapTableWindow::setupTableStyle() {
 
     // 自适应列宽
     int availableWidth = width() - 100; // 减去边距和滚动条
-    int cellWidth = availableWidth / m_dungeon->getCols();
+    int cellWidth = availableWidth / m_snapshot->cols;
     cellWidth = qMax(cellWidth, 40); // 最小宽度40
     cellWidth = qMin(cellWidth, 80); // 最大宽度80
 
-    for (int j = 0; j < m_dungeon->getCols(); ++j) {
+    for (int j = 0; j < m_snapshot->cols; ++j) {
         m_tableWidget->setColumnWidth(j, cellWidth);
     }
 
     // 自适应行高
     int availableHeight = height() - 150; // 减去标签和按钮的高度
-    int cellHeight = availableHeight / m_dungeon->getRows();
+    int cellHeight = availableHeight / m_snapshot->rows;
     cellHeight = qMax(cellHeight, 30); // 最小高度30
     cellHeight = qMin(cellHeight, 60); // 最大高度60
 
-    for (int i = 0; i < m_dungeon->getRows(); ++i) {
+    for (int i = 0; i < m_snapshot->rows; ++i) {
         m_tableWidget->setRowHeight(i, cellHeight);
     }
 
@@ -217,7 +351,7 @@ QColor MapTableWindow::getCellColor(int value) const {
 void MapTableWindow::exportToFile() {
     QString fileName = QFileDialog::getSaveFileName(this,
                                                     "导出地图数据",
-                                                    QString("map_%1x%2.csv").arg(m_dungeon->getRows()).arg(m_dungeon->getCols()),
+                                                    QString("map_%1x%2.csv").arg(m_snapshot->rows).arg(m_snapshot->cols),
                                                     "CSV Files (*.csv)");
 
     if (fileName.isEmpty()) return;
@@ -232,24 +366,46 @@ void MapTableWindow::exportToFile() {
 
     // 写入标题信息
     out << "# 地图数据\n";
-    out << "# 尺寸: " << m_dungeon->getRows() << "×" << m_dungeon->getCols() << "\n";
-    out << "# 最小初始健康值: " << m_minHealth << "\n";
-    out << "# 起点: (0,0), 终点: (" << (m_dungeon->getRows()-1) << "," << (m_dungeon->getCols()-1) << ")\n";
+    out << "# 尺寸: " << m_snapshot->rows << "×" << m_snapshot->cols << "\n";
+    if (m_snapshot->isSolvable()) {
+        out << "# 最小初始健康值: " << m_minHealth << "\n";
+    } else {
+        out << "# 最小初始健康值: 无可行路线\n";
+    }
+    if (m_snapshot->healthCap > 0) {
+        out << "# 健康上限: " << m_snapshot->healthCap << "\n";
+    }
+    const RoutePlan& route = m_snapshot->route;
+    out << "# 起点: (" << route.start.y() << "," << route.start.x() << ")";
+    for (const QPoint& w : route.waypoints) {
+        out << ", 路点: (" << w.y() << "," << w.x() << ")";
+    }
+    for (const QPoint& t : route.targets) {
+        out << ", 终点: (" << t.y() << "," << t.x() << ")";
+    }
+    out << "\n";
+    if (WallMask::any(m_snapshot->wallBits(), static_cast<size_t>(m_snapshot->rows) * m_snapshot->cols)) {
+        out << "# X表示墙壁\n";
+    }
     out << "\n";
 
     // 写入列标题
-    for (int j = 0; j < m_dungeon->getCols(); ++j) {
+    for (int j = 0; j < m_snapshot->cols; ++j) {
         if (j > 0) out << ",";
         out << j;
     }
     out << "\n";
 
     // 写入数据
-    const auto& map = m_dungeon->getMap();
-    for (int i = 0; i < m_dungeon->getRows(); ++i) {
-        for (int j = 0; j < m_dungeon->getCols(); ++j) {
+    for (int i = 0; i < m_snapshot->rows; ++i) {
+        const int* row = m_snapshot->getMapRow(i);
+        for (int j = 0; j < m_snapshot->cols; ++j) {
             if (j > 0) out << ",";
-            out << map[i][j];
+            if (m_snapshot->isWall(i, j)) {
+                out << "X";
+            } else {
+                out << row[j];
+            }
         }
         out << "\n";
     }
@@ -257,3 +413,22 @@ void MapTableWindow::exportToFile() {
     file.close();
     QMessageBox::information(this, "导出成功", QString("地图数据已导出到:\n%1").arg(fileName));
 }
+
+void MapTableWindow::exportToBinaryFile() {
+    QString fileName = QFileDialog::getSaveFileName(this,
+                                                    "导出二进制地图",
+                                                    QString("map_%1x%2.dgn").arg(m_snapshot->rows).arg(m_snapshot->cols),
+                                                    "Dungeon Files (*.dgn)");
+
+    if (fileName.isEmpty()) return;
+
+    try {
+        // 4字节格子，再次打开时可直接映射使用
+        DungeonFile::save(fileName, *m_snapshot);
+    } catch (const std::exception& e) {
+        QMessageBox::warning(this, "导出失败", QString::fromStdString(e.what()));
+        return;
+    }
+
+    QMessageBox::information(this, "导出成功", QString("地图数据已导出到:\n%1").arg(fileName));
+}
@@ -9,29 +9,39 @@
 #include <QPushButton>
 #include <QHeaderView>
 #include <QFont>
-#include "dungeon.h"
+#include "dungeonsnapshot.h"
 
 class MapTableWindow : public QDialog {
     Q_OBJECT
 
 public:
-    explicit MapTableWindow(const Dungeon* dungeon, QWidget *parent = nullptr);
+    explicit MapTableWindow(DungeonSnapshotPtr snapshot, QWidget *parent = nullptr);
 
 private slots:
     void exportToFile();
+    void exportToBinaryFile();
+    void toggleHeatMap(bool enabled);
+    void showTopPaths();
+    void updateSelectionQuery();
 
 private:
     void setupUI();
     void populateTable();
     void setupTableStyle();
+    void applyCellColors();
     QColor getCellColor(int value) const;
 
-    const Dungeon* m_dungeon;
+    DungeonSnapshotPtr m_snapshot;
     QTableWidget* m_tableWidget;
     QLabel* m_infoLabel;
     QPushButton* m_exportBtn;
+    QPushButton* m_exportBinaryBtn;
+    QPushButton* m_heatMapBtn;
+    QPushButton* m_topPathsBtn;
     QPushButton* m_closeBtn;
     int m_minHealth;
+    QString m_infoText;
+    bool m_heatMap;
 
     std::vector<QPoint> m_optimalPath;
 };
@@ -0,0 +1,183 @@
+#include "optimalcorridor.h"
+#include "dungeon.h"
+#include "healthstep.h"
+#include "logger.h"
+#include "wallmask.h"
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <utility>
+
+namespace {
+
+// 从值为cell、dp为need的格子走到dp为next的格子是否保持dp等式，墙壁（INT_MAX）不算
+bool isTightStep(int cell, int need, int next) {
+    if (next == INT_MAX) {
+        return false;
+    }
+    long long required = static_cast<long long>(next) - cell;
+    return std::max(1LL, required) == need;
+}
+
+uint64_t saturatingAdd(uint64_t a, uint64_t b, bool& saturated) {
+    uint64_t sum = a + b;
+    if (sum < a) {
+        saturated = true;
+        return UINT64_MAX;
+    }
+    return sum;
+}
+
+} // namespace
+
+std::string OptimalCorridor::pathCountText() const {
+    return "≥" + std::to_string(pathCount);
+}
+
+OptimalCorridor computeOptimalCorridor(const int* map, const int* dp, int rows, int cols, const uint64_t* walls, int cap) {
+    OptimalCorridor corridor;
+    corridor.rows = rows;
+    corridor.cols = cols;
+    if (!map || !dp || rows <= 0 || cols <= 0 || dp[0] == INT_MAX) {
+        return corridor;
+    }
+
+    size_t total = static_cast<size_t>(rows) * cols;
+    corridor.bits.assign((total + 63) / 64, 0);
+
+    // arrive[j]为以dp[0][0]出发、到达(i,j)时（进入前）最好的健康值，0表示到不了或已倒下；
+    // count[j]为从起点沿dp紧步到达(i,j)的路径数
+    std::vector<int> arriveAbove(cols, 0);
+    std::vector<int> arrive(cols, 0);
+    std::vector<uint64_t> above(cols, 0);
+    std::vector<uint64_t> current(cols, 0);
+
+    for (int i = 0; i < rows; ++i) {
+        const int* mapRow = map + static_cast<size_t>(i) * cols;
+        const int* dpRow = dp + static_cast<size_t>(i) * cols;
+        const int* mapAbove = mapRow - cols;
+        const int* dpAbove = dpRow - cols;
+        size_t base = static_cast<size_t>(i) * cols;
+
+        for (int j = 0; j < cols; ++j) {
+            int health = 0;
+            uint64_t count = 0;
+            if (i == 0 && j == 0) {
+                health = std::min(dp[0], cap);
+                count = 1;
+            }
+            if (i > 0) {
+                health = std::max(health, leaveHealth(arriveAbove[j], mapAbove[j], cap));
+                if (above[j] && isTightStep(mapAbove[j], dpAbove[j], dpRow[j])) {
+                    count = saturatingAdd(count, above[j], corridor.saturated);
+                }
+            }
+            if (j > 0) {
+                health = std::max(health, leaveHealth(arrive[j-1], mapRow[j-1], cap));
+                if (current[j-1] && isTightStep(mapRow[j-1], dpRow[j-1], dpRow[j])) {
+                    count = saturatingAdd(count, current[j-1], corridor.saturated);
+                }
+            }
+
+            health = WallMask::masked(health, WallMask::isWall(walls, base + j), 0);
+            arrive[j] = health;
+            current[j] = count;
+            if (health > 0 && dpRow[j] != INT_MAX && health >= dpRow[j]) {
+                size_t k = base + j;
+                corridor.bits[k >> 6] |= uint64_t(1) << (k & 63);
+                corridor.cellCount++;
+            }
+        }
+
+        std::swap(arriveAbove, arrive);
+        std::swap(above, current);
+    }
+
+    // 交换后above为最后一行
+    corridor.pathCount = above[cols-1];
+    return corridor;
+}
+
+size_t crossCheckOptimalCorridor(int maps, uint64_t seed) {
+    std::mt19937_64 random(seed);
+    size_t failures = 0;
+
+    for (int m = 0; m < maps; ++m) {
+        int rows = 1 + static_cast<int>(random() % 6);
+        int cols = 1 + static_cast<int>(random() % 6);
+        size_t total = static_cast<size_t>(rows) * cols;
+        std::vector<int> cells(total);
+        for (int& cell : cells) {
+            cell = static_cast<int>(random() % 21) - 10;
+        }
+        std::vector<uint64_t> walls;
+        if (m % 3 == 0) {
+            walls.assign(WallMask::wordCount(total), 0);
+            for (size_t k = 1; k + 1 < total; ++k) {
+                WallMask::setWall(walls.data(), k, random() % 6 == 0);
+            }
+        }
+        std::vector<int> map = cells;
+        std::vector<uint64_t> wallCopy = walls;
+
+        Dungeon dungeon;
+        dungeon.loadMap(rows, cols, std::move(cells), std::move(walls));
+        int minHealth = dungeon.calculateMinHealth();
+        std::vector<int> dp(total);
+        for (int i = 0; i < rows; ++i) {
+            std::copy(dungeon.getDpRow(i), dungeon.getDpRow(i) + cols, dp.begin() + static_cast<size_t>(i) * cols);
+        }
+        const uint64_t* wallBits = wallCopy.empty() ? nullptr : wallCopy.data();
+        OptimalCorridor corridor = computeOptimalCorridor(map.data(), dp.data(), rows, cols, wallBits);
+
+        // 枚举全部右下路径：第s步的位为1表示向下
+        int steps = rows + cols - 2;
+        std::vector<uint64_t> expected(WallMask::wordCount(total), 0);
+        uint64_t optimalPaths = 0;
+        uint64_t tightPaths = 0;
+        for (uint32_t moves = 0; moves < (1u << steps); ++moves) {
+            if (__builtin_popcount(moves) != rows - 1) {
+                continue;
+            }
+            std::vector<size_t> path(1, 0);
+            int i = 0;
+            int j = 0;
+            for (int s = 0; s < steps; ++s) {
+                ((moves >> s) & 1) ? ++i : ++j;
+                path.push_back(static_cast<size_t>(i) * cols + j);
+            }
+
+            long long sum = 0;
+            long long lowest = 0;
+            bool blocked = false;
+            bool tight = true;
+            for (size_t p = 0; p < path.size(); ++p) {
+                blocked = blocked || WallMask::isWall(wallBits, path[p]);
+                sum += map[path[p]];
+                lowest = std::min(lowest, sum);
+                if (p + 1 < path.size() && !isTightStep(map[path[p]], dp[path[p]], dp[path[p+1]])) {
+                    tight = false;
+                }
+            }
+            if (blocked || 1 - lowest != minHealth) {
+                continue;
+            }
+            ++optimalPaths;
+            tightPaths += tight;
+            for (size_t k : path) {
+                WallMask::setWall(expected.data(), k, true);
+            }
+        }
+
+        bool ok = minHealth == INT_MAX ? corridor.cellCount == 0
+                                       : corridor.bits == expected && corridor.pathCount == tightPaths &&
+                                         corridor.pathCount <= optimalPaths;
+        if (!ok) {
+            ++failures;
+            LOG_WARNING("Corridor cross-check failed on %d x %d map %d: %llu tight of %llu optimal paths, reported %llu",
+                        rows, cols, m, static_cast<unsigned long long>(tightPaths),
+                        static_cast<unsigned long long>(optimalPaths), static_cast<unsigned long long>(corridor.pathCount));
+        }
+    }
+    return failures;
+}
@@ -0,0 +1,45 @@
+#ifndef OPTIMALCORRIDOR_H
+#define OPTIMALCORRIDOR_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 最优走廊：所有只需最小初始健康值的路径经过的格子（位图），以及这类路径条数的下界。
+//
+// 走廊由一次以最小健康值dp[0][0]出发的正向DP得出：格子在走廊上当且仅当最好的到达健康值不小于
+// 从该格出发所需的dp值。健康值越多越不吃亏（有上限时也一样），所以这个判定是精确的。
+// 需要最小健康值的路径不一定每一步都保持dp等式 max(1, dp[下一格] - map[当前格]) == dp[当前格]，
+// 精确计数这类路径无法在O(格子数)内完成，所以pathCount只统计每步保持dp等式的路径（dp紧路径），
+// 它们都需要最小健康值，pathCount是下界；getOptimalPath()在任意平局规则下返回的路径都属于此类。
+struct OptimalCorridor {
+    int rows = 0;
+    int cols = 0;
+    std::vector<uint64_t> bits;     // 每格1位，行优先
+    size_t cellCount = 0;           // 走廊中的格子数
+    uint64_t pathCount = 0;         // dp紧路径的条数（最优路径条数的下界），超出64位时饱和为UINT64_MAX
+    bool saturated = false;         // pathCount是否已饱和
+
+    bool contains(int row, int col) const {
+        size_t k = static_cast<size_t>(row) * cols + col;
+        return (bits[k >> 6] >> (k & 63)) & 1;
+    }
+
+    // 路径条数的文字形式，以"≥"标出是下界
+    std::string pathCountText() const;
+};
+
+// 由地图和已求解的DP表计算最优走廊。只做一次自上而下的扫描，同时推进正向DP（判定走廊）
+// 和dp紧步的路径计数，两者都只保留两行，不枚举路径，时间O(rows*cols)，额外内存为位图加O(cols)。
+// walls为空表示没有墙壁，cap为健康上限（INT_MAX表示不限），须与求解dp时相同
+OptimalCorridor computeOptimalCorridor(const int* map, const int* dp, int rows, int cols,
+                                       const uint64_t* walls = nullptr, int cap = INT_MAX);
+
+// 交叉检查：在maps张随机小地图（最大6×6，部分带墙壁）上枚举全部路径，
+// 核对走廊与需要最小健康值的路径经过的格子一致、pathCount等于dp紧路径数且不超过最优路径数。
+// 返回不一致的地图数
+size_t crossCheckOptimalCorridor(int maps, uint64_t seed = 1);
+
+#endif // OPTIMALCORRIDOR_H
@@ -0,0 +1,41 @@
+#include "perfmetrics.h"
+#include "tracer.h"
+
+PerfMetrics& PerfMetrics::instance() {
+    static PerfMetrics metrics;
+    return metrics;
+}
+
+uint64_t PerfMetrics::now() {
+    return Tracer::now();
+}
+
+void PerfMetrics::recordFrame(uint64_t begin, uint64_t end) {
+    m_framePaintNs.store(end - begin, std::memory_order_relaxed);
+    m_frameDataCalls.store(m_dataCalls.exchange(0, std::memory_order_relaxed), std::memory_order_relaxed);
+    m_frames.fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t keyAt = m_keyPressAt.exchange(0, std::memory_order_relaxed);
+    if (keyAt != 0 && end > keyAt) {
+        m_keyLatencyNs.store(end - keyAt, std::memory_order_relaxed);
+    }
+}
+
+PerfSample PerfMetrics::sample() const {
+    PerfSample s;
+    s.generateNs = m_generateNs.load(std::memory_order_relaxed);
+    s.generateAttempts = m_generateAttempts.load(std::memory_order_relaxed);
+    s.solveNs = m_solveNs.load(std::memory_order_relaxed);
+    s.solveCells = m_solveCells.load(std::memory_order_relaxed);
+    s.pathLength = m_pathLength.load(std::memory_order_relaxed);
+    s.frameDataCalls = m_frameDataCalls.load(std::memory_order_relaxed);
+    s.framePaintNs = m_framePaintNs.load(std::memory_order_relaxed);
+    s.frames = m_frames.load(std::memory_order_relaxed);
+    s.keyLatencyNs = m_keyLatencyNs.load(std::memory_order_relaxed);
+    s.mapBytes = m_mapBytes.load(std::memory_order_relaxed);
+    s.dpBytes = m_dpBytes.load(std::memory_order_relaxed);
+    s.overlayBytes = m_overlayBytes.load(std::memory_order_relaxed);
+    s.arenaBytes = m_arenaBytes.load(std::memory_order_relaxed);
+    s.arenaPeakBytes = m_arenaPeakBytes.load(std::memory_order_relaxed);
+    return s;
+}
@@ -0,0 +1,87 @@
+#ifndef PERFMETRICS_H
+#define PERFMETRICS_H
+
+#include <atomic>
+#include <cstdint>
+
+// 性能面板读取的一组数值（某一时刻的拷贝）
+struct PerfSample {
+    uint64_t generateNs = 0;        // 最近一次生成地图的耗时
+    uint32_t generateAttempts = 0;  // 最近一次生成的尝试次数
+    uint64_t solveNs = 0;           // 最近一次求解的耗时
+    uint64_t solveCells = 0;        // 最近一次求解的格子数
+    uint64_t pathLength = 0;        // 最近一次回溯的路径长度
+    uint64_t frameDataCalls = 0;    // 上一帧中模型data()的调用次数
+    uint64_t framePaintNs = 0;      // 上一帧的绘制耗时
+    uint64_t frames = 0;            // 累计帧数
+    uint64_t keyLatencyNs = 0;      // 最近一次按键到重绘完成的延迟
+    uint64_t mapBytes = 0;          // 地图数据
+    uint64_t dpBytes = 0;           // DP表
+    uint64_t overlayBytes = 0;      // 正向表、最优走廊和墙壁位图
+    uint64_t arenaBytes = 0;        // 缓冲区池当前占用
+    uint64_t arenaPeakBytes = 0;    // 缓冲区池峰值
+
+    double cellsPerSecond() const { return solveNs ? solveCells * 1e9 / solveNs : 0.0; }
+};
+
+// 运行时性能计数：核心和视图在各自的线程里用relaxed原子写入，界面定时器取样显示。
+// 写入方只做一次原子存储或自增，不加锁也不分配内存，面板关闭时没有任何额外开销。
+class PerfMetrics {
+public:
+    static PerfMetrics& instance();
+
+    // 与Tracer::now()相同的时间基准（纳秒）
+    static uint64_t now();
+
+    void recordGenerate(uint64_t ns, uint32_t attempts) {
+        m_generateNs.store(ns, std::memory_order_relaxed);
+        m_generateAttempts.store(attempts, std::memory_order_relaxed);
+    }
+    void recordSolve(uint64_t ns, uint64_t cells) {
+        m_solveNs.store(ns, std::memory_order_relaxed);
+        m_solveCells.store(cells, std::memory_order_relaxed);
+    }
+    void recordPathLength(uint64_t length) { m_pathLength.store(length, std::memory_order_relaxed); }
+    void recordMemory(uint64_t mapBytes, uint64_t dpBytes, uint64_t overlayBytes) {
+        m_mapBytes.store(mapBytes, std::memory_order_relaxed);
+        m_dpBytes.store(dpBytes, std::memory_order_relaxed);
+        m_overlayBytes.store(overlayBytes, std::memory_order_relaxed);
+    }
+    void recordArena(uint64_t currentBytes, uint64_t peakBytes) {
+        m_arenaBytes.store(currentBytes, std::memory_order_relaxed);
+        m_arenaPeakBytes.store(peakBytes, std::memory_order_relaxed);
+    }
+
+    // 模型data()每次调用计数，一帧结束时归入上一帧
+    void countDataCall() { m_dataCalls.fetch_add(1, std::memory_order_relaxed); }
+
+    // 手动模式按键后记下时间，下一帧绘制完成时得到延迟
+    void markKeyPress() { m_keyPressAt.store(now(), std::memory_order_relaxed); }
+
+    // 视图一帧绘制完成
+    void recordFrame(uint64_t begin, uint64_t end);
+
+    PerfSample sample() const;
+
+private:
+    PerfMetrics() = default;
+
+    std::atomic<uint64_t> m_generateNs{0};
+    std::atomic<uint32_t> m_generateAttempts{0};
+    std::atomic<uint64_t> m_solveNs{0};
+    std::atomic<uint64_t> m_solveCells{0};
+    std::atomic<uint64_t> m_pathLength{0};
+    std::atomic<uint64_t> m_dataCalls{0};
+    std::atomic<uint64_t> m_frameDataCalls{0};
+    std::atomic<uint64_t> m_framePaintNs{0};
+    std::atomic<uint64_t> m_frames{0};
+    std::atomic<uint64_t> m_keyPressAt{0};
+    std::atomic<uint64_t> m_keyLatencyNs{0};
+    std::atomic<uint64_t> m_mapBytes{0};
+    std::atomic<uint64_t> m_dpBytes{0};
+    std::atomic<uint64_t> m_overlayBytes{0};
+    std::atomic<uint64_t> m_arenaBytes{0};
+    std::atomic<uint64_t> m_arenaPeakBytes{0};
+};
+
+#endif // PERFMETRICS_H
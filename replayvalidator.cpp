@@ -0,0 +1,422 @@
+#include "replayvalidator.h"
+#include "compactpath.h"
+#include "dungeon.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include "wallmask.h"
+#include <QFile>
+#include <QSaveFile>
+#include <algorithm>
+#include <bitset>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const char REPLAY_MAGIC[8] = {'D', 'G', 'N', 'R', 'P', 'L', 'Y', '\0'};
+const uint32_t REPLAY_VERSION = 1;
+
+// 录像文件头（小端序，固定24字节），之后是count局录像
+struct ReplayFileHeader {
+    char magic[8];          // "DGNRPLY\0"
+    uint32_t version;       // 格式版本
+    uint32_t headerSize;    // 文件头大小
+    uint64_t count;         // 录像局数
+};
+
+static_assert(sizeof(ReplayFileHeader) == 24, "ReplayFileHeader必须为24字节");
+
+// 每块处理的位置数，与一个走法字对应
+const size_t BLOCK = 64;
+
+// 每个任务验证的局数
+const size_t REPLAYS_PER_TASK = 4096;
+
+size_t moveWords(uint32_t steps) {
+    return (static_cast<size_t>(steps) + 63) / 64;
+}
+
+bool isDown(const uint64_t* moves, size_t step) {
+    return (moves[step >> 6] >> (step & 63)) & 1;
+}
+
+void writeBytes(QSaveFile& file, const void* data, qint64 size) {
+    if (file.write(static_cast<const char*>(data), size) != size) {
+        throw ReplayException("写入文件失败: " + file.errorString().toStdString());
+    }
+}
+
+} // namespace
+
+void ReplayBatch::append(const ReplayHeader& header, const uint64_t* moves) {
+    size_t words = moveWords(header.steps);
+    m_headers.push_back(header);
+    m_offsets.push_back(m_moves.size());
+    m_moves.insert(m_moves.end(), moves, moves + words);
+
+    // 最后一个字中超出步数的位清零，同一局的录像保存后逐字节相同
+    if (header.steps & 63) {
+        m_moves.back() &= (uint64_t(1) << (header.steps & 63)) - 1;
+    }
+}
+
+void ReplayBatch::append(const Dungeon& dungeon) {
+    try {
+        int rows = dungeon.getRows();
+        int cols = dungeon.getCols();
+        if (dungeon.getMovementMode() != MovementMode::RIGHT_DOWN || !dungeon.getRoute().isClassic(rows, cols)) {
+            throw ReplayException("录像只支持经典路线和只向右下走的移动方式");
+        }
+        if (dungeon.getPlayerPath().empty()) {
+            throw ReplayException("还没有开始游戏");
+        }
+
+        CompactPath path = CompactPath::fromPoints(dungeon.getPlayerPath());
+        MapHash hash = dungeon.getMapHash();
+
+        ReplayHeader header;
+        std::memset(&header, 0, sizeof(header));
+        header.hashLow = hash.low;
+        header.hashHigh = hash.high;
+        header.seed = dungeon.getSeed();
+        header.rows = static_cast<uint32_t>(rows);
+        header.cols = static_cast<uint32_t>(cols);
+        header.initialHealth = dungeon.getInitialHealth();
+        header.healthCap = dungeon.getHealthCap();
+        header.steps = path.length;
+        header.wallDensity = static_cast<uint16_t>(dungeon.getWallDensity());
+        append(header, path.bits.data());
+
+    } catch (const ReplayException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw ReplayException(std::string("记录录像失败: ") + e.what());
+    }
+}
+
+void ReplayBatch::clear() {
+    m_headers.clear();
+    m_offsets.clear();
+    m_moves.clear();
+}
+
+void ReplayBatch::save(const QString& fileName) const {
+    try {
+        ReplayFileHeader fileHeader;
+        std::memset(&fileHeader, 0, sizeof(fileHeader));
+        std::memcpy(fileHeader.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+        fileHeader.version = REPLAY_VERSION;
+        fileHeader.headerSize = sizeof(ReplayFileHeader);
+        fileHeader.count = m_headers.size();
+
+        // 先写临时文件，全部成功后再替换目标文件
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            throw ReplayException("无法创建文件: " + file.errorString().toStdString());
+        }
+
+        writeBytes(file, &fileHeader, sizeof(fileHeader));
+        for (size_t k = 0; k < m_headers.size(); ++k) {
+            writeBytes(file, &m_headers[k], sizeof(ReplayHeader));
+            writeBytes(file, moves(k), static_cast<qint64>(moveWords(m_headers[k].steps) * sizeof(uint64_t)));
+        }
+
+        if (!file.commit()) {
+            throw ReplayException("保存文件失败: " + file.errorString().toStdString());
+        }
+        LOG_INFO("Saved %zu replays to %s", m_headers.size(), qPrintable(fileName));
+
+    } catch (const ReplayException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw ReplayException(std::string("保存录像失败: ") + e.what());
+    }
+}
+
+ReplayBatch ReplayBatch::load(const QString& fileName) {
+    try {
+        QFile file(fileName);
+        if (!file.open(QIODevice::ReadOnly)) {
+            throw ReplayException("无法打开文件: " + file.errorString().toStdString());
+        }
+        uint64_t size = static_cast<uint64_t>(file.size());
+        if (size < sizeof(ReplayFileHeader)) {
+            throw ReplayException("文件过小，不是有效的录像文件");
+        }
+
+        const uchar* data = file.map(0, static_cast<qint64>(size));
+        if (!data) {
+            throw ReplayException("内存映射文件失败: " + file.errorString().toStdString());
+        }
+
+        ReplayFileHeader fileHeader;
+        std::memcpy(&fileHeader, data, sizeof(fileHeader));
+        if (std::memcmp(fileHeader.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) != 0) {
+            throw ReplayException("不是有效的录像文件");
+        }
+        if (fileHeader.version != REPLAY_VERSION) {
+            throw ReplayException("不支持的录像文件版本: " + std::to_string(fileHeader.version));
+        }
+        if (fileHeader.headerSize < sizeof(ReplayFileHeader) || fileHeader.headerSize > size) {
+            throw ReplayException("录像文件头大小无效");
+        }
+        // 每局至少有录像头，局数不可能超过文件能容纳的数量
+        if (fileHeader.count > (size - fileHeader.headerSize) / sizeof(ReplayHeader)) {
+            throw ReplayException("录像局数与文件大小不符");
+        }
+
+        ReplayBatch batch;
+        batch.m_headers.reserve(fileHeader.count);
+        batch.m_offsets.reserve(fileHeader.count);
+        batch.m_moves.reserve((size - fileHeader.headerSize) / sizeof(uint64_t));
+
+        uint64_t offset = fileHeader.headerSize;
+        std::vector<uint64_t> moves;
+        for (uint64_t k = 0; k < fileHeader.count; ++k) {
+            ReplayHeader header;
+            if (size - offset < sizeof(header)) {
+                throw ReplayException("录像文件被截断");
+            }
+            std::memcpy(&header, data + offset, sizeof(header));
+            offset += sizeof(header);
+
+            uint64_t bytes = moveWords(header.steps) * sizeof(uint64_t);
+            if (size - offset < bytes) {
+                throw ReplayException("录像文件被截断");
+            }
+            moves.resize(moveWords(header.steps));
+            std::memcpy(moves.data(), data + offset, bytes);
+            offset += bytes;
+
+            batch.append(header, moves.data());
+        }
+
+        LOG_INFO("Loaded %zu replays from %s", batch.size(), qPrintable(fileName));
+        return batch;
+
+    } catch (const ReplayException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw ReplayException(std::string("载入录像失败: ") + e.what());
+    }
+}
+
+MapHash ReplayValidator::addMap(const int* cells, int rows, int cols, const uint64_t* walls) {
+    if (!cells || rows <= 0 || cols <= 0) {
+        throw ReplayException("地图数据无效");
+    }
+    size_t count = static_cast<size_t>(rows) * cols;
+    bool hasWalls = WallMask::any(walls, count);
+    MapHash hash = hashMap(cells, rows, cols, hasWalls ? walls : nullptr);
+    if (m_index.count(hash)) {
+        return hash;
+    }
+
+    StoredMap map;
+    map.rows = rows;
+    map.cols = cols;
+    map.cells.assign(cells, cells + count);
+    if (hasWalls) {
+        map.walls.assign(walls, walls + WallMask::wordCount(count));
+    }
+    m_index.emplace(hash, m_maps.size());
+    m_maps.push_back(std::move(map));
+    return hash;
+}
+
+MapHash ReplayValidator::addMap(const Dungeon& dungeon) {
+    int rows = dungeon.getRows();
+    int cols = dungeon.getCols();
+    std::vector<int> cells(static_cast<size_t>(rows) * cols);
+    for (int i = 0; i < rows; ++i) {
+        std::copy(dungeon.getMapRow(i), dungeon.getMapRow(i) + cols, cells.begin() + static_cast<size_t>(i) * cols);
+    }
+    return addMap(cells.data(), rows, cols, dungeon.getWallBits());
+}
+
+void ReplayValidator::generateSeededMaps(const ReplayBatch& batch) {
+    for (size_t k = 0; k < batch.size(); ++k) {
+        const ReplayHeader& header = batch.header(k);
+        if (header.seed == 0 || m_index.count(header.mapHash())) {
+            continue;
+        }
+        if (!m_generated.emplace(header.seed, header.rows, header.cols, header.wallDensity, header.healthCap).second) {
+            continue;
+        }
+
+        // 每组生成参数只生成一次；参数无效或生成失败时这些录像按UNKNOWN_MAP处理
+        try {
+            int rows = static_cast<int>(header.rows);
+            int cols = static_cast<int>(header.cols);
+            Dungeon dungeon(rows, cols);
+            if (dungeon.getRows() != rows || dungeon.getCols() != cols) {
+                throw ReplayException("地图尺寸无效");
+            }
+            dungeon.setWallDensity(header.wallDensity);
+            // 生成时按带上限的dp判断每次尝试是否可接受，上限不同时同一种子会得到不同的地图
+            dungeon.setHealthCap(header.healthCap);
+            dungeon.generateMap(header.seed);
+            addMap(dungeon);
+        } catch (const std::exception& e) {
+            LOG_WARNING("Cannot regenerate replay map for seed %llu: %s",
+                        static_cast<unsigned long long>(header.seed), e.what());
+        }
+    }
+}
+
+std::vector<ReplayResult> ReplayValidator::validate(const ReplayBatch& batch) {
+    TRACE_SCOPE("ReplayValidator::validate");
+    try {
+        uint64_t start = PerfMetrics::now();
+        generateSeededMaps(batch);
+
+        // 地图只读，各任务按块验证相邻的录像，结果写入各自的位置
+        std::vector<ReplayResult> results(batch.size());
+        size_t taskCount = (batch.size() + REPLAYS_PER_TASK - 1) / REPLAYS_PER_TASK;
+        parallelFor(taskCount, TaskPriority::Normal, [&](size_t task) {
+            size_t begin = task * REPLAYS_PER_TASK;
+            size_t end = std::min(begin + REPLAYS_PER_TASK, batch.size());
+            for (size_t k = begin; k < end; ++k) {
+                results[k] = validate(batch.header(k), batch.moves(k));
+            }
+        });
+
+        LOG_INFO("Validated %zu replays in %.3f ms", batch.size(), (PerfMetrics::now() - start) / 1e6);
+        return results;
+
+    } catch (const ReplayException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw ReplayException(std::string("验证录像失败: ") + e.what());
+    }
+}
+
+ReplayResult ReplayValidator::validate(const ReplayHeader& header, const uint64_t* moves) const {
+    auto it = m_index.find(header.mapHash());
+    if (it == m_index.end()) {
+        return ReplayResult();
+    }
+    return replay(m_maps[it->second], header, moves);
+}
+
+ReplayResult ReplayValidator::replay(const StoredMap& map, const ReplayHeader& header, const uint64_t* moves) {
+    ReplayResult result;
+    result.outcome = ReplayOutcome::INVALID;
+    if (header.initialHealth <= 0 || header.healthCap < 0) {
+        result.invalidStep = 0;
+        return result;
+    }
+
+    const int rows = map.rows;
+    const int cols = map.cols;
+    const int* cells = map.cells.data();
+    const uint64_t* walls = map.walls.empty() ? nullptr : map.walls.data();
+    const int64_t cap = header.healthCap > 0 ? header.healthCap : INT_MAX;
+    const int64_t startHealth = std::min<int64_t>(header.initialHealth, cap);
+    const size_t steps = header.steps;
+
+    // 只向右下走时位置单调，向下和向右的总步数都不超出地图就不会越界。
+    // 超出时找到第一步越界的走法，只验证它之前的部分
+    size_t valid = steps;
+    size_t downs = 0;
+    for (size_t w = 0; w < moveWords(header.steps); ++w) {
+        uint64_t word = moves[w];
+        if (w + 1 == moveWords(header.steps) && (steps & 63)) {
+            word &= (uint64_t(1) << (steps & 63)) - 1;
+        }
+        downs += std::bitset<64>(word).count();
+    }
+    if (downs > static_cast<size_t>(rows - 1) || steps - downs > static_cast<size_t>(cols - 1)) {
+        downs = 0;
+        for (size_t m = 0; m < steps; ++m) {
+            size_t down = downs + isDown(moves, m);
+            if (down > static_cast<size_t>(rows - 1) || m + 1 - down > static_cast<size_t>(cols - 1)) {
+                valid = m;
+                break;
+            }
+            downs = down;
+        }
+    }
+
+    // 按块计算：格子下标、墙壁位、前缀和与前缀最大值、健康值，最后找出第一个倒下或撞墙的位置
+    size_t positions = valid + 1;
+    size_t index = 0;
+    int64_t sum = 0;
+    int64_t peak = INT64_MIN;
+    int64_t lastHealth = startHealth;
+    size_t cellAt[BLOCK];
+    int64_t health[BLOCK];
+    uint8_t blocked[BLOCK];
+
+    for (size_t base = 0; base < positions; base += BLOCK) {
+        size_t count = std::min(BLOCK, positions - base);
+
+        // 位置p由第p-1步走到：向右下标加1，向下加cols
+        for (size_t i = 0; i < count; ++i) {
+            size_t p = base + i;
+            size_t step = p > 0 ? 1 + (cols - 1) * static_cast<size_t>(isDown(moves, p - 1)) : 0;
+            index += step;
+            cellAt[i] = index;
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            blocked[i] = WallMask::isWall(walls, cellAt[i]);
+        }
+        if (base == 0) {
+            blocked[0] = 0;  // 与Dungeon相同，起点不检查墙壁
+        }
+
+        // h_p = S_p + min(H, cap - M_p)，peak在使用前已更新，不会溢出
+        for (size_t i = 0; i < count; ++i) {
+            sum += cells[cellAt[i]];
+            peak = std::max(peak, sum);
+            health[i] = sum + std::min(startHealth, cap - peak);
+        }
+
+        size_t first = count;
+        for (size_t i = 0; i < count; ++i) {
+            bool stop = blocked[i] | (health[i] <= 0);
+            first = std::min(first, stop ? i : count);
+        }
+
+        if (first < count) {
+            size_t p = base + first;
+            if (blocked[first]) {
+                // 走进墙壁的一步不会生效，健康值停在前一个位置
+                result.invalidStep = static_cast<int>(p);
+                result.finalHealth = static_cast<int>(first > 0 ? health[first - 1] : lastHealth);
+                return result;
+            }
+            result.deathStep = static_cast<int>(p);
+            result.finalHealth = static_cast<int>(health[first]);
+            if (p < steps) {
+                result.invalidStep = static_cast<int>(p + 1);  // 倒下后还有走法
+            } else {
+                result.outcome = ReplayOutcome::LOST;
+            }
+            return result;
+        }
+        lastHealth = health[count - 1];
+    }
+
+    result.finalHealth = static_cast<int>(lastHealth);
+    if (valid < steps) {
+        result.invalidStep = static_cast<int>(valid + 1);
+        return result;
+    }
+
+    int row = static_cast<int>(downs);
+    int col = static_cast<int>(valid - downs);
+    if (row == rows - 1 && col == cols - 1) {
+        result.outcome = ReplayOutcome::WON;
+        return result;
+    }
+
+    // 与Dungeon相同：右边和下边都是墙壁或地图边界时已不可能获胜
+    bool rightOpen = col + 1 < cols && !WallMask::isWall(walls, index + 1);
+    bool downOpen = row + 1 < rows && !WallMask::isWall(walls, index + cols);
+    result.outcome = rightOpen || downOpen ? ReplayOutcome::UNFINISHED : ReplayOutcome::LOST;
+    return result;
+}
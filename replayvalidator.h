@@ -0,0 +1,120 @@
+#ifndef REPLAYVALIDATOR_H
+#define REPLAYVALIDATOR_H
+
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+#include "maphash.h"
+
+class Dungeon;
+
+class ReplayException : public std::runtime_error {
+public:
+    explicit ReplayException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 一局手动模式游戏的录像头（小端序，固定48字节），只支持经典规则：从左上角出发，只向右或向下走，到右下角获胜。
+// 录像文件布局：文件头 | 逐局的录像头 + ceil(steps/64)个uint64走法位（每步1位，1表示向下，与CompactPath相同）
+struct ReplayHeader {
+    uint64_t hashLow;       // 地图内容哈希（hashMap，含墙壁）
+    uint64_t hashHigh;
+    uint64_t seed;          // 生成种子，0表示只能按哈希查找地图
+    uint32_t rows;          // 生成参数，与seed、wallDensity和healthCap一起重新生成地图
+    uint32_t cols;
+    int32_t initialHealth;  // 初始健康值
+    int32_t healthCap;      // 健康上限，0表示不限
+    uint32_t steps;         // 步数
+    uint16_t wallDensity;   // 生成时的墙壁比例
+    uint16_t reserved;      // 保留，写0
+
+    MapHash mapHash() const {
+        MapHash hash;
+        hash.low = hashLow;
+        hash.high = hashHigh;
+        return hash;
+    }
+};
+
+static_assert(sizeof(ReplayHeader) == 48, "ReplayHeader必须为48字节");
+
+// 一批录像。走法位连续存放，不为每局单独分配
+class ReplayBatch {
+public:
+    // 追加一局，moves为ceil(header.steps/64)个走法位
+    void append(const ReplayHeader& header, const uint64_t* moves);
+
+    // 记录dungeon中当前的手动模式游戏（经典路线、只向右下走）
+    void append(const Dungeon& dungeon);
+
+    size_t size() const { return m_headers.size(); }
+    const ReplayHeader& header(size_t k) const { return m_headers[k]; }
+    const uint64_t* moves(size_t k) const { return m_moves.data() + m_offsets[k]; }
+    void clear();
+
+    // 录像文件
+    void save(const QString& fileName) const;
+    static ReplayBatch load(const QString& fileName);
+
+private:
+    std::vector<ReplayHeader> m_headers;
+    std::vector<size_t> m_offsets;      // 每局走法位在m_moves中的起始下标
+    std::vector<uint64_t> m_moves;
+};
+
+enum class ReplayOutcome : uint8_t {
+    WON,            // 到达右下角
+    LOST,           // 健康值降到0及以下，或右边和下边都走不通
+    UNFINISHED,     // 走法已用完，游戏仍在进行
+    INVALID,        // 走出地图、走进墙壁、游戏结束后还有走法或参数非法
+    UNKNOWN_MAP     // 没有登记对应的地图，也无法按种子重新生成
+};
+
+struct ReplayResult {
+    ReplayOutcome outcome = ReplayOutcome::UNKNOWN_MAP;
+    int finalHealth = 0;    // 最后一个有效位置上的健康值
+    int deathStep = -1;     // 倒下时的路径下标（0为起点），-1表示没有倒下
+    int invalidStep = -1;   // 第一个非法走法的步号（从1起，即走后的路径下标），初始参数非法时为0
+};
+
+// 批量验证录像，不创建Dungeon，也不逐步记录路径。
+//
+// 经典规则下第p个位置上的健康值只取决于经过格子的前缀和：设S_p为前p+1个格子之和、M_p为S_0..S_p的最大值，
+// 有上限cap时 h_p = S_p + min(min(H, cap), cap - M_p)，不限上限时cap取INT_MAX，与Dungeon逐步截断的结果相同。
+// 每局按64步分块：先由走法位求格子下标，再取格子值和墙壁位，扫描前缀和与前缀最大值，
+// 最后无分支地找出第一个倒下或撞墙的位置，编译器可以将取值和查找展开为向量指令。各局之间在任务池中并行。
+class ReplayValidator {
+public:
+    // 登记地图，返回地图哈希；内容相同的地图只保存一份
+    MapHash addMap(const int* cells, int rows, int cols, const uint64_t* walls = nullptr);
+    MapHash addMap(const Dungeon& dungeon);
+    size_t mapCount() const { return m_maps.size(); }
+
+    // 验证一批录像，结果与录像一一对应。带种子且哈希未登记的地图先按种子生成一次，
+    // 生成结果的哈希与录像不符（例如生成后又编辑过）时该局为UNKNOWN_MAP
+    std::vector<ReplayResult> validate(const ReplayBatch& batch);
+
+    // 验证单局，只查找已登记的地图
+    ReplayResult validate(const ReplayHeader& header, const uint64_t* moves) const;
+
+private:
+    struct StoredMap {
+        int rows;
+        int cols;
+        std::vector<int> cells;
+        std::vector<uint64_t> walls;    // 没有墙壁时为空
+    };
+
+    void generateSeededMaps(const ReplayBatch& batch);
+    static ReplayResult replay(const StoredMap& map, const ReplayHeader& header, const uint64_t* moves);
+
+    std::vector<StoredMap> m_maps;
+    std::unordered_map<MapHash, size_t> m_index;
+    std::set<std::tuple<uint64_t, uint32_t, uint32_t, uint16_t, int32_t>> m_generated;  // 已按种子生成过的参数（含健康上限）
+};
+
+#endif // REPLAYVALIDATOR_H
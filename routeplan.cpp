@@ -0,0 +1,316 @@
+#include "routeplan.h"
+#include "logger.h"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+bool covers(const QPoint& from, const QPoint& to) {
+    return to.x() >= from.x() && to.y() >= from.y();
+}
+
+// 子矩形内公主格子按行分组，每行通常只有零到一个
+class TargetRows {
+public:
+    TargetRows(const std::vector<QPoint>& targets, int top, int bottom) : m_top(top), m_rows(bottom - top + 1) {
+        for (const QPoint& t : targets) {
+            if (t.y() >= top && t.y() <= bottom) {
+                m_rows[t.y() - top].push_back(t.x());
+            }
+        }
+    }
+
+    bool contains(int row, int col) const {
+        const std::vector<int>& cols = m_rows[row - m_top];
+        return std::find(cols.begin(), cols.end(), col) != cols.end();
+    }
+
+private:
+    int m_top;
+    std::vector<std::vector<int>> m_rows;
+};
+
+std::vector<QPoint> reachableTargets(const RoutePlan& plan, const QPoint& from) {
+    std::vector<QPoint> result;
+    for (const QPoint& t : plan.targets) {
+        if (covers(from, t)) {
+            result.push_back(t);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+RoutePlan RoutePlan::classic(int rows, int cols) {
+    RoutePlan plan;
+    plan.start = QPoint(0, 0);
+    plan.targets.push_back(QPoint(cols - 1, rows - 1));
+    return plan;
+}
+
+bool RoutePlan::isClassic(int rows, int cols) const {
+    return start == QPoint(0, 0) && waypoints.empty() &&
+           targets.size() == 1 && targets[0] == QPoint(cols - 1, rows - 1);
+}
+
+bool RoutePlan::isTarget(const QPoint& pos) const {
+    return std::find(targets.begin(), targets.end(), pos) != targets.end();
+}
+
+bool RoutePlan::operator==(const RoutePlan& other) const {
+    return start == other.start && waypoints == other.waypoints && targets == other.targets;
+}
+
+void validateRoute(const RoutePlan& plan, int rows, int cols) {
+    auto inBounds = [rows, cols](const QPoint& p) {
+        return p.x() >= 0 && p.x() < cols && p.y() >= 0 && p.y() < rows;
+    };
+
+    if (!inBounds(plan.start)) {
+        throw RouteException("起点超出地图范围");
+    }
+    if (plan.targets.empty()) {
+        throw RouteException("至少需要一个公主格子");
+    }
+    for (const QPoint& t : plan.targets) {
+        if (!inBounds(t)) {
+            throw RouteException("公主格子超出地图范围");
+        }
+    }
+
+    QPoint last = plan.start;
+    for (const QPoint& w : plan.waypoints) {
+        if (!inBounds(w)) {
+            throw RouteException("路点超出地图范围");
+        }
+        if (w == last || !covers(last, w)) {
+            throw RouteException("路点必须依次位于前一点的右下方");
+        }
+        last = w;
+    }
+
+    if (reachableTargets(plan, last).empty()) {
+        throw RouteException("经过所有路点后无法到达任何公主格子");
+    }
+}
+
+std::vector<RouteLeg> routeLegs(const RoutePlan& plan) {
+    std::vector<RouteLeg> legs;
+    legs.reserve(plan.waypoints.size() + 1);
+
+    QPoint from = plan.start;
+    for (const QPoint& w : plan.waypoints) {
+        legs.push_back({from, w, false});
+        from = w;
+    }
+
+    // 最后一段的范围覆盖所有可达的公主格子
+    QPoint bottomRight = from;
+    for (const QPoint& t : reachableTargets(plan, from)) {
+        bottomRight.setX(std::max(bottomRight.x(), t.x()));
+        bottomRight.setY(std::max(bottomRight.y(), t.y()));
+    }
+    legs.push_back({from, bottomRight, true});
+
+    return legs;
+}
+
+QPoint legLimit(const RoutePlan& plan, int rows, int cols, size_t nextWaypoint) {
+    if (nextWaypoint < plan.waypoints.size()) {
+        return plan.waypoints[nextWaypoint];
+    }
+    return QPoint(cols - 1, rows - 1);
+}
+
+std::vector<QPoint> traceRoute(const int* dp, int rows, int cols, const RoutePlan& plan,
+                               const QPoint& from, size_t nextWaypoint) {
+    std::vector<QPoint> path;
+    traceRoute(dp, rows, cols, plan, from, nextWaypoint, path);
+    return path;
+}
+
+void traceRoute(const int* dp, int rows, int cols, const RoutePlan& plan,
+                const QPoint& from, size_t nextWaypoint, std::vector<QPoint>& path) {
+    path.clear();
+    int i = from.y();
+    int j = from.x();
+
+    while (i < rows && j < cols) {
+        QPoint pos(j, i);
+        path.push_back(pos);
+
+        while (nextWaypoint < plan.waypoints.size() && plan.waypoints[nextWaypoint] == pos) {
+            nextWaypoint++;
+        }
+        if (nextWaypoint == plan.waypoints.size() && plan.isTarget(pos)) {
+            break;
+        }
+
+        // 与经典回溯的规则一致：相等时优先向下，超出当前段或不可达的方向不走
+        QPoint limit = legLimit(plan, rows, cols, nextWaypoint);
+        int down = i < limit.y() ? dp[static_cast<size_t>(i + 1) * cols + j] : INT_MAX;
+        int right = j < limit.x() ? dp[static_cast<size_t>(i) * cols + j + 1] : INT_MAX;
+        if (down == INT_MAX && right == INT_MAX) {
+            break;
+        }
+
+        if (down <= right) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+bool isRouteOpen(const RoutePlan& plan, const uint64_t* walls, int rows, int cols) {
+    if (!WallMask::any(walls, static_cast<size_t>(rows) * cols)) {
+        return true;
+    }
+
+    // 每一段都要能从段起点走到段终点，路点本身也不能是墙
+    for (const RouteLeg& leg : routeLegs(plan)) {
+        std::vector<QPoint> ends = leg.final ? reachableTargets(plan, leg.from)
+                                             : std::vector<QPoint>{leg.bottomRight};
+        if (WallMask::isWall(walls, static_cast<size_t>(leg.from.y()) * cols + leg.from.x()) ||
+            !WallMask::reachable(walls, rows, cols, leg.from, ends)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void solveRouteForward(const int* map, const uint64_t* walls, int rows, int cols, const RoutePlan& plan,
+                       int health, int cap, int* out) {
+    std::fill(out, out + static_cast<size_t>(rows) * cols, 0);
+    size_t startIndex = static_cast<size_t>(plan.start.y()) * cols + plan.start.x();
+    out[startIndex] = WallMask::masked(std::max(0, std::min(health, cap)), WallMask::isWall(walls, startIndex), 0);
+
+    // 每段从上一段在路点处的结果出发，最后一段到达公主格子后不再继续
+    for (const RouteLeg& leg : routeLegs(plan)) {
+        int top = leg.from.y();
+        int left = leg.from.x();
+        int bottom = leg.bottomRight.y();
+        int right = leg.bottomRight.x();
+        TargetRows targets(leg.final ? plan.targets : std::vector<QPoint>(), top, bottom);
+
+        for (int i = top; i <= bottom; ++i) {
+            int* row = out + static_cast<size_t>(i) * cols;
+            const int* mapRow = map + static_cast<size_t>(i) * cols;
+
+            for (int j = left; j <= right; ++j) {
+                if (i == top && j == left) {
+                    continue;
+                }
+
+                int best = 0;
+                if (i > top && !targets.contains(i - 1, j)) {
+                    best = leaveHealth(row[j - cols], mapRow[j - cols], cap);
+                }
+                if (j > left && !targets.contains(i, j - 1)) {
+                    best = std::max(best, leaveHealth(row[j - 1], mapRow[j - 1], cap));
+                }
+                row[j] = WallMask::masked(best, WallMask::isWall(walls, static_cast<size_t>(i) * cols + j), 0);
+            }
+        }
+    }
+}
+
+bool RouteSolver::CachedLeg::sameKey(const CachedLeg& other) const {
+    return leg.from == other.leg.from && leg.bottomRight == other.leg.bottomRight &&
+           leg.final == other.leg.final && ends == other.ends &&
+           terminal == other.terminal && cap == other.cap && contentVersion == other.contentVersion;
+}
+
+int RouteSolver::solve(const int* map, const uint64_t* walls, int rows, int cols, uint64_t contentVersion,
+                       const RoutePlan& plan, int cap, int* dp) {
+    try {
+        validateRoute(plan, rows, cols);
+
+        std::vector<RouteLeg> legs = routeLegs(plan);
+        std::vector<CachedLeg> solved(legs.size());
+        int recomputed = 0;
+        int terminal = 0;
+
+        for (size_t n = legs.size(); n-- > 0;) {
+            CachedLeg& current = solved[n];
+            current.leg = legs[n];
+            current.ends = current.leg.final ? reachableTargets(plan, current.leg.from)
+                                             : std::vector<QPoint>{current.leg.bottomRight};
+            current.terminal = current.leg.final ? 0 : terminal;
+            current.cap = cap;
+            current.contentVersion = contentVersion;
+
+            auto cached = std::find_if(m_legs.begin(), m_legs.end(), [&current](const CachedLeg& leg) {
+                return !leg.table.empty() && leg.sameKey(current);
+            });
+            if (cached != m_legs.end()) {
+                current.table = std::move(cached->table);
+            } else {
+                solveLeg(map, walls, cols, current);
+                recomputed++;
+            }
+
+            // 写入全图DP表，相邻两段只在路点处重叠且值相同
+            int top = current.leg.from.y();
+            int left = current.leg.from.x();
+            int width = current.leg.bottomRight.x() - left + 1;
+            int height = current.leg.bottomRight.y() - top + 1;
+            for (int r = 0; r < height; ++r) {
+                const int* src = current.table.data() + static_cast<size_t>(r) * width;
+                std::copy(src, src + width, dp + static_cast<size_t>(top + r) * cols + left);
+            }
+
+            terminal = current.table[0];
+        }
+
+        m_legs = std::move(solved);
+        LOG_DEBUG("Route solved: %d of %zu legs recomputed", recomputed, legs.size());
+        return recomputed;
+
+    } catch (const RouteException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        m_legs.clear();
+        throw RouteException(std::string("路线求解失败: ") + e.what());
+    }
+}
+
+void RouteSolver::solveLeg(const int* map, const uint64_t* walls, int cols, CachedLeg& leg) {
+    int top = leg.leg.from.y();
+    int left = leg.leg.from.x();
+    int width = leg.leg.bottomRight.x() - left + 1;
+    int height = leg.leg.bottomRight.y() - top + 1;
+    TargetRows targets(leg.leg.final ? leg.ends : std::vector<QPoint>(), top, top + height - 1);
+
+    leg.table.assign(static_cast<size_t>(width) * height, INT_MAX);
+
+    // 与全图求解相同的递推，只是范围限制在子矩形内，到不了终点、超出健康上限或是墙壁的格子为INT_MAX
+    for (int r = height - 1; r >= 0; --r) {
+        int* row = leg.table.data() + static_cast<size_t>(r) * width;
+        const int* below = row + width;
+        const int* mapRow = map + static_cast<size_t>(top + r) * cols + left;
+        size_t base = static_cast<size_t>(top + r) * cols + left;
+
+        for (int c = width - 1; c >= 0; --c) {
+            bool wall = WallMask::isWall(walls, base + c);
+            if (!leg.leg.final && r == height - 1 && c == width - 1) {
+                row[c] = WallMask::masked(leg.terminal, wall, INT_MAX);
+                continue;
+            }
+            if (leg.leg.final && targets.contains(top + r, left + c)) {
+                row[c] = WallMask::masked(neededHealth(1, mapRow[c], leg.cap), wall, INT_MAX);
+                continue;
+            }
+
+            int next = INT_MAX;
+            if (r < height - 1) {
+                next = below[c];
+            }
+            if (c < width - 1) {
+                next = std::min(next, row[c + 1]);
+            }
+            row[c] = WallMask::masked(neededHealth(next, mapRow[c], leg.cap), wall, INT_MAX);
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef ROUTEPLAN_H
+#define ROUTEPLAN_H
+
+#include <QPoint>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "healthstep.h"
+#include "wallmask.h"
+
+class RouteException : public std::runtime_error {
+public:
+    explicit RouteException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 路线：起点、必须依次经过的路点和若干候选公主格子（到达任意一个即获胜）
+// 只能向右或向下移动，所以路点必须依次位于前一点的右下方
+struct RoutePlan {
+    QPoint start;
+    std::vector<QPoint> waypoints;
+    std::vector<QPoint> targets;
+
+    // 经典路线：从左上角到右下角，没有路点
+    static RoutePlan classic(int rows, int cols);
+    bool isClassic(int rows, int cols) const;
+
+    bool isTarget(const QPoint& pos) const;
+    bool operator==(const RoutePlan& other) const;
+    bool operator!=(const RoutePlan& other) const { return !(*this == other); }
+};
+
+// 检查路线是否可以走通，不能时抛出RouteException
+void validateRoute(const RoutePlan& plan, int rows, int cols);
+
+// 路线中的一段：在from到bottomRight的子矩形内求解。
+// 中间段的终点就是bottomRight处的路点，最后一段的终点是矩形内的公主格子
+struct RouteLeg {
+    QPoint from;
+    QPoint bottomRight;
+    bool final = false;
+};
+
+std::vector<RouteLeg> routeLegs(const RoutePlan& plan);
+
+// 沿已求解的dp表从from贪心回溯到公主格子，nextWaypoint是尚未经过的第一个路点
+std::vector<QPoint> traceRoute(const int* dp, int rows, int cols, const RoutePlan& plan,
+                               const QPoint& from, size_t nextWaypoint);
+
+// 同上，结果写入path（先清空），复用path已有的容量
+void traceRoute(const int* dp, int rows, int cols, const RoutePlan& plan,
+                const QPoint& from, size_t nextWaypoint, std::vector<QPoint>& path);
+
+// 从from出发时当前这一段的可走范围（右下角）
+QPoint legLimit(const RoutePlan& plan, int rows, int cols, size_t nextWaypoint);
+
+// 路线的每一段在墙壁之间是否都能走通（只看墙壁，不看健康值），walls为空时总是true
+bool isRouteOpen(const RoutePlan& plan, const uint64_t* walls, int rows, int cols);
+
+// 正向DP：以health从起点出发沿路线到达每个格子时的最大健康值，不在路线上的格子和墙壁为0
+void solveRouteForward(const int* map, const uint64_t* walls, int rows, int cols, const RoutePlan& plan,
+                       int health, int cap, int* out);
+
+// 分段求解自定义路线的DP表。
+// 从最后一段开始反向求解，每段在自己的子矩形内计算，前一段以后一段在路点处的值作为终点值。
+// 每段的结果按（范围、终点、终点值、健康上限、地图内容版本）缓存，移动一个路点时只重算相邻的段，
+// 更前面的段只在路点处的值发生变化时才需要重算。
+class RouteSolver {
+public:
+    // 求解结果写入dp（调用方已填充INT_MAX），cap为健康上限，返回本次实际重算的段数
+    int solve(const int* map, const uint64_t* walls, int rows, int cols, uint64_t contentVersion,
+              const RoutePlan& plan, int cap, int* dp);
+
+    void clear() { m_legs.clear(); }
+
+private:
+    struct CachedLeg {
+        RouteLeg leg;
+        std::vector<QPoint> ends;       // 中间段为路点，最后一段为公主格子
+        int terminal = 0;               // 中间段终点处的值
+        int cap = INT_MAX;              // 健康上限
+        uint64_t contentVersion = 0;
+        std::vector<int> table;         // 子矩形内的DP表（行优先）
+
+        bool sameKey(const CachedLeg& other) const;
+    };
+
+    std::vector<CachedLeg> m_legs;
+
+    static void solveLeg(const int* map, const uint64_t* walls, int cols, CachedLeg& leg);
+};
+
+#endif // ROUTEPLAN_H
@@ -0,0 +1,366 @@
+#include "solutioncache.h"
+#include "logger.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <climits>
+#include <cstring>
+
+namespace {
+
+const char DISK_MAGIC[4] = {'D', 'S', 'O', 'L'};
+const uint32_t DISK_VERSION = 1;
+
+// 磁盘缓存文件头，其后依次为路径位和可选的DP表
+struct DiskHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t hashLow;
+    uint64_t hashHigh;
+    uint32_t rows;
+    uint32_t cols;
+    int32_t minHealth;
+    int32_t startX;
+    int32_t startY;
+    uint32_t pathLength;
+    uint32_t pathWords;
+    uint32_t hasDp;
+};
+
+QString diskFileName(const MapHash& hash) {
+    return QString::fromStdString(hash.toHex() + ".dsol");
+}
+
+void removeDiskFiles(const QString& directory, const std::vector<QString>& fileNames) {
+    for (const QString& fileName : fileNames) {
+        QFile::remove(QDir(directory).filePath(fileName));
+    }
+}
+
+// 只向右下走的路径必须留在地图内；有可行路线时终止于右下角，没有时只有起点
+bool isValidPath(const CompactPath& path, int rows, int cols, int minHealth) {
+    if (minHealth <= 0) {
+        return false;
+    }
+    if (path.start.x() < 0 || path.start.x() >= cols || path.start.y() < 0 || path.start.y() >= rows) {
+        return false;
+    }
+
+    long long downs = 0;
+    for (uint32_t step = 0; step < path.length; ++step) {
+        downs += path.isDown(step);
+    }
+    long long endRow = path.start.y() + downs;
+    long long endCol = path.start.x() + (static_cast<long long>(path.length) - downs);
+    if (endRow > rows - 1 || endCol > cols - 1) {
+        return false;
+    }
+
+    if (minHealth == INT_MAX) {
+        return path.length == 0;
+    }
+    return endRow == rows - 1 && endCol == cols - 1;
+}
+
+} // namespace
+
+size_t CachedSolution::byteSize() const {
+    return sizeof(CachedSolution) + path.byteSize() + (dp ? dp->size() * sizeof(int) : 0);
+}
+
+SolutionCache::SolutionCache(size_t maxBytes, bool storeDp)
+    : m_maxBytes(maxBytes), m_bytes(0), m_storeDp(storeDp),
+    m_maxDiskBytes(DEFAULT_DISK_BYTES), m_diskBytes(0), m_diskStoresDp(false),
+    m_memoryHits(0), m_diskHits(0), m_misses(0), m_insertions(0), m_evictions(0), m_diskEvictions(0) {
+}
+
+void SolutionCache::setDiskDirectory(const QString& directory, size_t maxDiskBytes) {
+    QFileInfoList files;
+    if (!directory.isEmpty()) {
+        if (!QDir().mkpath(directory)) {
+            throw SolutionCacheException("无法创建缓存目录: " + directory.toStdString());
+        }
+        // 之前运行留下的文件按修改时间从新到旧排列，作为初始的LRU顺序
+        files = QDir(directory).entryInfoList(QStringList() << "*.dsol", QDir::Files, QDir::Time);
+    }
+
+    std::vector<QString> stale;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_diskDirectory = directory;
+        m_maxDiskBytes = maxDiskBytes;
+        m_diskLru.clear();
+        m_diskIndex.clear();
+        m_diskBytes = 0;
+        for (const QFileInfo& info : files) {
+            m_diskLru.emplace_back(info.fileName(), static_cast<size_t>(info.size()));
+            m_diskIndex[info.fileName().toStdString()] = std::prev(m_diskLru.end());
+            m_diskBytes += static_cast<size_t>(info.size());
+        }
+        stale = evictDiskLocked();
+    }
+    removeDiskFiles(directory, stale);
+}
+
+void SolutionCache::setDiskStoresDp(bool storeDp) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_diskStoresDp = storeDp;
+}
+
+QString SolutionCache::diskDirectory() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_diskDirectory;
+}
+
+CachedSolutionPtr SolutionCache::lookup(const MapHash& hash, int rows, int cols) {
+    QString directory;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_index.find(hash);
+        if (it != m_index.end()) {
+            const CachedSolutionPtr& solution = it->second->second;
+            if (solution->rows == rows && solution->cols == cols) {
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                m_memoryHits++;
+                return solution;
+            }
+        }
+
+        directory = m_diskDirectory;
+    }
+
+    // 磁盘读取不持有锁
+    if (!directory.isEmpty()) {
+        CachedSolutionPtr solution = loadFromDisk(directory, hash, rows, cols);
+        if (solution) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            insertLocked(hash, solution);
+            auto disk = m_diskIndex.find(diskFileName(hash).toStdString());
+            if (disk != m_diskIndex.end()) {
+                m_diskLru.splice(m_diskLru.begin(), m_diskLru, disk->second);
+            }
+            m_diskHits++;
+            return solution;
+        }
+    }
+
+    m_misses++;
+    return nullptr;
+}
+
+void SolutionCache::insert(const MapHash& hash, CachedSolutionPtr solution) {
+    if (!solution) {
+        return;
+    }
+
+    if (!m_storeDp && solution->dp) {
+        auto stripped = std::make_shared<CachedSolution>(*solution);
+        stripped->dp.reset();
+        solution = stripped;
+    }
+
+    QString directory;
+    bool diskStoresDp = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        insertLocked(hash, solution);
+        m_insertions++;
+        directory = m_diskDirectory;
+        diskStoresDp = m_diskStoresDp;
+    }
+
+    if (!directory.isEmpty()) {
+        try {
+            size_t bytes = saveToDisk(directory, hash, *solution, diskStoresDp);
+            std::vector<QString> stale;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_diskDirectory == directory) {
+                    touchDiskLocked(diskFileName(hash), bytes);
+                    stale = evictDiskLocked();
+                }
+            }
+            removeDiskFiles(directory, stale);
+        } catch (const std::exception& e) {
+            // 磁盘缓存只是加速手段，写入失败不影响求解结果
+            LOG_WARNING("Solution cache disk write failed: %s", e.what());
+        }
+    }
+}
+
+void SolutionCache::insertLocked(const MapHash& hash, CachedSolutionPtr solution) {
+    auto it = m_index.find(hash);
+    if (it != m_index.end()) {
+        m_bytes -= it->second->second->byteSize();
+        m_lru.erase(it->second);
+        m_index.erase(it);
+    }
+
+    m_lru.emplace_front(hash, std::move(solution));
+    m_index[hash] = m_lru.begin();
+    m_bytes += m_lru.front().second->byteSize();
+
+    // 超出容量时从最久未使用的一端淘汰，至少保留刚写入的条目
+    while (m_bytes > m_maxBytes && m_lru.size() > 1) {
+        const Entry& oldest = m_lru.back();
+        m_bytes -= oldest.second->byteSize();
+        m_index.erase(oldest.first);
+        m_lru.pop_back();
+        m_evictions++;
+    }
+}
+
+void SolutionCache::touchDiskLocked(const QString& fileName, size_t bytes) {
+    auto it = m_diskIndex.find(fileName.toStdString());
+    if (it != m_diskIndex.end()) {
+        m_diskBytes -= it->second->second;
+        it->second->second = bytes;
+        m_diskLru.splice(m_diskLru.begin(), m_diskLru, it->second);
+    } else {
+        m_diskLru.emplace_front(fileName, bytes);
+        m_diskIndex[fileName.toStdString()] = m_diskLru.begin();
+    }
+    m_diskBytes += bytes;
+}
+
+std::vector<QString> SolutionCache::evictDiskLocked() {
+    // 返回要删除的文件，由调用方在锁外删除
+    std::vector<QString> stale;
+    while (m_diskBytes > m_maxDiskBytes && !m_diskLru.empty()) {
+        const DiskEntry& oldest = m_diskLru.back();
+        m_diskBytes -= oldest.second;
+        m_diskIndex.erase(oldest.first.toStdString());
+        stale.push_back(oldest.first);
+        m_diskLru.pop_back();
+        m_diskEvictions++;
+    }
+    return stale;
+}
+
+SolutionCacheStats SolutionCache::stats() const {
+    SolutionCacheStats result;
+    result.memoryHits = m_memoryHits.load();
+    result.diskHits = m_diskHits.load();
+    result.misses = m_misses.load();
+    result.insertions = m_insertions.load();
+    result.evictions = m_evictions.load();
+    result.diskEvictions = m_diskEvictions.load();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    result.entries = m_lru.size();
+    result.bytes = m_bytes;
+    result.diskBytes = m_diskBytes;
+    return result;
+}
+
+void SolutionCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lru.clear();
+    m_index.clear();
+    m_bytes = 0;
+}
+
+QString SolutionCache::diskPath(const QString& directory, const MapHash& hash) {
+    return QDir(directory).filePath(diskFileName(hash));
+}
+
+CachedSolutionPtr SolutionCache::loadFromDisk(const QString& directory, const MapHash& hash,
+                                              int rows, int cols) const {
+    QFile file(diskPath(directory, hash));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return nullptr;
+    }
+
+    try {
+        DiskHeader header;
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != sizeof(header) ||
+            std::memcmp(header.magic, DISK_MAGIC, sizeof(DISK_MAGIC)) != 0 ||
+            header.version != DISK_VERSION ||
+            header.hashLow != hash.low || header.hashHigh != hash.high ||
+            header.rows != static_cast<uint32_t>(rows) || header.cols != static_cast<uint32_t>(cols) ||
+            header.pathWords != (header.pathLength + 63) / 64) {
+            return nullptr;
+        }
+
+        auto solution = std::make_shared<CachedSolution>();
+        solution->rows = rows;
+        solution->cols = cols;
+        solution->minHealth = header.minHealth;
+        solution->path.start = QPoint(header.startX, header.startY);
+        solution->path.length = header.pathLength;
+        solution->path.bits.resize(header.pathWords);
+
+        qint64 pathBytes = static_cast<qint64>(header.pathWords) * sizeof(uint64_t);
+        if (file.read(reinterpret_cast<char*>(solution->path.bits.data()), pathBytes) != pathBytes) {
+            return nullptr;
+        }
+
+        // 文件可能被截断或改写，路径和DP表都检查后才使用
+        if (!isValidPath(solution->path, rows, cols, solution->minHealth)) {
+            LOG_WARNING("Solution cache file %s has an invalid path, ignored", hash.toHex().c_str());
+            return nullptr;
+        }
+
+        if (header.hasDp && m_storeDp) {
+            auto dp = std::make_shared<std::vector<int>>(static_cast<size_t>(rows) * cols);
+            qint64 dpBytes = static_cast<qint64>(dp->size() * sizeof(int));
+            if (file.read(reinterpret_cast<char*>(dp->data()), dpBytes) != dpBytes) {
+                return nullptr;
+            }
+            size_t start = static_cast<size_t>(solution->path.start.y()) * cols + solution->path.start.x();
+            if ((*dp)[start] != solution->minHealth) {
+                LOG_WARNING("Solution cache file %s has a dp table that disagrees with its min health, ignored",
+                            hash.toHex().c_str());
+                return nullptr;
+            }
+            solution->dp = dp;
+        }
+
+        return solution;
+
+    } catch (const std::exception& e) {
+        LOG_WARNING("Solution cache disk read failed: %s", e.what());
+        return nullptr;
+    }
+}
+
+size_t SolutionCache::saveToDisk(const QString& directory, const MapHash& hash,
+                                 const CachedSolution& solution, bool storeDp) const {
+    bool writeDp = storeDp && solution.dp;
+
+    DiskHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, DISK_MAGIC, sizeof(DISK_MAGIC));
+    header.version = DISK_VERSION;
+    header.hashLow = hash.low;
+    header.hashHigh = hash.high;
+    header.rows = static_cast<uint32_t>(solution.rows);
+    header.cols = static_cast<uint32_t>(solution.cols);
+    header.minHealth = solution.minHealth;
+    header.startX = solution.path.start.x();
+    header.startY = solution.path.start.y();
+    header.pathLength = solution.path.length;
+    header.pathWords = static_cast<uint32_t>(solution.path.bits.size());
+    header.hasDp = writeDp ? 1 : 0;
+
+    QSaveFile file(diskPath(directory, hash));
+    if (!file.open(QIODevice::WriteOnly)) {
+        throw SolutionCacheException("无法写入缓存文件: " + file.errorString().toStdString());
+    }
+
+    qint64 pathBytes = static_cast<qint64>(solution.path.byteSize());
+    bool ok = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header) &&
+              file.write(reinterpret_cast<const char*>(solution.path.bits.data()), pathBytes) == pathBytes;
+
+    qint64 dpBytes = writeDp ? static_cast<qint64>(solution.dp->size() * sizeof(int)) : 0;
+    if (ok && writeDp) {
+        ok = file.write(reinterpret_cast<const char*>(solution.dp->data()), dpBytes) == dpBytes;
+    }
+
+    if (!ok || !file.commit()) {
+        throw SolutionCacheException("写入缓存文件失败: " + file.errorString().toStdString());
+    }
+    return sizeof(header) + static_cast<size_t>(pathBytes + dpBytes);
+}
@@ -0,0 +1,105 @@
+#ifndef SOLUTIONCACHE_H
+#define SOLUTIONCACHE_H
+
+#include <QString>
+#include <atomic>
+#include <list>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "compactpath.h"
+#include "maphash.h"
+
+// 一张地图的求解结果
+struct CachedSolution {
+    int rows = 0;
+    int cols = 0;
+    int minHealth = 0;
+    CompactPath path;                                   // 最优路径
+    std::shared_ptr<const std::vector<int>> dp;         // 可选的完整DP表
+
+    size_t byteSize() const;
+};
+
+using CachedSolutionPtr = std::shared_ptr<const CachedSolution>;
+
+struct SolutionCacheStats {
+    uint64_t memoryHits = 0;    // 内存命中次数
+    uint64_t diskHits = 0;      // 磁盘命中次数
+    uint64_t misses = 0;        // 未命中次数
+    uint64_t insertions = 0;    // 写入次数
+    uint64_t evictions = 0;     // 内存淘汰次数
+    uint64_t diskEvictions = 0; // 磁盘淘汰次数
+    size_t entries = 0;         // 内存中的条目数
+    size_t bytes = 0;           // 内存中的条目大小
+    size_t diskBytes = 0;       // 磁盘目录中缓存文件的大小
+};
+
+class SolutionCacheException : public std::runtime_error {
+public:
+    explicit SolutionCacheException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 以地图哈希为键的求解结果缓存：内存中按LRU淘汰，可选写穿到磁盘目录。
+// 磁盘目录同样按总字节数LRU淘汰（程序启动时按文件修改时间排序）；默认只把最小健康值和路径写入磁盘，
+// 完整DP表与地图同样大，需要时用setDiskStoresDp()打开。
+// 多个Dungeon可以共享同一个缓存，所有方法线程安全。
+class SolutionCache {
+public:
+    static const size_t DEFAULT_DISK_BYTES = 64 * 1024 * 1024;
+
+    explicit SolutionCache(size_t maxBytes = 64 * 1024 * 1024, bool storeDp = true);
+
+    // 设置磁盘缓存目录和容量，空字符串表示只用内存；目录中已有的缓存文件计入容量，超出时立即淘汰
+    void setDiskDirectory(const QString& directory, size_t maxDiskBytes = DEFAULT_DISK_BYTES);
+    QString diskDirectory() const;
+
+    // 是否把DP表也写入磁盘（默认否）
+    void setDiskStoresDp(bool storeDp);
+
+    // 查找结果，尺寸不一致时视为未命中
+    CachedSolutionPtr lookup(const MapHash& hash, int rows, int cols);
+    void insert(const MapHash& hash, CachedSolutionPtr solution);
+
+    bool storesDp() const { return m_storeDp; }
+    SolutionCacheStats stats() const;
+    void clear();
+
+private:
+    using Entry = std::pair<MapHash, CachedSolutionPtr>;
+
+    mutable std::mutex m_mutex;
+    std::list<Entry> m_lru;                                         // 表头为最近使用
+    std::unordered_map<MapHash, std::list<Entry>::iterator> m_index;
+    size_t m_maxBytes;
+    size_t m_bytes;
+    bool m_storeDp;
+    QString m_diskDirectory;
+
+    // 磁盘目录中的缓存文件名和大小，表头为最近使用
+    using DiskEntry = std::pair<QString, size_t>;
+    std::list<DiskEntry> m_diskLru;
+    std::unordered_map<std::string, std::list<DiskEntry>::iterator> m_diskIndex;
+    size_t m_maxDiskBytes;
+    size_t m_diskBytes;
+    bool m_diskStoresDp;
+
+    std::atomic<uint64_t> m_memoryHits;
+    std::atomic<uint64_t> m_diskHits;
+    std::atomic<uint64_t> m_misses;
+    std::atomic<uint64_t> m_insertions;
+    std::atomic<uint64_t> m_evictions;
+    std::atomic<uint64_t> m_diskEvictions;
+
+    void insertLocked(const MapHash& hash, CachedSolutionPtr solution);
+    void touchDiskLocked(const QString& fileName, size_t bytes);
+    std::vector<QString> evictDiskLocked();
+    static QString diskPath(const QString& directory, const MapHash& hash);
+    CachedSolutionPtr loadFromDisk(const QString& directory, const MapHash& hash, int rows, int cols) const;
+    size_t saveToDisk(const QString& directory, const MapHash& hash, const CachedSolution& solution, bool storeDp) const;
+};
+
+#endif // SOLUTIONCACHE_H
@@ -0,0 +1,318 @@
+#include "solverclient.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SOLVER_CLIENT_POSIX 1
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef SOLVER_CLIENT_POSIX
+
+namespace {
+
+std::string systemError(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+uint64_t nowMicros() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+SolverClient::SolverClient(const std::string& socketPath) : m_fd(-1), m_nextId(1) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        throw SolverClientException("套接字路径为空或过长");
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    m_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0) {
+        throw SolverClientException(systemError("创建套接字失败"));
+    }
+    if (::connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        std::string error = systemError("连接求解服务失败");
+        ::close(m_fd);
+        throw SolverClientException(error);
+    }
+}
+
+SolverClient::~SolverClient() {
+    ::close(m_fd);
+}
+
+uint32_t SolverClient::send(std::vector<char>& frame, uint32_t id, uint8_t type) {
+    size_t sent = 0;
+    while (sent < frame.size()) {
+        // 服务端繁忙时不再读取，这里随套接字缓冲区写满而阻塞，即背压
+        ssize_t written = ::send(m_fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw SolverClientException(systemError("发送请求失败"));
+        }
+        sent += static_cast<size_t>(written);
+    }
+    m_pending[id] = type;
+    return id;
+}
+
+uint32_t SolverClient::sendInline(const int* cells, int rows, int cols, const uint64_t* walls, bool wantPath) {
+    if (!cells || rows <= 0 || cols <= 0) {
+        throw SolverClientException("地图数据无效");
+    }
+    uint32_t id = m_nextId++;
+    size_t count = static_cast<size_t>(rows) * cols;
+
+    std::vector<char> frame;
+    frame.reserve(24 + count * sizeof(int32_t));
+    SolverProtocol::FrameWriter writer(frame);
+    writer.put32(id);
+    writer.put8(SolverProtocol::SOLVE_INLINE);
+    writer.put8((wantPath ? SolverProtocol::WANT_PATH : 0) | (walls ? SolverProtocol::HAS_WALLS : 0));
+    writer.put16(0);
+    writer.put32(static_cast<uint32_t>(rows));
+    writer.put32(static_cast<uint32_t>(cols));
+    for (size_t k = 0; k < count; ++k) {
+        writer.put32(static_cast<uint32_t>(cells[k]));
+    }
+    if (walls) {
+        for (size_t k = 0; k < (count + 63) / 64; ++k) {
+            writer.put64(walls[k]);
+        }
+    }
+    writer.finish();
+    return send(frame, id, SolverProtocol::SOLVE_INLINE);
+}
+
+uint32_t SolverClient::sendFile(const std::string& fileName, bool wantPath) {
+    uint32_t id = m_nextId++;
+    std::vector<char> frame;
+    SolverProtocol::FrameWriter writer(frame);
+    writer.put32(id);
+    writer.put8(SolverProtocol::SOLVE_FILE);
+    writer.put8(wantPath ? SolverProtocol::WANT_PATH : 0);
+    writer.put16(0);
+    writer.putBytes(fileName.data(), fileName.size());
+    writer.finish();
+    return send(frame, id, SolverProtocol::SOLVE_FILE);
+}
+
+uint32_t SolverClient::sendStats() {
+    uint32_t id = m_nextId++;
+    std::vector<char> frame;
+    SolverProtocol::FrameWriter writer(frame);
+    writer.put32(id);
+    writer.put8(SolverProtocol::STATS);
+    writer.put8(0);
+    writer.put16(0);
+    writer.finish();
+    return send(frame, id, SolverProtocol::STATS);
+}
+
+SolverReply SolverClient::receive() {
+    uint32_t length = 0;
+    while (!SolverProtocol::frameLength(m_input.data(), m_input.size(), length)) {
+        char buffer[65536];
+        ssize_t got = ::recv(m_fd, buffer, sizeof(buffer), 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            throw SolverClientException(got == 0 ? "求解服务已断开连接" : systemError("接收答复失败"));
+        }
+        m_input.insert(m_input.end(), buffer, buffer + got);
+    }
+
+    SolverReply reply;
+    try {
+        SolverProtocol::FrameReader reader(m_input.data() + 4, length);
+        reply.requestId = reader.get32();
+        reply.status = reader.get8();
+        reader.get8();
+        reader.get16();
+
+        auto it = m_pending.find(reply.requestId);
+        uint8_t type = it != m_pending.end() ? it->second : 0;
+        if (it != m_pending.end()) {
+            m_pending.erase(it);
+        }
+
+        if (reply.status != SolverProtocol::OK) {
+            size_t size = reader.remaining();
+            reply.error.assign(reader.getBytes(size), size);
+        } else if (type == SolverProtocol::STATS) {
+            reply.stats.received = reader.get64();
+            reply.stats.completed = reader.get64();
+            reply.stats.batches = reader.get64();
+            reply.stats.badRequests = reader.get64();
+            reply.stats.queued = reader.get32();
+            reply.stats.connections = reader.get32();
+            reply.stats.p50Micros = reader.get64();
+            reply.stats.p99Micros = reader.get64();
+        } else if (type != 0) {
+            reply.minHealth = static_cast<int32_t>(reader.get32());
+            reply.steps = reader.get32();
+            reply.moves.resize((static_cast<size_t>(reply.steps) + 63) / 64);
+            for (uint64_t& word : reply.moves) {
+                word = reader.get64();
+            }
+        } else {
+            throw SolverProtocol::ProtocolError("收到未知请求号的答复");
+        }
+    } catch (const SolverProtocol::ProtocolError& e) {
+        throw SolverClientException(std::string("答复格式错误: ") + e.what());
+    }
+
+    m_input.erase(m_input.begin(), m_input.begin() + 4 + length);
+    return reply;
+}
+
+LoadTestResult runLoadTest(const std::string& socketPath, const LoadTestOptions& options) {
+    if (options.clients <= 0 || options.requestsPerClient <= 0 || options.pipelineDepth <= 0 ||
+        options.rows <= 0 || options.cols <= 0 || options.distinctMaps <= 0) {
+        throw SolverClientException("压测参数必须为正数");
+    }
+
+    std::mutex mutex;
+    std::vector<uint64_t> latencies;
+    uint64_t failures = 0;
+    std::exception_ptr error;
+
+    auto clientLoop = [&](int client) {
+        try {
+            std::mt19937_64 random(options.seed + static_cast<uint64_t>(client));
+            std::uniform_int_distribution<int> cellValue(-10, 6);
+            size_t count = static_cast<size_t>(options.rows) * options.cols;
+            std::vector<std::vector<int>> maps(options.distinctMaps, std::vector<int>(count));
+            for (std::vector<int>& map : maps) {
+                for (int& cell : map) {
+                    cell = cellValue(random);
+                }
+            }
+
+            SolverClient connection(socketPath);
+            std::map<uint32_t, uint64_t> sentAt;
+            std::vector<uint64_t> local;
+            local.reserve(options.requestsPerClient);
+            uint64_t localFailures = 0;
+            int sent = 0;
+            int received = 0;
+            while (received < options.requestsPerClient) {
+                while (sent < options.requestsPerClient && sent - received < options.pipelineDepth) {
+                    const std::vector<int>& map = maps[sent % options.distinctMaps];
+                    uint32_t id = connection.sendInline(map.data(), options.rows, options.cols, nullptr, options.wantPath);
+                    sentAt[id] = nowMicros();
+                    ++sent;
+                }
+                SolverReply reply = connection.receive();
+                auto it = sentAt.find(reply.requestId);
+                if (it != sentAt.end()) {
+                    local.push_back(nowMicros() - it->second);
+                    sentAt.erase(it);
+                }
+                if (!reply.ok()) {
+                    ++localFailures;
+                }
+                ++received;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+            failures += localFailures;
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    uint64_t start = nowMicros();
+    std::vector<std::thread> threads;
+    for (int client = 0; client < options.clients; ++client) {
+        threads.emplace_back(clientLoop, client);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    LoadTestResult result;
+    result.seconds = (nowMicros() - start) / 1e6;
+    result.requests = latencies.size();
+    result.failures = failures;
+    result.requestsPerSecond = result.seconds > 0 ? result.requests / result.seconds : 0;
+    std::sort(latencies.begin(), latencies.end());
+    result.p50Micros = percentile(latencies, 0.50);
+    result.p99Micros = percentile(latencies, 0.99);
+
+    SolverClient statsConnection(socketPath);
+    statsConnection.sendStats();
+    SolverReply reply = statsConnection.receive();
+    if (!reply.ok()) {
+        throw SolverClientException("获取服务端统计失败: " + reply.error);
+    }
+    result.server = reply.stats;
+    return result;
+}
+
+#else
+
+// 没有Unix域套接字的平台上只保留接口，连接时报错
+
+SolverClient::SolverClient(const std::string& socketPath) : m_fd(-1), m_nextId(1) {
+    (void)socketPath;
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+SolverClient::~SolverClient() {
+}
+
+uint32_t SolverClient::sendInline(const int*, int, int, const uint64_t*, bool) {
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+uint32_t SolverClient::sendFile(const std::string&, bool) {
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+uint32_t SolverClient::sendStats() {
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+SolverReply SolverClient::receive() {
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+LoadTestResult runLoadTest(const std::string& socketPath, const LoadTestOptions& options) {
+    (void)socketPath;
+    (void)options;
+    throw SolverClientException("当前平台不支持求解服务客户端");
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SOLVERCLIENT_H
+#define SOLVERCLIENT_H
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "solverprotocol.h"
+
+// 求解服务的客户端和压测工具。只依赖标准库和POSIX套接字，不需要Qt，其他工具可以直接复用。
+
+class SolverClientException : public std::runtime_error {
+public:
+    explicit SolverClientException(const std::string& message) : std::runtime_error(message) {}
+};
+
+struct SolverReply {
+    uint32_t requestId = 0;
+    uint8_t status = SolverProtocol::OK;
+    std::string error;              // 失败时的错误信息
+
+    // 求解请求的答复
+    int minHealth = INT_MAX;
+    uint32_t steps = 0;             // 路径步数，没有要求路径时为0
+    std::vector<uint64_t> moves;    // 每步1位，1表示向下
+
+    // STATS请求的答复
+    SolverServiceStats stats;
+
+    bool ok() const { return status == SolverProtocol::OK; }
+};
+
+// 一个连接。请求可以连续发出多个（流水线），答复按服务端完成的顺序到达，用请求号对应。非线程安全。
+class SolverClient {
+public:
+    explicit SolverClient(const std::string& socketPath);
+    ~SolverClient();
+
+    SolverClient(const SolverClient&) = delete;
+    SolverClient& operator=(const SolverClient&) = delete;
+
+    // 发出请求，返回请求号。cells为rows*cols个格子（行优先），walls为空表示没有墙壁
+    uint32_t sendInline(const int* cells, int rows, int cols, const uint64_t* walls, bool wantPath);
+    uint32_t sendFile(const std::string& fileName, bool wantPath);
+    uint32_t sendStats();
+
+    // 阻塞等待下一个答复
+    SolverReply receive();
+
+    size_t pending() const { return m_pending.size(); }
+
+private:
+    uint32_t send(std::vector<char>& frame, uint32_t id, uint8_t type);
+
+    int m_fd;
+    uint32_t m_nextId;
+    std::map<uint32_t, uint8_t> m_pending;  // 未答复的请求号和请求类型
+    std::vector<char> m_input;
+};
+
+struct LoadTestOptions {
+    int clients = 4;                // 并发连接数（每个连接一个线程）
+    int requestsPerClient = 1000;
+    int pipelineDepth = 16;         // 每个连接同时未答复的请求数
+    int rows = 20;
+    int cols = 20;
+    int distinctMaps = 64;          // 每个连接轮流发送的不同地图数，越少批内去重越多
+    bool wantPath = true;
+    uint64_t seed = 1;
+};
+
+struct LoadTestResult {
+    uint64_t requests = 0;
+    uint64_t failures = 0;          // 状态不是OK的答复
+    double seconds = 0;
+    double requestsPerSecond = 0;
+    uint64_t p50Micros = 0;         // 客户端看到的往返延迟
+    uint64_t p99Micros = 0;
+    SolverServiceStats server;      // 压测结束后服务端的统计
+};
+
+// 压测：多个连接各自流水线发送随机小地图，统计吞吐和往返延迟
+LoadTestResult runLoadTest(const std::string& socketPath, const LoadTestOptions& options);
+
+#endif // SOLVERCLIENT_H
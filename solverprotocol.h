@@ -0,0 +1,151 @@
+#ifndef SOLVERPROTOCOL_H
+#define SOLVERPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// 求解服务的二进制协议，服务端和客户端共用。只依赖标准库，其他工具可以直接包含本文件。
+//
+// 所有整数为小端序。每帧以uint32长度（不含长度字段本身）开头：
+//
+// 请求：uint32 请求号 | uint8 类型 | uint8 标志 | uint16 保留
+//   SOLVE_INLINE：uint32 rows | uint32 cols | rows*cols个int32格子 | 带HAS_WALLS时ceil(rows*cols/64)个uint64墙壁位
+//   SOLVE_FILE：  .dgn文件路径（UTF-8，直到帧尾）
+//   STATS：       无
+//
+// 响应：uint32 请求号 | uint8 状态 | 3字节保留
+//   求解成功：int32 最小初始健康值（INT_MAX表示没有可行路线）| uint32 步数 | ceil(步数/64)个uint64走法位
+//             （从左上角出发，每步1位，1表示向下；不要路径或没有可行路线时步数为0）
+//   STATS成功：uint64 收到 | uint64 完成 | uint64 批数 | uint64 错误请求 | uint32 排队 | uint32 连接
+//             | uint64 p50微秒 | uint64 p99微秒
+//   失败：错误信息（UTF-8，直到帧尾）
+
+// 服务端统计，STATS请求的答复
+struct SolverServiceStats {
+    uint64_t received = 0;      // 收到的求解请求
+    uint64_t completed = 0;     // 已答复的求解请求
+    uint64_t batches = 0;       // 求解批数
+    uint64_t badRequests = 0;   // 格式错误的请求
+    uint32_t queued = 0;        // 正在排队的请求
+    uint32_t connections = 0;   // 当前连接数
+    uint64_t p50Micros = 0;     // 从收到请求到答复的延迟中位数
+    uint64_t p99Micros = 0;
+};
+
+namespace SolverProtocol {
+
+const uint32_t MAX_FRAME_SIZE = 64u << 20;
+
+enum RequestType : uint8_t {
+    SOLVE_INLINE = 1,
+    SOLVE_FILE = 2,
+    STATS = 3
+};
+
+enum RequestFlags : uint8_t {
+    WANT_PATH = 1u << 0,
+    HAS_WALLS = 1u << 1
+};
+
+enum Status : uint8_t {
+    OK = 0,
+    BAD_REQUEST = 1,
+    FAILED = 2
+};
+
+class ProtocolError : public std::runtime_error {
+public:
+    explicit ProtocolError(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 向帧中追加小端序字段；finish()回填开头的长度
+class FrameWriter {
+public:
+    explicit FrameWriter(std::vector<char>& buffer) : m_buffer(buffer), m_start(buffer.size()) { put32(0); }
+
+    void put8(uint8_t value) { m_buffer.push_back(static_cast<char>(value)); }
+    void put16(uint16_t value) { putLittle(value, 2); }
+    void put32(uint32_t value) { putLittle(value, 4); }
+    void put64(uint64_t value) { putLittle(value, 8); }
+    void putBytes(const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+
+    void finish() {
+        uint32_t length = static_cast<uint32_t>(m_buffer.size() - m_start - 4);
+        for (int k = 0; k < 4; ++k) {
+            m_buffer[m_start + k] = static_cast<char>((length >> (8 * k)) & 0xFF);
+        }
+    }
+
+private:
+    void putLittle(uint64_t value, int bytes) {
+        for (int k = 0; k < bytes; ++k) {
+            m_buffer.push_back(static_cast<char>((value >> (8 * k)) & 0xFF));
+        }
+    }
+
+    std::vector<char>& m_buffer;
+    size_t m_start;
+};
+
+// 从帧内容（不含长度字段）中按顺序读取字段，越界时抛出ProtocolError
+class FrameReader {
+public:
+    FrameReader(const char* data, size_t size) : m_data(data), m_size(size), m_offset(0) {}
+
+    uint8_t get8() { return static_cast<uint8_t>(getLittle(1)); }
+    uint16_t get16() { return static_cast<uint16_t>(getLittle(2)); }
+    uint32_t get32() { return static_cast<uint32_t>(getLittle(4)); }
+    uint64_t get64() { return getLittle(8); }
+    const char* getBytes(size_t size) {
+        require(size);
+        const char* bytes = m_data + m_offset;
+        m_offset += size;
+        return bytes;
+    }
+
+    size_t remaining() const { return m_size - m_offset; }
+
+private:
+    void require(size_t size) const {
+        if (size > m_size - m_offset) {
+            throw ProtocolError("帧长度不足");
+        }
+    }
+
+    uint64_t getLittle(int bytes) {
+        require(static_cast<size_t>(bytes));
+        uint64_t value = 0;
+        for (int k = 0; k < bytes; ++k) {
+            value |= uint64_t(static_cast<unsigned char>(m_data[m_offset + k])) << (8 * k);
+        }
+        m_offset += static_cast<size_t>(bytes);
+        return value;
+    }
+
+    const char* m_data;
+    size_t m_size;
+    size_t m_offset;
+};
+
+// 从buffer开头取出一个完整帧的长度，数据还不完整时返回false
+inline bool frameLength(const char* buffer, size_t size, uint32_t& length) {
+    if (size < 4) {
+        return false;
+    }
+    FrameReader reader(buffer, 4);
+    length = reader.get32();
+    if (length > MAX_FRAME_SIZE) {
+        throw ProtocolError("帧长度超过上限");
+    }
+    return size - 4 >= length;
+}
+
+} // namespace SolverProtocol
+
+#endif // SOLVERPROTOCOL_H
@@ -0,0 +1,667 @@
+#include "solverservice.h"
+#include "checkpointsolver.h"
+#include "dungeonfile.h"
+#include "logger.h"
+#include "maphash.h"
+#include "perfmetrics.h"
+#include "solverprotocol.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include "wallmask.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <exception>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SOLVER_SERVICE_POSIX 1
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#ifdef SOLVER_SERVICE_POSIX
+
+namespace {
+
+bool setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+std::string systemError(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+void beginResponse(SolverProtocol::FrameWriter& writer, uint32_t id, SolverProtocol::Status status) {
+    writer.put32(id);
+    writer.put8(status);
+    writer.put8(0);
+    writer.put16(0);
+}
+
+std::vector<char> errorFrame(uint32_t id, SolverProtocol::Status status, const std::string& message) {
+    std::vector<char> frame;
+    SolverProtocol::FrameWriter writer(frame);
+    beginResponse(writer, id, status);
+    writer.putBytes(message.data(), message.size());
+    writer.finish();
+    return frame;
+}
+
+// 一批中去重后的一个求解任务
+struct SolveJob {
+    const void* cells = nullptr;    // 内嵌地图（4字节格子），文件任务为空
+    const uint64_t* walls = nullptr;
+    int rows = 0;
+    int cols = 0;
+    std::string file;
+    bool wantPath = false;
+
+    bool ok = false;
+    std::string error;
+    int minHealth = INT_MAX;
+    uint32_t steps = 0;
+    std::vector<uint64_t> moves;
+};
+
+void runJob(SolveJob& job) {
+    try {
+        CheckpointSolver solver;
+        std::vector<QPoint> path;
+        if (job.file.empty()) {
+            solver.solve(job.cells, 4, job.walls, job.rows, job.cols);
+            if (job.wantPath) {
+                path = solver.tracePath();
+            }
+        } else {
+            // 映射要在回溯结束后才能释放
+            DungeonFileMapping mapping(QString::fromStdString(job.file));
+            const DungeonFileHeader& header = mapping.header();
+            solver.solve(mapping.cellData(), static_cast<int>(header.cellWidth), mapping.wallData(),
+                         static_cast<int>(header.rows), static_cast<int>(header.cols));
+            if (job.wantPath) {
+                path = solver.tracePath();
+            }
+        }
+
+        job.minHealth = solver.minHealth();
+        if (job.minHealth != INT_MAX && path.size() > 1) {
+            job.steps = static_cast<uint32_t>(path.size() - 1);
+            job.moves.assign(WallMask::wordCount(job.steps), 0);
+            for (uint32_t step = 0; step < job.steps; ++step) {
+                if (path[step + 1].y() != path[step].y()) {
+                    job.moves[step >> 6] |= uint64_t(1) << (step & 63);
+                }
+            }
+        }
+        job.ok = true;
+    } catch (const std::exception& e) {
+        job.error = e.what();
+    }
+}
+
+int latencyBucket(uint64_t micros, int buckets) {
+    int bucket = static_cast<int>(4 * std::log2(static_cast<double>(micros) + 1));
+    return std::min(bucket, buckets - 1);
+}
+
+uint64_t latencyBucketUpper(int bucket) {
+    return static_cast<uint64_t>(std::ceil(std::exp2((bucket + 1) / 4.0) - 1));
+}
+
+} // namespace
+
+SolverService::SolverService(const QString& socketPath, const SolverServiceOptions& options)
+    : m_socketPath(socketPath), m_options(options), m_listenFd(-1), m_wakeFds{-1, -1} {
+    if (options.queueCapacity == 0 || options.maxInFlightPerConnection == 0 || options.maxBatch == 0 ||
+        options.maxPendingOutputBytes == 0) {
+        throw SolverServiceException("队列容量、每连接请求上限、答复积压上限和批大小必须为正数");
+    }
+    for (auto& bucket : m_latency) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+SolverService::~SolverService() {
+    stop();
+}
+
+void SolverService::start() {
+    try {
+        if (m_listenFd >= 0) {
+            throw SolverServiceException("服务已经启动");
+        }
+
+        std::string path = m_socketPath.toStdString();
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw SolverServiceException("套接字路径为空或过长");
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        m_listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listenFd < 0) {
+            throw SolverServiceException(systemError("创建套接字失败"));
+        }
+        // 上次异常退出留下的套接字文件会让bind失败
+        ::unlink(path.c_str());
+        if (::bind(m_listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            ::listen(m_listenFd, SOMAXCONN) != 0 || !setNonBlocking(m_listenFd)) {
+            std::string error = systemError("监听套接字失败");
+            ::close(m_listenFd);
+            m_listenFd = -1;
+            throw SolverServiceException(error);
+        }
+
+        if (::pipe(m_wakeFds) != 0 || !setNonBlocking(m_wakeFds[0]) || !setNonBlocking(m_wakeFds[1])) {
+            std::string error = systemError("创建唤醒管道失败");
+            ::close(m_listenFd);
+            m_listenFd = -1;
+            throw SolverServiceException(error);
+        }
+
+        m_stopping = false;
+        m_ioThread = std::thread(&SolverService::ioLoop, this);
+        m_batchThread = std::thread(&SolverService::batchLoop, this);
+        LOG_INFO("Solver service listening on %s", path.c_str());
+
+    } catch (const SolverServiceException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw SolverServiceException(std::string("启动求解服务失败: ") + e.what());
+    }
+}
+
+void SolverService::stop() {
+    if (m_listenFd < 0) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queueReady.notify_all();
+    wake();
+    m_ioThread.join();
+    m_batchThread.join();
+
+    for (auto& entry : m_connections) {
+        ::close(entry.second.fd);
+    }
+    m_connections.clear();
+    m_connectionCount = 0;
+    m_queue.clear();
+    m_responses.clear();
+
+    ::close(m_listenFd);
+    ::close(m_wakeFds[0]);
+    ::close(m_wakeFds[1]);
+    m_listenFd = -1;
+    ::unlink(m_socketPath.toStdString().c_str());
+
+    SolverServiceStats s = stats();
+    LOG_INFO("Solver service stopped: %llu requests in %llu batches, p50 %llu us, p99 %llu us",
+             static_cast<unsigned long long>(s.completed), static_cast<unsigned long long>(s.batches),
+             static_cast<unsigned long long>(s.p50Micros), static_cast<unsigned long long>(s.p99Micros));
+}
+
+SolverServiceStats SolverService::stats() const {
+    SolverServiceStats s;
+    s.received = m_received.load(std::memory_order_relaxed);
+    s.completed = m_completed.load(std::memory_order_relaxed);
+    s.batches = m_batches.load(std::memory_order_relaxed);
+    s.badRequests = m_badRequests.load(std::memory_order_relaxed);
+    s.connections = m_connectionCount.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        s.queued = static_cast<uint32_t>(m_queue.size());
+    }
+
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total = 0;
+    for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+        counts[b] = m_latency[b].load(std::memory_order_relaxed);
+        total += counts[b];
+    }
+    auto percentile = [&](double q) -> uint64_t {
+        uint64_t target = static_cast<uint64_t>(std::ceil(total * q));
+        uint64_t seen = 0;
+        for (int b = 0; b < LATENCY_BUCKETS; ++b) {
+            seen += counts[b];
+            if (seen >= target && seen > 0) {
+                return latencyBucketUpper(b);
+            }
+        }
+        return 0;
+    };
+    s.p50Micros = percentile(0.50);
+    s.p99Micros = percentile(0.99);
+    return s;
+}
+
+void SolverService::wake() {
+    char byte = 1;
+    // 管道满时已有未处理的唤醒，忽略EAGAIN
+    ssize_t written = ::write(m_wakeFds[1], &byte, 1);
+    (void)written;
+}
+
+void SolverService::recordLatency(uint64_t micros) {
+    m_latency[latencyBucket(micros, LATENCY_BUCKETS)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void SolverService::ioLoop() {
+    std::vector<pollfd> fds;
+    std::vector<uint64_t> ids;
+
+    while (!m_stopping.load()) {
+        deliverResponses();
+
+        // 队列腾出空间后，先处理各连接已经收到但暂停解析的帧，并发出新的答复
+        std::vector<uint64_t> closing;
+        for (auto& entry : m_connections) {
+            if (!readConnection(entry.first, entry.second, false)) {
+                closing.push_back(entry.first);
+            }
+        }
+
+        bool queueFull;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            queueFull = m_queue.size() >= m_options.queueCapacity;
+        }
+
+        fds.clear();
+        ids.clear();
+        fds.push_back({m_wakeFds[0], POLLIN, 0});
+        fds.push_back({m_listenFd, POLLIN, 0});
+        for (auto& entry : m_connections) {
+            const Connection& connection = entry.second;
+            short events = 0;
+            if (!isThrottled(connection, queueFull)) {
+                events |= POLLIN;
+            }
+            if (connection.outputSent < connection.output.size()) {
+                events |= POLLOUT;
+            }
+            fds.push_back({connection.fd, events, 0});
+            ids.push_back(entry.first);
+        }
+
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            LOG_ERROR("Solver service poll failed: %s", std::strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            char drain[256];
+            while (::read(m_wakeFds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            for (;;) {
+                int fd = ::accept(m_listenFd, nullptr, nullptr);
+                if (fd < 0) {
+                    break;
+                }
+                if (!setNonBlocking(fd)) {
+                    ::close(fd);
+                    continue;
+                }
+                Connection connection;
+                connection.fd = fd;
+                m_connections.emplace(m_nextConnection++, std::move(connection));
+                m_connectionCount.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        for (size_t k = 2; k < fds.size(); ++k) {
+            auto it = m_connections.find(ids[k - 2]);
+            if (it == m_connections.end() || fds[k].revents == 0) {
+                continue;
+            }
+            Connection& connection = it->second;
+            bool open = true;
+            if (!(fds[k].events & POLLIN) && (fds[k].revents & (POLLHUP | POLLERR))) {
+                // 暂停读取时对端断开：poll会一直报告POLLHUP，不能等到恢复读取再处理
+                open = false;
+            } else if (fds[k].revents & (POLLIN | POLLHUP | POLLERR)) {
+                open = readConnection(it->first, connection, true);
+            }
+            if (open && (fds[k].revents & POLLOUT)) {
+                open = writeConnection(connection);
+            }
+            if (!open) {
+                closing.push_back(it->first);
+            }
+        }
+
+        for (uint64_t id : closing) {
+            auto it = m_connections.find(id);
+            if (it != m_connections.end()) {
+                ::close(it->second.fd);
+                m_connections.erase(it);
+                m_connectionCount.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+    }
+}
+
+bool SolverService::isThrottled(const Connection& connection, bool queueFull) const {
+    // STATS和错误答复不占队列，也按积压的答复字节计入
+    return queueFull || connection.inFlight >= m_options.maxInFlightPerConnection ||
+           connection.output.size() - connection.outputSent >= m_options.maxPendingOutputBytes;
+}
+
+bool SolverService::readConnection(uint64_t id, Connection& connection, bool receive) {
+    auto throttled = [&] {
+        bool queueFull;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            queueFull = m_queue.size() >= m_options.queueCapacity;
+        }
+        return isThrottled(connection, queueFull);
+    };
+
+    bool open = true;
+    if (receive && !throttled()) {
+        // 每轮只读一块：解析后仍受限时不再读取，未解析的输入不会超过一块加一个不完整的帧
+        char buffer[65536];
+        for (;;) {
+            ssize_t got = ::recv(connection.fd, buffer, sizeof(buffer), 0);
+            if (got > 0) {
+                connection.input.insert(connection.input.end(), buffer, buffer + got);
+                break;
+            }
+            if (got < 0 && (errno == EINTR)) {
+                continue;
+            }
+            if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                // 对端已关闭，剩下的请求不再处理
+                open = false;
+            }
+            break;
+        }
+    }
+
+    // 只在有空间时解析，保证队列长度不超过上限；剩下的数据留到下次
+    size_t consumed = 0;
+    try {
+        uint32_t length = 0;
+        while (open && !throttled() &&
+               SolverProtocol::frameLength(connection.input.data() + consumed, connection.input.size() - consumed, length)) {
+            handleFrame(id, connection, connection.input.data() + consumed + 4, length);
+            consumed += 4 + length;
+        }
+    } catch (const SolverProtocol::ProtocolError& e) {
+        LOG_WARNING("Closing solver connection: %s", e.what());
+        open = false;
+    }
+    connection.input.erase(connection.input.begin(), connection.input.begin() + consumed);
+
+    if (open && connection.outputSent < connection.output.size()) {
+        open = writeConnection(connection);
+    }
+    return open;
+}
+
+bool SolverService::writeConnection(Connection& connection) {
+    while (connection.outputSent < connection.output.size()) {
+        ssize_t sent = ::send(connection.fd, connection.output.data() + connection.outputSent,
+                              connection.output.size() - connection.outputSent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.outputSent += static_cast<size_t>(sent);
+    }
+    connection.output.clear();
+    connection.outputSent = 0;
+    return true;
+}
+
+void SolverService::handleFrame(uint64_t id, Connection& connection, const char* data, size_t size) {
+    SolverProtocol::FrameReader reader(data, size);
+    uint32_t requestId = 0;
+    try {
+        requestId = reader.get32();
+        uint8_t type = reader.get8();
+        uint8_t flags = reader.get8();
+        reader.get16();
+
+        if (type == SolverProtocol::STATS) {
+            SolverServiceStats s = stats();
+            SolverProtocol::FrameWriter writer(connection.output);
+            beginResponse(writer, requestId, SolverProtocol::OK);
+            writer.put64(s.received);
+            writer.put64(s.completed);
+            writer.put64(s.batches);
+            writer.put64(s.badRequests);
+            writer.put32(s.queued);
+            writer.put32(s.connections);
+            writer.put64(s.p50Micros);
+            writer.put64(s.p99Micros);
+            writer.finish();
+            return;
+        }
+
+        Request request;
+        request.connection = id;
+        request.id = requestId;
+        request.type = type;
+        request.flags = flags;
+        request.rows = 0;
+        request.cols = 0;
+        request.receivedAt = PerfMetrics::now();
+
+        if (type == SolverProtocol::SOLVE_INLINE) {
+            uint32_t rows = reader.get32();
+            uint32_t cols = reader.get32();
+            uint64_t count = uint64_t(rows) * cols;
+            uint64_t wallBytes = (flags & SolverProtocol::HAS_WALLS) ? WallMask::wordCount(count) * sizeof(uint64_t) : 0;
+            if (rows == 0 || cols == 0 || rows > INT_MAX || cols > INT_MAX ||
+                reader.remaining() != count * sizeof(int32_t) + wallBytes) {
+                throw SolverProtocol::ProtocolError("地图尺寸与帧长度不符");
+            }
+            request.rows = static_cast<int>(rows);
+            request.cols = static_cast<int>(cols);
+            request.cells.resize(count);
+            for (uint64_t k = 0; k < count; ++k) {
+                request.cells[k] = static_cast<int32_t>(reader.get32());
+            }
+            if (wallBytes) {
+                request.walls.resize(WallMask::wordCount(count));
+                for (uint64_t& word : request.walls) {
+                    word = reader.get64();
+                }
+            }
+        } else if (type == SolverProtocol::SOLVE_FILE) {
+            if (reader.remaining() == 0) {
+                throw SolverProtocol::ProtocolError("文件路径为空");
+            }
+            size_t length = reader.remaining();
+            request.file.assign(reader.getBytes(length), length);
+        } else {
+            throw SolverProtocol::ProtocolError("未知的请求类型: " + std::to_string(type));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back(std::move(request));
+        }
+        m_queueReady.notify_one();
+        ++connection.inFlight;
+        m_received.fetch_add(1, std::memory_order_relaxed);
+
+    } catch (const SolverProtocol::ProtocolError& e) {
+        // 帧边界完好，只答复错误，连接继续使用
+        m_badRequests.fetch_add(1, std::memory_order_relaxed);
+        std::vector<char> frame = errorFrame(requestId, SolverProtocol::BAD_REQUEST, e.what());
+        connection.output.insert(connection.output.end(), frame.begin(), frame.end());
+    }
+}
+
+void SolverService::deliverResponses() {
+    std::vector<Response> responses;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        responses.swap(m_responses);
+    }
+
+    uint64_t now = PerfMetrics::now();
+    for (Response& response : responses) {
+        recordLatency((now - response.receivedAt) / 1000);
+        m_completed.fetch_add(1, std::memory_order_relaxed);
+
+        // 连接可能已经关闭
+        auto it = m_connections.find(response.connection);
+        if (it == m_connections.end()) {
+            continue;
+        }
+        Connection& connection = it->second;
+        connection.output.insert(connection.output.end(), response.frame.begin(), response.frame.end());
+        --connection.inFlight;
+    }
+}
+
+void SolverService::batchLoop() {
+    for (;;) {
+        std::vector<Request> batch;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueReady.wait(lock, [this] { return m_stopping.load() || !m_queue.empty(); });
+            if (m_stopping) {
+                break;
+            }
+
+            // 等一个时间窗口，让同时到达的小请求合成一批
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(m_options.batchWindowMicros);
+            m_queueReady.wait_until(lock, deadline, [this] {
+                return m_stopping.load() || m_queue.size() >= m_options.maxBatch;
+            });
+            if (m_stopping) {
+                break;
+            }
+
+            size_t count = std::min(m_options.maxBatch, m_queue.size());
+            for (size_t k = 0; k < count; ++k) {
+                batch.push_back(std::move(m_queue.front()));
+                m_queue.pop_front();
+            }
+        }
+
+        // 队列有了空间，IO线程可以继续读取
+        wake();
+        solveBatch(batch);
+    }
+}
+
+void SolverService::solveBatch(std::vector<Request>& batch) {
+    TRACE_SCOPE("SolverService::solveBatch");
+
+    // 内容相同的地图和同一个文件只求解一次
+    std::vector<SolveJob> jobs;
+    std::vector<size_t> jobOf(batch.size());
+    std::map<std::string, size_t> keys;
+    for (size_t k = 0; k < batch.size(); ++k) {
+        const Request& request = batch[k];
+        std::string key = request.type == SolverProtocol::SOLVE_FILE
+            ? "f:" + request.file
+            : "m:" + hashMap(request.cells.data(), request.rows, request.cols,
+                             request.walls.empty() ? nullptr : request.walls.data()).toHex();
+        auto inserted = keys.emplace(key, jobs.size());
+        if (inserted.second) {
+            SolveJob job;
+            if (request.type == SolverProtocol::SOLVE_FILE) {
+                job.file = request.file;
+            } else {
+                job.cells = request.cells.data();
+                job.walls = request.walls.empty() ? nullptr : request.walls.data();
+                job.rows = request.rows;
+                job.cols = request.cols;
+            }
+            jobs.push_back(std::move(job));
+        }
+        jobOf[k] = inserted.first->second;
+        jobs[jobOf[k]].wantPath |= (request.flags & SolverProtocol::WANT_PATH) != 0;
+    }
+
+    parallelFor(jobs.size(), TaskPriority::Normal, [&jobs](size_t k) { runJob(jobs[k]); });
+    m_batches.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<Response> responses;
+    responses.reserve(batch.size());
+    for (size_t k = 0; k < batch.size(); ++k) {
+        const Request& request = batch[k];
+        const SolveJob& job = jobs[jobOf[k]];
+        Response response;
+        response.connection = request.connection;
+        response.receivedAt = request.receivedAt;
+        if (!job.ok) {
+            response.frame = errorFrame(request.id, SolverProtocol::FAILED, job.error);
+        } else {
+            bool withPath = (request.flags & SolverProtocol::WANT_PATH) != 0;
+            SolverProtocol::FrameWriter writer(response.frame);
+            beginResponse(writer, request.id, SolverProtocol::OK);
+            writer.put32(static_cast<uint32_t>(job.minHealth));
+            writer.put32(withPath ? job.steps : 0);
+            if (withPath) {
+                for (uint64_t word : job.moves) {
+                    writer.put64(word);
+                }
+            }
+            writer.finish();
+        }
+        responses.push_back(std::move(response));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (Response& response : responses) {
+            m_responses.push_back(std::move(response));
+        }
+    }
+    wake();
+}
+
+#else
+
+// 没有Unix域套接字和poll的平台上只保留接口，启动时报错
+
+SolverService::SolverService(const QString& socketPath, const SolverServiceOptions& options)
+    : m_socketPath(socketPath), m_options(options), m_listenFd(-1), m_wakeFds{-1, -1} {
+    for (auto& bucket : m_latency) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+SolverService::~SolverService() {
+}
+
+void SolverService::start() {
+    throw SolverServiceException("当前平台不支持求解服务");
+}
+
+void SolverService::stop() {
+}
+
+SolverServiceStats SolverService::stats() const {
+    return SolverServiceStats();
+}
+
+#endif
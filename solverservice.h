@@ -0,0 +1,123 @@
+#ifndef SOLVERSERVICE_H
+#define SOLVERSERVICE_H
+
+#include <QString>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "solverprotocol.h"
+
+class SolverServiceException : public std::runtime_error {
+public:
+    explicit SolverServiceException(const std::string& message) : std::runtime_error(message) {}
+};
+
+struct SolverServiceOptions {
+    size_t queueCapacity = 256;             // 等待求解的请求上限，满时暂停读取所有连接
+    size_t maxInFlightPerConnection = 64;   // 每个连接未答复的请求上限，满时暂停读取该连接
+    size_t maxPendingOutputBytes = 1 << 20; // 每个连接尚未发出的答复字节上限，超过时暂停读取该连接
+    size_t maxBatch = 32;                   // 每批最多合并的请求数
+    unsigned batchWindowMicros = 500;       // 收到第一个请求后等待凑批的时间
+};
+
+// 无界面的求解服务：在Unix域套接字上监听，按SolverProtocol收发长度前缀的二进制帧。
+//
+// 一个IO线程用poll处理所有连接的读写；完整的求解请求放进有界队列，由批处理线程按时间窗口凑批，
+// 同一批中内容相同的地图（按地图哈希）或同一个文件只求解一次，各任务在任务池中并行执行。
+// 队列满、某个连接未答复的请求过多或它积压的答复（客户端不读取时）过多时，IO线程不再读取（该）连接，
+// 压力经套接字缓冲区传回客户端。
+// 求解只用经典规则（左上到右下），基于CheckpointSolver，大地图也不需要完整的dp表。
+// 使用POSIX套接字和poll，仅支持类Unix系统。
+class SolverService {
+public:
+    explicit SolverService(const QString& socketPath, const SolverServiceOptions& options = SolverServiceOptions());
+    ~SolverService();
+
+    SolverService(const SolverService&) = delete;
+    SolverService& operator=(const SolverService&) = delete;
+
+    // 监听并启动IO线程和批处理线程
+    void start();
+
+    // 停止接受请求，关闭所有连接并等待线程结束（未答复的请求丢弃）
+    void stop();
+
+    SolverServiceStats stats() const;
+
+private:
+    struct Request {
+        uint64_t connection;
+        uint32_t id;
+        uint8_t type;
+        uint8_t flags;
+        int rows;
+        int cols;
+        std::vector<int> cells;
+        std::vector<uint64_t> walls;
+        std::string file;
+        uint64_t receivedAt;
+    };
+
+    struct Response {
+        uint64_t connection;
+        std::vector<char> frame;
+        uint64_t receivedAt;
+    };
+
+    struct Connection {
+        int fd = -1;
+        std::vector<char> input;
+        std::vector<char> output;
+        size_t outputSent = 0;
+        size_t inFlight = 0;
+    };
+
+    void ioLoop();
+    void batchLoop();
+    void solveBatch(std::vector<Request>& batch);
+
+    bool isThrottled(const Connection& connection, bool queueFull) const;
+    bool readConnection(uint64_t id, Connection& connection, bool receive);
+    bool writeConnection(Connection& connection);
+    void handleFrame(uint64_t id, Connection& connection, const char* data, size_t size);
+    void deliverResponses();
+    void wake();
+    void recordLatency(uint64_t micros);
+
+    QString m_socketPath;
+    SolverServiceOptions m_options;
+    int m_listenFd;
+    int m_wakeFds[2];
+    std::thread m_ioThread;
+    std::thread m_batchThread;
+    std::atomic<bool> m_stopping{false};
+
+    // IO线程独占
+    std::map<uint64_t, Connection> m_connections;
+    uint64_t m_nextConnection = 1;
+
+    // 请求队列和答复队列
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queueReady;
+    std::deque<Request> m_queue;
+    std::vector<Response> m_responses;
+
+    // 延迟直方图按1/4个二进制数量级分桶
+    static const int LATENCY_BUCKETS = 160;
+    std::atomic<uint64_t> m_latency[LATENCY_BUCKETS];
+    std::atomic<uint64_t> m_received{0};
+    std::atomic<uint64_t> m_completed{0};
+    std::atomic<uint64_t> m_batches{0};
+    std::atomic<uint64_t> m_badRequests{0};
+    std::atomic<uint32_t> m_connectionCount{0};
+};
+
+#endif // SOLVERSERVICE_H
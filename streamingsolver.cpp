@@ -0,0 +1,376 @@
+#include "streamingsolver.h"
+#include "dungeon.h"
+#include "dungeonfile.h"
+#include "healthstep.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include "taskpool.h"
+#include "tracer.h"
+#include "wallmask.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
+namespace {
+
+const char DECISION_MAGIC[8] = {'D', 'G', 'N', 'P', 'A', 'T', 'H', '\0'};
+const uint32_t DECISION_VERSION = 1;
+
+// 决策文件头（小端序，固定32字节），之后是rows行、每行rowWords个64位字的决策位
+struct DecisionHeader {
+    char magic[8];          // "DGNPATH\0"
+    uint32_t version;       // 格式版本
+    uint32_t rows;          // 行数
+    uint32_t cols;          // 列数
+    int32_t minHealth;      // 最小初始健康值，INT_MAX表示没有可行路线
+    uint64_t rowWords;      // 每行的字数
+};
+
+static_assert(sizeof(DecisionHeader) == 32, "DecisionHeader必须为32字节");
+
+// 单块读缓冲区的上限：块太大时第一块读完之前无法开始计算，预读也失去意义
+const size_t MAX_BLOCK_BYTES = size_t(16) << 20;
+
+// 从地图文件读入的一块连续行
+struct Block {
+    int lo = 0;                     // 首行
+    int hi = 0;                     // 末行之后
+    std::vector<uint64_t> cells;    // 按格子宽度存放的地图数据，用64位字保证对齐
+    std::vector<uint64_t> walls;    // 覆盖这些行的墙壁位图字
+    uint64_t wallWordBase = 0;      // walls[0]在整张位图中的字下标
+    uint64_t bytes = 0;             // 本块读取的字节数
+};
+
+void readAt(QFile& file, uint64_t offset, void* data, uint64_t bytes) {
+    if (!file.seek(static_cast<qint64>(offset)) ||
+        file.read(static_cast<char*>(data), static_cast<qint64>(bytes)) != static_cast<qint64>(bytes)) {
+        throw StreamingSolverException("读取地图文件失败: " + file.errorString().toStdString());
+    }
+}
+
+void writeAt(QFile& file, uint64_t offset, const void* data, uint64_t bytes) {
+    if (!file.seek(static_cast<qint64>(offset)) ||
+        file.write(static_cast<const char*>(data), static_cast<qint64>(bytes)) != static_cast<qint64>(bytes)) {
+        throw StreamingSolverException("写入决策文件失败: " + file.errorString().toStdString());
+    }
+}
+
+// 已经用完的区间不再需要留在页缓存里
+void dropCache(QFile& file, uint64_t offset, uint64_t bytes) {
+#if defined(__linux__) && defined(POSIX_FADV_DONTNEED)
+    posix_fadvise(file.handle(), static_cast<off_t>(offset), static_cast<off_t>(bytes), POSIX_FADV_DONTNEED);
+#else
+    (void)file;
+    (void)offset;
+    (void)bytes;
+#endif
+}
+
+// dp中是下一行的结果，就地从右向左算出本行；decisions非空时写出本行的决策位（调用方已清零）。
+// walls为空表示没有墙壁，否则wallBit是本行第一格在walls中的位下标
+template <typename T>
+void stepRow(const T* cells, int cols, const uint64_t* walls, uint64_t wallBit,
+             std::vector<int>& dp, uint64_t* decisions) {
+    int right = INT_MAX;
+    for (int j = cols - 1; j >= 0; --j) {
+        int down = dp[j];
+        int need = WallMask::masked(neededHealth(std::min(down, right), cells[j]),
+                                    WallMask::isWall(walls, wallBit + j), INT_MAX);
+        if (decisions && down <= right) {
+            decisions[j >> 6] |= uint64_t(1) << (j & 63);
+        }
+        dp[j] = need;
+        right = need;
+    }
+}
+
+void removeIncomplete(QFile& file) {
+    if (file.isOpen() && !file.remove()) {
+        LOG_WARNING("Failed to remove incomplete decision file: %s", qPrintable(file.errorString()));
+    }
+}
+
+} // namespace
+
+StreamingSolver::StreamingSolver(size_t memoryLimit) : m_memoryLimit(memoryLimit) {
+}
+
+StreamingSolveResult StreamingSolver::solve(const QString& mapFile, const QString& decisionFile) const {
+    TRACE_SCOPE("StreamingSolver::solve");
+    QFile decisionOut(decisionFile);
+    try {
+        uint64_t start = PerfMetrics::now();
+
+        QFile file(mapFile);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            throw StreamingSolverException("无法打开地图文件: " + file.errorString().toStdString());
+        }
+        DungeonFileHeader header = DungeonFile::readHeader(file);
+
+        int rows = static_cast<int>(header.rows);
+        int cols = static_cast<int>(header.cols);
+        uint64_t cellWidth = header.cellWidth;
+        bool hasWalls = (header.flags & DungeonFile::HAS_WALLS) != 0;
+        bool writeDecisions = !decisionFile.isEmpty();
+        uint64_t wallOffset = hasWalls ? DungeonFile::wallOffset(header) : 0;
+
+        // 内存预算：固定的一行dp加上每块行数成正比的两块读缓冲区和一块决策缓冲区。
+        // 地图数据按字取整，n行的墙壁位最多跨n*rowWords+1个字
+        uint64_t rowWords = WallMask::wordCount(static_cast<size_t>(cols));
+        uint64_t cellRowBytes = static_cast<uint64_t>(cols) * cellWidth;
+        uint64_t wallRowBytes = hasWalls ? rowWords * sizeof(uint64_t) : 0;
+        uint64_t decisionRowBytes = writeDecisions ? rowWords * sizeof(uint64_t) : 0;
+        uint64_t fixedBytes = static_cast<uint64_t>(cols) * sizeof(int) + 2 * sizeof(uint64_t) * (hasWalls ? 2 : 1);
+        uint64_t perRowBytes = 2 * (cellRowBytes + wallRowBytes) + decisionRowBytes;
+        if (m_memoryLimit < fixedBytes + perRowBytes) {
+            throw StreamingSolverException("内存上限过小，至少需要" + std::to_string(fixedBytes + perRowBytes) + "字节");
+        }
+        uint64_t blockRows = std::min<uint64_t>({static_cast<uint64_t>(rows),
+                                                 (m_memoryLimit - fixedBytes) / perRowBytes,
+                                                 std::max<uint64_t>(1, MAX_BLOCK_BYTES / cellRowBytes)});
+
+        Block blocks[2];
+        for (Block& block : blocks) {
+            block.cells.resize((blockRows * cellRowBytes + 7) / 8);
+            block.walls.resize(hasWalls ? blockRows * rowWords + 1 : 0);
+        }
+        std::vector<uint64_t> decisions(writeDecisions ? blockRows * rowWords : 0);
+
+        // 最后一行下面虚设一行，只有终点正下方需要1点健康值，这样最后一行与其他行用同一个递推
+        std::vector<int> dp(cols, INT_MAX);
+        dp[cols - 1] = 1;
+
+        uint64_t decisionOffset = sizeof(DecisionHeader);
+        if (writeDecisions) {
+            if (!decisionOut.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                throw StreamingSolverException("无法创建决策文件: " + decisionOut.errorString().toStdString());
+            }
+            if (!decisionOut.resize(static_cast<qint64>(decisionOffset + static_cast<uint64_t>(rows) * decisionRowBytes))) {
+                throw StreamingSolverException("无法创建决策文件: " + decisionOut.errorString().toStdString());
+            }
+        }
+
+        auto load = [&](Block& block, int lo, int hi) {
+            block.lo = lo;
+            block.hi = hi;
+            uint64_t cellBytes = static_cast<uint64_t>(hi - lo) * cellRowBytes;
+            readAt(file, header.cellOffset + static_cast<uint64_t>(lo) * cellRowBytes, block.cells.data(), cellBytes);
+            block.bytes = cellBytes;
+            if (hasWalls) {
+                uint64_t first = static_cast<uint64_t>(lo) * cols / 64;
+                uint64_t last = WallMask::wordCount(static_cast<size_t>(hi) * cols);
+                block.wallWordBase = first;
+                readAt(file, wallOffset + first * sizeof(uint64_t), block.walls.data(), (last - first) * sizeof(uint64_t));
+                block.bytes += (last - first) * sizeof(uint64_t);
+            }
+        };
+
+        auto solveBlock = [&](const Block& block) {
+            for (int i = block.hi - 1; i >= block.lo; --i) {
+                const char* cells = reinterpret_cast<const char*>(block.cells.data()) + (i - block.lo) * cellRowBytes;
+                const uint64_t* walls = hasWalls ? block.walls.data() : nullptr;
+                uint64_t wallBit = static_cast<uint64_t>(i) * cols - block.wallWordBase * 64;
+                uint64_t* rowDecisions = nullptr;
+                if (writeDecisions) {
+                    rowDecisions = decisions.data() + (i - block.lo) * rowWords;
+                    std::fill(rowDecisions, rowDecisions + rowWords, 0);
+                }
+
+                if (cellWidth == 1) {
+                    stepRow(reinterpret_cast<const int8_t*>(cells), cols, walls, wallBit, dp, rowDecisions);
+                } else if (cellWidth == 2) {
+                    stepRow(reinterpret_cast<const int16_t*>(cells), cols, walls, wallBit, dp, rowDecisions);
+                } else {
+                    stepRow(reinterpret_cast<const int32_t*>(cells), cols, walls, wallBit, dp, rowDecisions);
+                }
+            }
+
+            if (writeDecisions) {
+                writeAt(decisionOut, decisionOffset + static_cast<uint64_t>(block.lo) * decisionRowBytes,
+                        decisions.data(), static_cast<uint64_t>(block.hi - block.lo) * decisionRowBytes);
+            }
+            dropCache(file, header.cellOffset + static_cast<uint64_t>(block.lo) * cellRowBytes,
+                      static_cast<uint64_t>(block.hi - block.lo) * cellRowBytes);
+        };
+
+        StreamingSolveResult result;
+        result.rows = rows;
+        result.cols = cols;
+        result.blockRows = static_cast<int>(blockRows);
+        result.bufferBytes = static_cast<size_t>(
+            (blocks[0].cells.size() + blocks[0].walls.size()) * 2 * sizeof(uint64_t) +
+            decisions.size() * sizeof(uint64_t) + dp.size() * sizeof(int));
+
+        int current = 0;
+        load(blocks[current], std::max(0, rows - static_cast<int>(blockRows)), rows);
+        for (;;) {
+            Block& block = blocks[current];
+            Block& next = blocks[1 - current];
+            result.bytesRead += block.bytes;
+
+            // 计算当前块时在任务池中预读上面的一块；文件只在预读任务中读取
+            bool more = block.lo > 0;
+            TaskGroup readAhead(TaskPriority::Normal);
+            if (more) {
+                int lo = std::max(0, block.lo - static_cast<int>(blockRows));
+                int hi = block.lo;
+                readAhead.run([&load, &next, lo, hi] { load(next, lo, hi); });
+            }
+
+            solveBlock(block);
+            readAhead.wait();
+
+            if (!more) {
+                break;
+            }
+            current = 1 - current;
+        }
+
+        result.minHealth = dp[0];
+
+        if (writeDecisions) {
+            DecisionHeader decisionHeader;
+            std::memset(&decisionHeader, 0, sizeof(decisionHeader));
+            std::memcpy(decisionHeader.magic, DECISION_MAGIC, sizeof(DECISION_MAGIC));
+            decisionHeader.version = DECISION_VERSION;
+            decisionHeader.rows = header.rows;
+            decisionHeader.cols = header.cols;
+            decisionHeader.minHealth = result.minHealth;
+            decisionHeader.rowWords = rowWords;
+            writeAt(decisionOut, 0, &decisionHeader, sizeof(decisionHeader));
+            decisionOut.close();
+        }
+
+        result.seconds = (PerfMetrics::now() - start) / 1e9;
+        LOG_INFO("Streaming solve: %d x %d, %d rows per block, %.1f MB read in %.3f s",
+                 rows, cols, result.blockRows, result.bytesRead / 1e6, result.seconds);
+        return result;
+
+    } catch (const StreamingSolverException& e) {
+        removeIncomplete(decisionOut);
+        throw;
+    } catch (const std::exception& e) {
+        removeIncomplete(decisionOut);
+        throw StreamingSolverException(std::string("流式求解失败: ") + e.what());
+    }
+}
+
+std::vector<QPoint> StreamingSolver::tracePath(const QString& decisionFile) {
+    TRACE_SCOPE("StreamingSolver::tracePath");
+    try {
+        QFile file(decisionFile);
+        if (!file.open(QIODevice::ReadOnly)) {
+            throw StreamingSolverException("无法打开决策文件: " + file.errorString().toStdString());
+        }
+
+        DecisionHeader header;
+        if (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header)) ||
+            std::memcmp(header.magic, DECISION_MAGIC, sizeof(DECISION_MAGIC)) != 0) {
+            throw StreamingSolverException("不是有效的决策文件");
+        }
+        if (header.version != DECISION_VERSION) {
+            throw StreamingSolverException("不支持的决策文件版本: " + std::to_string(header.version));
+        }
+        if (header.rows == 0 || header.cols == 0 || header.rows > INT_MAX || header.cols > INT_MAX ||
+            header.rowWords != WallMask::wordCount(header.cols) ||
+            static_cast<uint64_t>(file.size()) < sizeof(header) + uint64_t(header.rows) * header.rowWords * sizeof(uint64_t)) {
+            throw StreamingSolverException("决策文件不完整");
+        }
+
+        std::vector<QPoint> path;
+        if (header.minHealth == INT_MAX) {
+            return path;
+        }
+
+        int rows = static_cast<int>(header.rows);
+        int cols = static_cast<int>(header.cols);
+        qint64 rowBytes = static_cast<qint64>(header.rowWords * sizeof(uint64_t));
+        std::vector<uint64_t> row(header.rowWords);
+        auto readRow = [&] {
+            if (file.read(reinterpret_cast<char*>(row.data()), rowBytes) != rowBytes) {
+                throw StreamingSolverException("读取决策文件失败: " + file.errorString().toStdString());
+            }
+        };
+
+        // 行按从上到下存放，路径只会向下，所以整个回溯是一次顺序读
+        path.reserve(static_cast<size_t>(rows) + cols - 1);
+        int i = 0;
+        int j = 0;
+        readRow();
+        for (;;) {
+            path.push_back(QPoint(j, i));
+            if (i == rows - 1 && j == cols - 1) {
+                break;
+            }
+
+            bool down = (row[j >> 6] >> (j & 63)) & 1;
+            if (down ? i == rows - 1 : j == cols - 1) {
+                throw StreamingSolverException("决策文件内容无效");
+            }
+            if (down) {
+                ++i;
+                readRow();
+            } else {
+                ++j;
+            }
+        }
+        return path;
+
+    } catch (const StreamingSolverException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw StreamingSolverException(std::string("回溯路径失败: ") + e.what());
+    }
+}
+
+StreamingSelfCheckResult StreamingSolver::selfCheck(const QString& mapFile, uint64_t seed) const {
+    TRACE_SCOPE("StreamingSolver::selfCheck");
+    QString decisionFile = mapFile + ".dec";
+    try {
+        // 4字节格子时rows*cols >= m_memoryLimit即可保证文件至少为上限的4倍
+        int side = 1;
+        while (static_cast<uint64_t>(side) * side < m_memoryLimit) {
+            ++side;
+        }
+        Dungeon::validateLoadedMapSize(side, side);
+
+        StreamingSelfCheckResult check;
+        {
+            // 参照结果：generateMap在Dungeon中用solveDp求解，快照带有最小健康值和经典回溯路径
+            Dungeon dungeon;
+            dungeon.loadMap(side, side, std::vector<int>(static_cast<size_t>(side) * side));
+            dungeon.generateMap(seed);
+            DungeonSnapshotPtr snapshot = dungeon.snapshot();
+            DungeonFile::save(mapFile, *snapshot, 4, false);
+
+            check.expectedMinHealth = snapshot->minHealth;
+            check.pathLength = snapshot->path.size();
+            check.stream = solve(mapFile, decisionFile);
+            check.minHealthMatches = check.stream.minHealth == snapshot->minHealth;
+            check.pathMatches = tracePath(decisionFile) == snapshot->path;
+        }
+        check.fileBytes = static_cast<uint64_t>(QFileInfo(mapFile).size());
+        QFile::remove(decisionFile);
+
+        if (check.fileBytes < 4 * static_cast<uint64_t>(m_memoryLimit)) {
+            throw StreamingSolverException("生成的地图文件小于内存上限的4倍");
+        }
+        if (!check.passed()) {
+            LOG_WARNING("Streaming self-check failed: min health %d vs %d, path %s",
+                        check.stream.minHealth, check.expectedMinHealth, check.pathMatches ? "matches" : "differs");
+        }
+        return check;
+
+    } catch (const StreamingSolverException& e) {
+        QFile::remove(decisionFile);
+        throw;
+    } catch (const std::exception& e) {
+        QFile::remove(decisionFile);
+        throw StreamingSolverException(std::string("流式求解自检失败: ") + e.what());
+    }
+}
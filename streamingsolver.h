@@ -0,0 +1,70 @@
+#ifndef STREAMINGSOLVER_H
+#define STREAMINGSOLVER_H
+
+#include <QPoint>
+#include <QString>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+class StreamingSolverException : public std::runtime_error {
+public:
+    explicit StreamingSolverException(const std::string& message) : std::runtime_error(message) {}
+};
+
+struct StreamingSolveResult {
+    int rows = 0;
+    int cols = 0;
+    int minHealth = INT_MAX;    // INT_MAX表示没有可行路线
+    uint64_t bytesRead = 0;     // 从地图文件读取的字节数
+    size_t bufferBytes = 0;     // 读缓冲区、dp行和决策缓冲区的总大小，不超过内存上限
+    int blockRows = 0;          // 每次读取的行数
+    double seconds = 0;
+};
+
+// 自检结果：流式求解与Dungeon::solveDp的比较
+struct StreamingSelfCheckResult {
+    StreamingSolveResult stream;
+    uint64_t fileBytes = 0;         // 生成的地图文件大小
+    int expectedMinHealth = INT_MAX;
+    size_t pathLength = 0;          // Dungeon求得的最优路径长度
+    bool minHealthMatches = false;
+    bool pathMatches = false;
+
+    bool passed() const { return minHealthMatches && pathMatches; }
+};
+
+// 不把地图载入内存的求解器，用于超过内存的.dgn文件。
+//
+// 反向DP每行只依赖下一行，所以从最后一行向上按块读取，只保留一行dp（O(cols)）。
+// 读缓冲区有两块：计算当前块时，任务池预读上面的一块；每块在文件中连续，整体是按块倒序的顺序读，
+// 吞吐接近磁盘顺序读带宽。读完的块在Linux上提示内核丢弃页缓存，不挤占其他程序的内存。
+//
+// 给定决策文件时每格写出一位（1表示向下，0表示向右，相等时优先向下，与经典回溯相同），
+// 决策文件按行从上到下存放，tracePath()顺序读回即可恢复路径，同样只需O(cols)内存。
+// 只按经典规则求解（左上到右下，不限健康上限），结果与Dungeon::solveDp一致。
+class StreamingSolver {
+public:
+    static const size_t DEFAULT_MEMORY_LIMIT = size_t(64) << 20;
+    static const size_t SELF_CHECK_MEMORY_LIMIT = size_t(16) << 20;  // 自检的默认上限，参照求解仍能整体载入内存
+
+    explicit StreamingSolver(size_t memoryLimit = DEFAULT_MEMORY_LIMIT);
+
+    // 求解地图文件；decisionFile非空时同时写出决策文件
+    StreamingSolveResult solve(const QString& mapFile, const QString& decisionFile = QString()) const;
+
+    // 按决策文件回溯从起点到终点的路径（x为列，y为行），没有可行路线时返回空
+    static std::vector<QPoint> tracePath(const QString& decisionFile);
+
+    // 自检：按种子生成一张地图文件大小至少为内存上限4倍的正方形地图写入mapFile（4字节格子），
+    // 在内存上限内流式求解并回溯路径，与同一张地图在Dungeon中用solveDp求得的最小健康值和路径比较。
+    // 参照结果需要把地图整体载入内存，所以内存上限受Dungeon的500MB限制约束；决策文件用完即删除，地图文件保留
+    StreamingSelfCheckResult selfCheck(const QString& mapFile, uint64_t seed = 1) const;
+
+private:
+    size_t m_memoryLimit;
+};
+
+#endif // STREAMINGSOLVER_H
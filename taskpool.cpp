@@ -0,0 +1,264 @@
+#include "taskpool.h"
+#include "logger.h"
+#include <algorithm>
+#include <chrono>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// 当前线程在任务池中的下标，不是工作线程时为-1
+thread_local int currentWorker = -1;
+
+std::mutex configMutex;
+unsigned configuredWorkers = 0;
+bool configuredPinning = false;
+bool poolStarted = false;
+
+void pinToCpu(std::thread& thread, unsigned index) {
+#ifdef __linux__
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(index % cpus, &set);
+    if (pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) != 0) {
+        LOG_WARNING("Failed to pin worker %u", index);
+    }
+#else
+    (void)thread;
+    (void)index;
+#endif
+}
+
+} // namespace
+
+TaskPool& TaskPool::instance() {
+    static TaskPool* pool = [] {
+        std::lock_guard<std::mutex> lock(configMutex);
+        poolStarted = true;
+        return new TaskPool(configuredWorkers, configuredPinning);
+    }();
+    return *pool;
+}
+
+void TaskPool::configure(unsigned workers, bool pinThreads) {
+    std::lock_guard<std::mutex> lock(configMutex);
+    if (poolStarted) {
+        throw TaskPoolException("任务池已经启动，无法再修改线程数");
+    }
+    configuredWorkers = workers;
+    configuredPinning = pinThreads;
+}
+
+TaskPool::TaskPool(unsigned workers, bool pinThreads) {
+    // 等待任务组的线程也会参与执行，默认比核数少开一个
+    if (workers == 0) {
+        workers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (unsigned k = 0; k < workers; ++k) {
+        m_workers.push_back(std::make_unique<Worker>());
+    }
+    for (unsigned k = 0; k < workers; ++k) {
+        std::thread thread(&TaskPool::workerLoop, this, k);
+        if (pinThreads) {
+            pinToCpu(thread, k);
+        }
+        thread.detach();
+    }
+
+    LOG_INFO("Task pool started with %u workers%s", workers, pinThreads ? " (pinned)" : "");
+}
+
+TaskPoolStats TaskPool::stats() const {
+    TaskPoolStats s;
+    s.workers = workerCount();
+    s.queued = m_queued.load(std::memory_order_relaxed);
+    s.executed = m_executed.load(std::memory_order_relaxed);
+    s.steals = m_steals.load(std::memory_order_relaxed);
+    return s;
+}
+
+void TaskPool::submit(Task task, TaskPriority priority) {
+    // 工作线程提交的任务放进自己的队列，其他线程轮流放进各个队列
+    unsigned index = currentWorker >= 0
+        ? static_cast<unsigned>(currentWorker)
+        : m_nextQueue.fetch_add(1, std::memory_order_relaxed) % workerCount();
+
+    // 先计数再入队，取走任务时的减法不会先于这里的加法
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queued.fetch_add(1, std::memory_order_relaxed);
+    }
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queues[static_cast<int>(priority)].push_back(std::move(task));
+    }
+    m_wake.notify_one();
+}
+
+bool TaskPool::takeTask(Task& task) {
+    unsigned self = static_cast<unsigned>(currentWorker);
+    unsigned count = workerCount();
+
+    for (int priority = 0; priority < 2; ++priority) {
+        // 先从自己的队尾取（最近提交、数据还在缓存里），再从其他线程的队头窃取
+        for (unsigned offset = 0; offset < count; ++offset) {
+            Worker& worker = *m_workers[(self + offset) % count];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            std::deque<Task>& queue = worker.queues[priority];
+            if (queue.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                task = std::move(queue.back());
+                queue.pop_back();
+            } else {
+                task = std::move(queue.front());
+                queue.pop_front();
+                m_steals.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool TaskPool::takeGroupTask(const TaskGroup* group, Task& task) {
+    for (auto& worker : m_workers) {
+        std::lock_guard<std::mutex> lock(worker->mutex);
+        for (std::deque<Task>& queue : worker->queues) {
+            auto it = std::find_if(queue.begin(), queue.end(), [group](const Task& t) { return t.group == group; });
+            if (it != queue.end()) {
+                task = std::move(*it);
+                queue.erase(it);
+                m_queued.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void TaskPool::execute(Task& task) {
+    std::exception_ptr error;
+    if (!task.group->token().isCancelled()) {
+        try {
+            task.run();
+        } catch (...) {
+            error = std::current_exception();
+        }
+    }
+    m_executed.fetch_add(1, std::memory_order_relaxed);
+
+    // finish()之后任务组可能立即被销毁，不能再访问
+    TaskGroup* group = task.group;
+    task.run = nullptr;
+    group->finish(error);
+}
+
+void TaskPool::workerLoop(unsigned index) {
+    currentWorker = static_cast<int>(index);
+
+    for (;;) {
+        Task task;
+        if (takeTask(task)) {
+            execute(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this] { return m_queued.load(std::memory_order_relaxed) > 0; });
+    }
+}
+
+TaskGroup::TaskGroup(TaskPriority priority, CancellationToken token)
+    : m_priority(priority), m_token(std::move(token)), m_pending(0) {
+}
+
+TaskGroup::~TaskGroup() {
+    try {
+        wait();
+    } catch (...) {
+        // 调用方没有等待时忽略任务中的异常
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    if (m_token.isCancelled()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_pending;
+    }
+    TaskPool::instance().submit(TaskPool::Task{std::move(task), this}, m_priority);
+}
+
+void TaskGroup::wait() {
+    TaskPool& pool = TaskPool::instance();
+
+    for (;;) {
+        TaskPool::Task task;
+        if (pool.takeGroupTask(this, task)) {
+            pool.execute(task);
+            continue;
+        }
+
+        // 剩下的任务都在其他线程上执行；短暂等待后再看是否有新提交的本组任务
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_done.wait_for(lock, std::chrono::milliseconds(1), [this] { return m_pending == 0; })) {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_error) {
+        std::exception_ptr error = m_error;
+        m_error = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void TaskGroup::finish(std::exception_ptr error) {
+    if (error) {
+        m_token.cancel();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (error && !m_error) {
+        m_error = error;
+    }
+    if (--m_pending == 0) {
+        m_done.notify_all();
+    }
+}
+
+void parallelFor(size_t count, TaskPriority priority, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+
+    TaskGroup group(priority);
+    for (size_t k = 1; k < count; ++k) {
+        group.run([&task, k] { task(k); });
+    }
+
+    try {
+        task(0);
+    } catch (...) {
+        group.cancel();
+        try {
+            group.wait();
+        } catch (...) {
+            // 以当前线程的异常为准
+        }
+        throw;
+    }
+    group.wait();
+}
@@ -0,0 +1,126 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+class TaskPoolException : public std::runtime_error {
+public:
+    explicit TaskPoolException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 界面直接等待的任务（正向扫描、区域查询）排在批量任务（导入）之前
+enum class TaskPriority {
+    High = 0,
+    Normal = 1
+};
+
+// 协作式取消：任务自己检查isCancelled()提前结束，尚未开始的任务直接跳过
+class CancellationToken {
+public:
+    CancellationToken() : m_cancelled(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { m_cancelled->store(true, std::memory_order_relaxed); }
+    bool isCancelled() const { return m_cancelled->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> m_cancelled;
+};
+
+struct TaskPoolStats {
+    unsigned workers = 0;       // 工作线程数
+    size_t queued = 0;          // 尚未开始的任务数
+    uint64_t executed = 0;      // 累计执行的任务数
+    uint64_t steals = 0;        // 累计从其他线程队列窃取的任务数
+};
+
+class TaskGroup;
+
+// 全程序共用的任务池：每个工作线程有自己的双端队列（每个优先级一个），自己从队尾取，
+// 空闲时从其他线程的队头窃取；高优先级的任务全部取完才取普通任务。
+// 任务池在第一次使用时创建，程序退出时不析构（与仍在运行的任务无关）。
+class TaskPool {
+public:
+    static TaskPool& instance();
+
+    // 在第一次使用前设置工作线程数（0表示按CPU核数）和是否把工作线程绑定到各自的CPU
+    static void configure(unsigned workers, bool pinThreads);
+
+    unsigned workerCount() const { return static_cast<unsigned>(m_workers.size()); }
+    TaskPoolStats stats() const;
+
+private:
+    friend class TaskGroup;
+
+    struct Task {
+        std::function<void()> run;
+        TaskGroup* group;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> queues[2];     // 按TaskPriority下标
+    };
+
+    TaskPool(unsigned workers, bool pinThreads);
+
+    void submit(Task task, TaskPriority priority);
+    bool takeTask(Task& task);
+    bool takeGroupTask(const TaskGroup* group, Task& task);
+    void execute(Task& task);
+    void workerLoop(unsigned index);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<size_t> m_queued{0};
+    std::atomic<uint64_t> m_executed{0};
+    std::atomic<uint64_t> m_steals{0};
+    std::atomic<unsigned> m_nextQueue{0};
+
+    // 只在没有任务时用于休眠和唤醒
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+};
+
+// 一组任务：run()提交，wait()等待全部完成并重新抛出第一个异常。
+// 等待的线程只帮忙执行本组的任务，不会在界面线程上跑别的批量任务；
+// 某个任务抛出异常后本组被取消，尚未开始的任务不再执行。析构时等待（忽略异常）。
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskPriority priority = TaskPriority::Normal, CancellationToken token = CancellationToken());
+    ~TaskGroup();
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(std::function<void()> task);
+    void wait();
+
+    void cancel() { m_token.cancel(); }
+    const CancellationToken& token() const { return m_token; }
+
+private:
+    friend class TaskPool;
+
+    void finish(std::exception_ptr error);
+
+    TaskPriority m_priority;
+    CancellationToken m_token;
+    size_t m_pending;                   // 受m_mutex保护
+    std::exception_ptr m_error;
+    std::mutex m_mutex;
+    std::condition_variable m_done;
+};
+
+// 把[0, count)的每个下标作为一个任务执行，当前线程执行下标0并帮忙执行其余任务，第一个异常在这里重新抛出
+void parallelFor(size_t count, TaskPriority priority, const std::function<void(size_t)>& task);
+
+#endif // TASKPOOL_H
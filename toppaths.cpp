@@ -0,0 +1,239 @@
+#include "toppaths.h"
+#include "dungeon.h"
+#include "logger.h"
+#include "perfmetrics.h"
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <set>
+
+namespace {
+
+// 尚未展开的候选路径：沿第parent条结果走到第step步时改走另一方向，之后沿dp贪心
+struct Candidate {
+    long long cost;     // 所需初始健康值
+    uint64_t order;     // 插入顺序，代价相同时保证顺序确定
+    int parent;
+    uint32_t step;
+
+    bool operator<(const Candidate& other) const {
+        return cost != other.cost ? cost < other.cost : order < other.order;
+    }
+};
+
+class TopPathEnumerator {
+public:
+    TopPathEnumerator(const int* map, const int* dp, int rows, int cols)
+        : m_map(map), m_dp(dp), m_rows(rows), m_cols(cols) {}
+
+    std::vector<RankedPath> run(int k);
+
+private:
+    const int* m_map;
+    const int* m_dp;
+    int m_rows;
+    int m_cols;
+
+    std::vector<RankedPath> m_results;
+    std::vector<uint32_t> m_firstFreeStep;  // 每条结果允许偏离的最早一步
+    std::set<Candidate> m_candidates;
+    size_t m_capacity = 0;                  // 还需要的路径数，多出的候选不可能入选
+    uint64_t m_order = 0;
+
+    int dpAt(int row, int col) const { return m_dp[static_cast<size_t>(row) * m_cols + col]; }
+    int mapAt(int row, int col) const { return m_map[static_cast<size_t>(row) * m_cols + col]; }
+
+    void completeGreedy(CompactPath& path, int row, int col) const;
+    CompactPath materialize(const Candidate& candidate) const;
+    void offer(long long cost, int parent, uint32_t step);
+    void addDeviations(int index);
+};
+
+// 从(row,col)沿dp走到终点，规则与Dungeon回溯最优路径一致：相等时优先向下
+void TopPathEnumerator::completeGreedy(CompactPath& path, int row, int col) const {
+    while (row < m_rows - 1 || col < m_cols - 1) {
+        bool down;
+        if (row == m_rows - 1) {
+            down = false;
+        } else if (col == m_cols - 1) {
+            down = true;
+        } else {
+            down = dpAt(row + 1, col) <= dpAt(row, col + 1);
+        }
+
+        path.push(down);
+        if (down) {
+            row++;
+        } else {
+            col++;
+        }
+    }
+}
+
+CompactPath TopPathEnumerator::materialize(const Candidate& candidate) const {
+    const CompactPath& parent = m_results[candidate.parent].path;
+
+    CompactPath path;
+    path.start = parent.start;
+    path.bits.reserve(parent.bits.size());
+
+    int row = 0;
+    int col = 0;
+    for (uint32_t s = 0; s < candidate.step; ++s) {
+        bool down = parent.isDown(s);
+        path.push(down);
+        if (down) {
+            row++;
+        } else {
+            col++;
+        }
+    }
+
+    bool down = !parent.isDown(candidate.step);
+    path.push(down);
+    if (down) {
+        row++;
+    } else {
+        col++;
+    }
+
+    completeGreedy(path, row, col);
+    return path;
+}
+
+void TopPathEnumerator::offer(long long cost, int parent, uint32_t step) {
+    if (m_candidates.size() >= m_capacity) {
+        if (m_capacity == 0 || cost >= std::prev(m_candidates.end())->cost) {
+            return;
+        }
+    }
+
+    m_candidates.insert(Candidate{cost, m_order++, parent, step});
+    if (m_candidates.size() > m_capacity) {
+        m_candidates.erase(std::prev(m_candidates.end()));
+    }
+}
+
+// 沿第index条结果前进，在允许偏离的每一步计算改走另一方向的代价
+void TopPathEnumerator::addDeviations(int index) {
+    const CompactPath& path = m_results[index].path;
+    uint32_t firstFree = m_firstFreeStep[index];
+
+    int row = 0;
+    int col = 0;
+    long long sum = mapAt(0, 0);                // 已走过格子（含当前格）的效果之和
+    long long need = std::max(1LL, 1 - sum);    // 走到当前格所需的初始健康值
+
+    for (uint32_t s = 0; s < path.length; ++s) {
+        bool down = path.isDown(s);
+
+        if (s >= firstFree) {
+            int altRow = down ? row : row + 1;
+            int altCol = down ? col + 1 : col;
+            // 另一方向是墙壁或被墙壁挡住时dp为INT_MAX，不作为候选
+            if (altRow < m_rows && altCol < m_cols && dpAt(altRow, altCol) != INT_MAX) {
+                long long cost = std::max(need, static_cast<long long>(dpAt(altRow, altCol)) - sum);
+                offer(cost, index, s);
+            }
+        }
+
+        if (down) {
+            row++;
+        } else {
+            col++;
+        }
+        sum += mapAt(row, col);
+        need = std::max(need, 1 - sum);
+    }
+}
+
+std::vector<RankedPath> TopPathEnumerator::run(int k) {
+    // 最优路径即dp贪心得到的路径，可在任意一步偏离
+    RankedPath best;
+    best.requiredHealth = dpAt(0, 0);
+    best.path.start = QPoint(0, 0);
+    completeGreedy(best.path, 0, 0);
+
+    m_results.push_back(std::move(best));
+    m_firstFreeStep.push_back(0);
+    m_capacity = static_cast<size_t>(k) - 1;
+    addDeviations(0);
+
+    while (m_results.size() < static_cast<size_t>(k) && !m_candidates.empty()) {
+        Candidate next = *m_candidates.begin();
+        m_candidates.erase(m_candidates.begin());
+
+        RankedPath result;
+        result.requiredHealth = static_cast<int>(std::min<long long>(next.cost, INT_MAX));
+        result.path = materialize(next);
+
+        // 在偏离步及之前改道只会得到父路径或已有候选
+        m_results.push_back(std::move(result));
+        m_firstFreeStep.push_back(next.step + 1);
+        m_capacity = static_cast<size_t>(k) - m_results.size();
+        while (m_candidates.size() > m_capacity) {
+            m_candidates.erase(std::prev(m_candidates.end()));
+        }
+        addDeviations(static_cast<int>(m_results.size()) - 1);
+    }
+
+    return std::move(m_results);
+}
+
+} // namespace
+
+std::vector<RankedPath> enumerateTopPaths(const int* map, const int* dp, int rows, int cols, int k) {
+    if (!map || !dp || rows <= 0 || cols <= 0 || k <= 0 || dp[0] == INT_MAX) {
+        return {};
+    }
+
+    TopPathEnumerator enumerator(map, dp, rows, cols);
+    return enumerator.run(k);
+}
+
+TopPathsBenchmarkResult runTopPathsBenchmark(const TopPathsBenchmarkOptions& options) {
+    if (options.maxK <= 0) {
+        throw DungeonException("路径条数必须大于0");
+    }
+
+    std::mt19937_64 random(options.seed);
+    std::uniform_int_distribution<int> cellValue(-4, 2);
+    std::vector<int> cells(static_cast<size_t>(std::max(options.mapSize, 0)) * std::max(options.mapSize, 0));
+    for (int& cell : cells) {
+        cell = cellValue(random);
+    }
+    Dungeon dungeon;
+    dungeon.loadMap(options.mapSize, options.mapSize, std::move(cells));
+
+    TopPathsBenchmarkResult result;
+    uint64_t start = PerfMetrics::now();
+    int minHealth = dungeon.calculateMinHealth();
+    result.solveSeconds = (PerfMetrics::now() - start) / 1e9;
+
+    std::vector<int> ks;
+    for (long long k = 1; k < options.maxK; k *= 10) {
+        ks.push_back(static_cast<int>(k));
+    }
+    ks.push_back(options.maxK);
+
+    for (int k : ks) {
+        start = PerfMetrics::now();
+        std::vector<RankedPath> paths = dungeon.getTopKPaths(k);
+        TopPathsBenchmarkRun run;
+        run.k = k;
+        run.seconds = (PerfMetrics::now() - start) / 1e9;
+        if (!paths.empty()) {
+            run.bestHealth = paths.front().requiredHealth;
+            run.worstHealth = paths.back().requiredHealth;
+        }
+        bool sorted = std::is_sorted(paths.begin(), paths.end(), [](const RankedPath& a, const RankedPath& b) {
+            return a.requiredHealth < b.requiredHealth;
+        });
+        if (!sorted || paths.size() != static_cast<size_t>(k) || run.bestHealth != minHealth) {
+            result.consistent = false;
+        }
+        LOG_INFO("Top paths benchmark: %d x %d, k = %d in %.3f s", options.mapSize, options.mapSize, k, run.seconds);
+        result.runs.push_back(run);
+    }
+    return result;
+}
@@ -0,0 +1,42 @@
+#ifndef TOPPATHS_H
+#define TOPPATHS_H
+
+#include <vector>
+#include "compactpath.h"
+
+// 一条按所需初始健康值排名的路径
+struct RankedPath {
+    int requiredHealth = 0;     // 沿该路径走完所需的最小初始健康值
+    CompactPath path;           // 从起点到终点的路径
+};
+
+// 按所需初始健康值从小到大返回前k条路径（相同健康值的顺序固定但不作约定）。
+// 基于已求解的DP表做Lawler式的偏离枚举：每输出一条路径，只考察它在
+// 各步改走另一方向的候选，候选的代价由前缀约束和dp值直接得出，
+// 再沿dp贪心补全。候选集合只保留还可能进入前k名的部分，
+// 因此时间为O(k*(rows+cols)*log k)，与路径总数无关。
+std::vector<RankedPath> enumerateTopPaths(const int* map, const int* dp, int rows, int cols, int k);
+
+struct TopPathsBenchmarkOptions {
+    int mapSize = 2000;     // 地图边长
+    int maxK = 10000;       // 依次计时k = 1, 10, 100, …直到maxK
+    uint64_t seed = 1;
+};
+
+struct TopPathsBenchmarkRun {
+    int k = 0;
+    double seconds = 0;
+    int bestHealth = 0;     // 第1条和第k条路径所需的初始健康值
+    int worstHealth = 0;
+};
+
+struct TopPathsBenchmarkResult {
+    double solveSeconds = 0;        // 求解dp表的用时，不计入各次枚举
+    std::vector<TopPathsBenchmarkRun> runs;
+    bool consistent = true;         // 每次结果都按健康值排序、第1条等于最小健康值且条数为k
+};
+
+// 基准测试：在mapSize×mapSize的随机地图上求解一次dp，再按不同的k计时enumerateTopPaths
+TopPathsBenchmarkResult runTopPathsBenchmark(const TopPathsBenchmarkOptions& options);
+
+#endif // TOPPATHS_H
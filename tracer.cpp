@@ -0,0 +1,195 @@
+#include "tracer.h"
+#include "logger.h"
+#include <QSaveFile>
+#include <chrono>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+};
+
+// 一个线程的事件缓冲区，只有持有它的线程写入，导出时按count读取已发布的部分
+struct ThreadBuffer {
+    uint32_t tid = 0;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<size_t> count{0};
+    std::atomic<bool> inUse{true};
+};
+
+// 注册表只在线程第一次记录、清空和导出时加锁；程序退出时不析构，避免与仍在结束的线程竞争
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::atomic<size_t> dropped{0};
+};
+
+Registry& registry() {
+    static Registry* instance = new Registry;
+    return *instance;
+}
+
+// 线程退出时归还缓冲区，已记录的事件保留到下次清空
+struct ThreadSlot {
+    ThreadBuffer* buffer = nullptr;
+
+    ~ThreadSlot() {
+        if (buffer) {
+            buffer->inUse.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local ThreadSlot slot;
+
+ThreadBuffer* acquireBuffer() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+
+    for (auto& buffer : r.buffers) {
+        bool expected = false;
+        if (buffer->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            return buffer.get();
+        }
+    }
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->tid = static_cast<uint32_t>(r.buffers.size() + 1);
+    buffer->events.reset(new TraceEvent[Tracer::EVENTS_PER_THREAD]);
+    r.buffers.push_back(std::move(buffer));
+    return r.buffers.back().get();
+}
+
+void writeJsonString(std::ostringstream& out, const char* text) {
+    out << '"';
+    for (const char* p = text; *p; ++p) {
+        if (*p == '"' || *p == '\\') {
+            out << '\\';
+        }
+        out << *p;
+    }
+    out << '"';
+}
+
+} // namespace
+
+namespace Tracer {
+
+namespace detail {
+std::atomic<bool> enabled(false);
+}
+
+void setEnabled(bool enabled) {
+    if (enabled && !isEnabled()) {
+        clear();
+    }
+    detail::enabled.store(enabled, std::memory_order_relaxed);
+    LOG_INFO("Tracing %s", enabled ? "enabled" : "disabled");
+}
+
+uint64_t now() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void record(const char* name, uint64_t begin, uint64_t end) {
+    ThreadBuffer* buffer = slot.buffer;
+    if (!buffer) {
+        buffer = slot.buffer = acquireBuffer();
+    }
+
+    // 单生产者：先写事件再发布计数，导出线程按acquire读到的计数读取
+    size_t n = buffer->count.load(std::memory_order_relaxed);
+    if (n >= EVENTS_PER_THREAD) {
+        registry().dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[n] = TraceEvent{name, begin, end};
+    buffer->count.store(n + 1, std::memory_order_release);
+}
+
+void clear() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (auto& buffer : r.buffers) {
+        buffer->count.store(0, std::memory_order_relaxed);
+    }
+    r.dropped.store(0, std::memory_order_relaxed);
+}
+
+size_t eventCount() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    size_t total = 0;
+    for (auto& buffer : r.buffers) {
+        total += buffer->count.load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+size_t droppedCount() {
+    return registry().dropped.load(std::memory_order_relaxed);
+}
+
+void writeChromeTrace(const QString& fileName) {
+    try {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"地下城游戏\"}}";
+
+        size_t written = 0;
+        {
+            Registry& r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+
+            for (auto& buffer : r.buffers) {
+                size_t n = buffer->count.load(std::memory_order_acquire);
+                if (n == 0) {
+                    continue;
+                }
+
+                out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+                    << ",\"args\":{\"name\":\"线程" << buffer->tid << "\"}}";
+
+                for (size_t k = 0; k < n; ++k) {
+                    const TraceEvent& e = buffer->events[k];
+                    out << ",\n{\"name\":";
+                    writeJsonString(out, e.name);
+                    out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+                        << ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << (e.end - e.begin) / 1000.0 << "}";
+                }
+                written += n;
+            }
+        }
+        out << "\n]}\n";
+
+        // 先写临时文件，全部成功后再替换目标文件
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly)) {
+            throw TraceException("无法创建跟踪文件: " + file.errorString().toStdString());
+        }
+        std::string text = out.str();
+        if (file.write(text.data(), static_cast<qint64>(text.size())) != static_cast<qint64>(text.size()) ||
+            !file.commit()) {
+            throw TraceException("写入跟踪文件失败: " + file.errorString().toStdString());
+        }
+
+        LOG_INFO("Trace written: %zu events, %zu dropped", written, droppedCount());
+
+    } catch (const TraceException& e) {
+        throw;
+    } catch (const std::exception& e) {
+        throw TraceException(std::string("导出跟踪失败: ") + e.what());
+    }
+}
+
+} // namespace Tracer
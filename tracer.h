@@ -0,0 +1,77 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+class TraceException : public std::runtime_error {
+public:
+    explicit TraceException(const std::string& message) : std::runtime_error(message) {}
+};
+
+// 内置跟踪：记录各热点函数的耗时跨度，导出为Chrome/Perfetto可以打开的trace JSON。
+//
+// 每个线程写自己的定长缓冲区（单生产者，只用原子计数发布，不加锁），缓冲区写满后丢弃新事件并计数；
+// 线程退出后缓冲区留给之后新建的线程复用，反复创建工作线程时内存不会增长。
+// 未开启时每个跨度只有一次relaxed原子读；定义DUNGEON_NO_TRACE时TRACE_SCOPE展开为空，整体编译期移除。
+namespace Tracer {
+
+// 每个线程最多保存的事件数
+const size_t EVENTS_PER_THREAD = 1 << 16;
+
+namespace detail {
+extern std::atomic<bool> enabled;
+}
+
+inline bool isEnabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+// 开始录制时清空之前的事件
+void setEnabled(bool enabled);
+
+// 当前时间（纳秒，相对进程内固定起点）
+uint64_t now();
+
+// 记录一个跨度，name必须是静态字符串（只保存指针）
+void record(const char* name, uint64_t begin, uint64_t end);
+
+void clear();
+size_t eventCount();
+size_t droppedCount();
+
+// 导出为Chrome trace-event格式（"X"完整事件，时间单位微秒）
+void writeChromeTrace(const QString& fileName);
+
+} // namespace Tracer
+
+// 作用域跨度：构造时开始，析构时记录
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : m_name(Tracer::isEnabled() ? name : nullptr), m_begin(m_name ? Tracer::now() : 0) {}
+
+    ~TraceScope() {
+        if (m_name) {
+            Tracer::record(m_name, m_begin, Tracer::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef DUNGEON_NO_TRACE
+#define TRACE_SCOPE(name) ((void)0)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(name)
+#endif
+
+#endif // TRACER_H
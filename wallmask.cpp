@@ -0,0 +1,102 @@
+#include "wallmask.h"
+#include <algorithm>
+
+namespace {
+
+// 取出第row行的空地位（1表示可走），行内第j格对应第j位，超出列数的位为0
+void openRow(const uint64_t* walls, int row, int cols, std::vector<uint64_t>& open) {
+    size_t words = open.size();
+    size_t base = static_cast<size_t>(row) * cols;
+    size_t totalWords = WallMask::wordCount(static_cast<size_t>(row + 1) * cols);
+
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        if (walls) {
+            size_t k = base + w * 64;
+            size_t word = k >> 6;
+            int offset = static_cast<int>(k & 63);
+            bits = walls[word] >> offset;
+            if (offset != 0 && word + 1 < totalWords) {
+                bits |= walls[word + 1] << (64 - offset);
+            }
+        }
+        open[w] = ~bits;
+    }
+
+    int tail = cols & 63;
+    if (tail != 0) {
+        open[words - 1] &= (uint64_t(1) << tail) - 1;
+    }
+}
+
+} // namespace
+
+namespace WallMask {
+
+bool any(const uint64_t* walls, size_t cells) {
+    if (!walls) {
+        return false;
+    }
+    size_t words = wordCount(cells);
+    for (size_t w = 0; w < words; ++w) {
+        if (walls[w]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool reachable(const uint64_t* walls, int rows, int cols, const QPoint& from, const std::vector<QPoint>& targets) {
+    if (rows <= 0 || cols <= 0 || from.x() < 0 || from.x() >= cols || from.y() < 0 || from.y() >= rows) {
+        return false;
+    }
+
+    int lastRow = -1;
+    for (const QPoint& t : targets) {
+        if (t.x() >= from.x() && t.y() >= from.y() && t.y() < rows && t.x() < cols) {
+            lastRow = std::max(lastRow, t.y());
+        }
+    }
+    if (lastRow < 0) {
+        return false;
+    }
+
+    size_t words = wordCount(static_cast<size_t>(cols));
+    std::vector<uint64_t> open(words);
+    std::vector<uint64_t> reach(words, 0);
+    reach[static_cast<size_t>(from.x()) >> 6] = uint64_t(1) << (from.x() & 63);
+
+    for (int i = from.y(); i <= lastRow; ++i) {
+        openRow(walls, i, cols, open);
+
+        // 向下：上一行（首行为起点）可达且本格为空地；向右：seed + open的进位沿连续的1传播，
+        // 与open异或后正好是从种子位起向右的一段空地，进位跨字时继续传入下一个字
+        uint64_t carry = 0;
+        bool any = false;
+        for (size_t w = 0; w < words; ++w) {
+            uint64_t seed = reach[w] & open[w];
+            uint64_t sum = open[w] + seed;
+            uint64_t carryOut = sum < open[w];
+            uint64_t total = sum + carry;
+            carryOut |= total < sum;
+
+            reach[w] = ((total ^ open[w]) & open[w]) | seed;
+            carry = carryOut;
+            any = any || reach[w] != 0;
+        }
+        if (!any) {
+            return false;
+        }
+
+        for (const QPoint& t : targets) {
+            if (t.y() == i && t.x() >= 0 && t.x() < cols &&
+                ((reach[static_cast<size_t>(t.x()) >> 6] >> (t.x() & 63)) & 1)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+} // namespace WallMask
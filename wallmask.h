@@ -0,0 +1,42 @@
+#ifndef WALLMASK_H
+#define WALLMASK_H
+
+#include <QPoint>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 障碍位图：每格一位（行优先），1表示墙壁，不能进入。
+// 位图指针为空表示没有墙壁，各求解器照常计算。
+namespace WallMask {
+
+inline size_t wordCount(size_t cells) {
+    return (cells + 63) / 64;
+}
+
+inline bool isWall(const uint64_t* walls, size_t k) {
+    return walls && ((walls[k >> 6] >> (k & 63)) & 1);
+}
+
+inline void setWall(uint64_t* walls, size_t k, bool wall) {
+    uint64_t bit = uint64_t(1) << (k & 63);
+    walls[k >> 6] = wall ? walls[k >> 6] | bit : walls[k >> 6] & ~bit;
+}
+
+// 墙壁格子的结果按掩码替换为blocked（反向DP为INT_MAX，正向DP为0），不用分支
+inline int masked(int value, bool wall, int blocked) {
+    int mask = -static_cast<int>(wall);
+    return (value & ~mask) | (blocked & mask);
+}
+
+// 是否至少有一面墙
+bool any(const uint64_t* walls, size_t cells);
+
+// 只向右下走时从from能否到达targets中的任一格子。
+// 按行做位图填充：上一行可达的位向下传入，再借加法进位一次把可达位沿本行连续的空地向右推进，
+// 每行只需O(cols/64)次字运算。
+bool reachable(const uint64_t* walls, int rows, int cols, const QPoint& from, const std::vector<QPoint>& targets);
+
+} // namespace WallMask
+
+#endif // WALLMASK_H